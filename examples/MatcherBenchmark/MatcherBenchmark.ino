@@ -0,0 +1,91 @@
+#include "A76XX.h"
+
+// Compare the cost per byte of finding responses and URCs in the stream coming
+// from the module, using the old approach (one `endsWith` per pattern per byte on
+// a ring buffer) and the MultiMatcher automaton used by ModemSerial::waitResponse.
+
+// what a waitResponse("+HTTPREAD: ") call looks for, plus the handlers
+// registered by the GNSS, MQTT and SMS clients
+const char* patterns[] = {
+    "+HTTPREAD: ", NULL, NULL, RESPONSE_OK, RESPONSE_ERROR,
+    "$GP", "$GA", "$GB", "$GN", "$GL", "$BD",
+    "+CMQTTRXSTART: ",
+    "+CMTI: "
+};
+const uint8_t num_patterns = sizeof(patterns) / sizeof(patterns[0]);
+
+// realistic modem output
+const char* chunks[] = {
+    "$GNGGA,120000.00,5130.0000,N,00007.0000,W,1,08,1.0,20.0,M,0.0,M,,*4F\r\n",
+    "$GNRMC,120000.00,A,5130.0000,N,00007.0000,W,0.0,0.0,010125,,,A*6E\r\n",
+    "+CGNSSINFO: 3,10,05,04,5130.000000,N,00007.000000,W,010125,120000.00,20.0,0.0,0.0,1.2,0.9,0.8\r\n",
+    "+HTTPREAD: 64\r\n{\"temperature\":21.5,\"humidity\":40,\"pressure\":1013,\"id\":\"abcd\"}\r\n",
+    "+CMQTTRXTOPIC: 0,10\r\nsome/topic\r\n+CMQTTRXPAYLOAD: 0,5\r\nhello\r\n+CMQTTRXEND: 0\r\n",
+    "OK\r\n"
+};
+const uint8_t num_chunks = sizeof(chunks) / sizeof(chunks[0]);
+
+#define BENCH_REPEAT 200
+
+uint32_t scanWithEndsWith(uint32_t* matches) {
+    ByteRingBuf<256> buf;
+    uint32_t nbytes = 0;
+    uint32_t tstart = micros();
+    for (uint16_t r = 0; r < BENCH_REPEAT; r++) {
+        for (uint8_t c = 0; c < num_chunks; c++) {
+            for (const char* p = chunks[c]; *p != '\0'; p++) {
+                uint8_t val = *p;
+                buf.write(&val, 1);
+                nbytes++;
+                for (uint8_t i = 0; i < num_patterns; i++) {
+                    if (patterns[i] != NULL && buf.endsWith(patterns[i])) {
+                        (*matches)++;
+                        buf.clear();
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    uint32_t elapsed = micros() - tstart;
+    return (elapsed * 1000) / nbytes;
+}
+
+MultiMatcher matcher;
+
+uint32_t scanWithMatcher(uint32_t* matches) {
+    matcher.clear();
+    for (uint8_t i = 0; i < num_patterns; i++) {
+        matcher.add(patterns[i], i);
+    }
+    matcher.compile();
+
+    uint32_t nbytes = 0;
+    uint32_t tstart = micros();
+    for (uint16_t r = 0; r < BENCH_REPEAT; r++) {
+        for (uint8_t c = 0; c < num_chunks; c++) {
+            for (const char* p = chunks[c]; *p != '\0'; p++) {
+                nbytes++;
+                if (matcher.feed(*p) != A76XX_MATCHER_NO_MATCH) {
+                    (*matches)++;
+                    matcher.reset();
+                }
+            }
+        }
+    }
+    uint32_t elapsed = micros() - tstart;
+    return (elapsed * 1000) / nbytes;
+}
+
+void setup() {
+    Serial.begin(115200); delay(5000);
+
+    uint32_t matches_old = 0, matches_new = 0;
+    uint32_t ns_old = scanWithEndsWith(&matches_old);
+    uint32_t ns_new = scanWithMatcher(&matches_new);
+
+    Serial.print("endsWith scan: "); Serial.print(ns_old); Serial.print(" ns/byte, matches: "); Serial.println(matches_old);
+    Serial.print("MultiMatcher:  "); Serial.print(ns_new); Serial.print(" ns/byte, matches: "); Serial.println(matches_new);
+}
+
+void loop() {}
@@ -0,0 +1,77 @@
+// The corpus and the timing helpers shared by the benchmarks in this directory.
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "A76XX.h"
+
+#include <time.h>
+
+// realistic modem output
+const char* chunks[] = {
+    "$GNGGA,120000.00,5130.0000,N,00007.0000,W,1,08,1.0,20.0,M,0.0,M,,*4F\r\n",
+    "$GNRMC,120000.00,A,5130.0000,N,00007.0000,W,0.0,0.0,010125,,,A*6E\r\n",
+    "$GPGSV,3,1,10,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75\r\n",
+    "$GNGSA,A,3,01,02,12,14,,,,,,,,,1.8,1.0,1.5*2E\r\n",
+    "+CGNSSINFO: 3,10,05,04,5130.000000,N,00007.000000,W,010125,120000.00,20.0,0.0,0.0,1.2,0.9,0.8\r\n",
+    "+HTTPREAD: 64\r\n{\"temperature\":21.5,\"humidity\":40,\"pressure\":1013,\"id\":\"abcd\"}\r\n",
+    "+CMQTTRXSTART: 0,10,5\r\n+CMQTTRXTOPIC: 0,10\r\nsome/topic\r\n+CMQTTRXPAYLOAD: 0,5\r\nhello\r\n+CMQTTRXEND: 0\r\n",
+};
+const uint8_t num_chunks = sizeof(chunks) / sizeof(chunks[0]);
+
+// URCs that do not appear in the corpus, so that handlers never fire and only
+// the cost of looking for them is measured
+const char* urcs[] = {
+    "+CMTI: ", "+CMQTTCONNLOST: ", "+CMQTTNONET", "+CGEV: ", "RING\r\n",
+    "NO CARRIER", "+CGREG: ", "+CEREG: ", "+CLCC: ", "+CPIN: N"
+};
+
+#define CORPUS_LEN  (64 * 1024)
+#define MIN_TIME_NS (200 * 1000 * 1000ULL)
+
+char corpus[CORPUS_LEN + 8];
+uint32_t corpus_len = 0;
+
+// the stream for waitResponse: the chunks repeated, then the final result code
+void makeCorpus() {
+    uint8_t c = 0;
+    while (corpus_len + strlen(chunks[c]) < CORPUS_LEN - 4) {
+        strcpy(corpus + corpus_len, chunks[c]);
+        corpus_len += strlen(chunks[c]);
+        c = (c + 1) % num_chunks;
+    }
+    strcpy(corpus + corpus_len, RESPONSE_OK);
+    corpus_len += strlen(RESPONSE_OK);
+}
+
+uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void report(const char* name, uint64_t bytes, uint64_t elapsed_ns) {
+    double ns_per_byte = (double) elapsed_ns / bytes;
+    printf("%-34s %8.2f ns/byte %10.1f MB/s\n", name, ns_per_byte, 1000.0 / ns_per_byte);
+}
+
+// run `fn`, which processes `bytes` bytes per call, for at least MIN_TIME_NS
+template <typename FN>
+void bench(const char* name, uint32_t bytes, FN fn) {
+    fn(); // warm up
+    uint64_t total = 0, tstart = nowNs(), elapsed;
+    do {
+        fn();
+        total += bytes;
+        elapsed = nowNs() - tstart;
+    } while (elapsed < MIN_TIME_NS);
+    report(name, total, elapsed);
+}
+
+class NullHandler : public EventHandler_t {
+  public:
+    NullHandler(const char* match_string) : EventHandler_t(match_string) {}
+    void process(ModemSerial* serial) {}
+};
+
+#endif /* BENCH_H_ */
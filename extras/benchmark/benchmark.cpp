@@ -0,0 +1,318 @@
+// Host benchmark of the parsing hot paths of the library.
+//
+// Build and run with `make run` in this directory. Data from the module is
+// replayed by a ModemSerialMock on a virtual clock, so only the CPU cost of the
+// library is measured, not the serial link. Each result is reported as ns/byte
+// and MB/s: compare the latter with the baud rate / 10 of the UART to get the
+// fraction of CPU time spent parsing at full line rate.
+//
+// A capture recorded with SerialCapture, e.g. on a unit in the field, can be
+// replayed as well with `make run CAPTURE=path/to/capture.bin`.
+//
+// The last result is a whole session, from A76XX::init to a published MQTT
+// message, with the transcript of the host tests in ../tests/scenario.h.
+
+#include "bench.h"
+#include "../tests/scenario.h"
+
+#include <vector>
+
+void benchRingBuf() {
+    ByteRingBuf<256> buf;
+    uint8_t out[256];
+    uint32_t chunks_len = 0;
+    for (uint8_t c = 0; c < num_chunks; c++) chunks_len += strlen(chunks[c]);
+
+    bench("ByteRingBuf::write+read", chunks_len, [&]() {
+        // fill, then drain, one chunk at a time
+        for (uint8_t c = 0; c < num_chunks; c++) {
+            buf.write((uint8_t*) chunks[c], strlen(chunks[c]));
+            buf.read(out, sizeof(out));
+        }
+    });
+
+    bench("ByteRingBuf::write+endsWith", chunks_len, [&]() {
+        for (uint8_t c = 0; c < num_chunks; c++) {
+            for (const char* p = chunks[c]; *p != '\0'; p++) {
+                buf.write((uint8_t*) p, 1);
+                if (buf.endsWith(RESPONSE_OK)) buf.clear();
+            }
+        }
+        buf.clear();
+    });
+
+    // a 2 KB window costs the same per byte as a 256 bytes one
+    static ByteRingBuf<2048> big;
+    bench("ByteRingBuf<2048>::write+endsWith", chunks_len, [&]() {
+        for (uint8_t c = 0; c < num_chunks; c++) {
+            for (const char* p = chunks[c]; *p != '\0'; p++) {
+                big.write((uint8_t*) p, 1);
+                if (big.endsWith(RESPONSE_OK)) big.clear();
+            }
+        }
+        big.clear();
+    });
+}
+
+void benchWaitResponse(uint8_t num_handlers) {
+    ModemSerialMock mock;
+    mock.rx(corpus);
+    NullHandler* handlers[10];
+    for (uint8_t i = 0; i < num_handlers; i++) {
+        handlers[i] = new NullHandler(urcs[i]);
+        mock.registerEventHandler(handlers[i]);
+    }
+
+    // waitResponse overloads are declared in the base class
+    ModemSerial& serial = mock;
+    char name[40];
+    snprintf(name, sizeof(name), "waitResponse, %u handlers", num_handlers);
+    bench(name, corpus_len, [&]() {
+        mock.rewind();
+        if (serial.waitResponse("+CMQTTCONNECT: ", 1000) != Response_t::A76XX_RESPONSE_OK) {
+            printf("unexpected response\n");
+        }
+    });
+
+    for (uint8_t i = 0; i < num_handlers; i++) {
+        delete handlers[i];
+    }
+}
+
+// the corpus read line by line, through the virtual interface of ModemSerial
+// and through the concrete backend type, where each byte costs a direct call
+void benchReadLine() {
+    ModemSerialMock mock;
+    mock.rx(corpus);
+    char line[256];
+
+    ModemSerial& serial = mock;
+    bench("readLine, ModemSerial&", corpus_len, [&]() {
+        mock.rewind();
+        while (readLineFrom(serial, line, sizeof(line), 1000) >= 0) {}
+    });
+    bench("readLine, ModemSerialMock&", corpus_len, [&]() {
+        mock.rewind();
+        while (readLineFrom(mock, line, sizeof(line), 1000) >= 0) {}
+    });
+}
+
+void benchParseNumbers() {
+    static char ints[4096], floats[4096];
+    uint32_t ints_len = 0, floats_len = 0, num = 0;
+    while (ints_len < sizeof(ints) - 16) {
+        ints_len += snprintf(ints + ints_len, 16, "%ld,", (long) (num * 7919) - 5000000);
+        floats_len += snprintf(floats + floats_len, 16, "%.6f,", num * 0.123457 - 60.0);
+        num++;
+    }
+
+    ModemSerialMock mock_int, mock_float;
+    mock_int.rx(ints);
+    mock_float.rx(floats);
+
+    bench("parseInt", ints_len, [&]() {
+        mock_int.rewind();
+        for (uint32_t i = 0; i < num; i++) mock_int.parseInt();
+    });
+    bench("parseFloat", floats_len, [&]() {
+        mock_float.rewind();
+        for (uint32_t i = 0; i < num; i++) mock_float.parseFloat();
+    });
+
+    // the same fields, framed as one line and decoded in place
+    volatile long int_sink;
+    volatile float float_sink;
+    bench("LineTokenizer+toInt", ints_len, [&]() {
+        LineTokenizer fields(ints, ints_len);
+        LineField field;
+        while (fields.next(field)) int_sink = field.toInt();
+    });
+    bench("LineTokenizer+toFloat", floats_len, [&]() {
+        LineTokenizer fields(floats, floats_len);
+        LineField field;
+        while (fields.next(field)) float_sink = field.toFloat();
+    });
+}
+
+// the cost of recording the data received, chunk by chunk as the backends do
+void benchCapture() {
+    static uint8_t ring[16 * 1024];
+    SerialCapture capture(ring, sizeof(ring));
+    bench("SerialCapture::record", corpus_len, [&]() {
+        for (uint32_t pos = 0; pos < corpus_len; pos += A76XX_SERIAL_RX_CHUNK) {
+            uint32_t len = corpus_len - pos < A76XX_SERIAL_RX_CHUNK ? corpus_len - pos : A76XX_SERIAL_RX_CHUNK;
+            capture.record(false, (const uint8_t*) corpus + pos, len);
+        }
+    });
+}
+
+class VectorSink : public CaptureSink {
+  public:
+    std::vector<uint8_t> data;
+    void write(const uint8_t* buf, size_t len) {
+        data.insert(data.end(), buf, buf + len);
+    }
+};
+
+void mqttCallback(MQTTMessage_t* msg) {}
+
+// the data received in a capture, fed to waitResponse with the handlers of the
+// library, regardless of the commands sent
+void benchReplay(const char* name, const std::vector<uint8_t>& trace) {
+    static ModemSerialMock mock;
+    mock.clearSteps();
+    if (!mock.replay(trace.data(), trace.size(), false)) {
+        printf("%-34s capture not valid or too long, see A76XX_MOCK_MAX_STEPS\n", name);
+        return;
+    }
+    uint64_t rx_bytes = 0;
+    CaptureReader reader(trace.data(), trace.size());
+    CaptureRecord_t rec;
+    while (reader.next(rec)) {
+        if (!rec.tx) rx_bytes += rec.len;
+    }
+    if (rx_bytes == 0) {
+        printf("%-34s no data received in the capture\n", name);
+        return;
+    }
+
+    NullHandler* handlers[10];
+    for (uint8_t i = 0; i < 10; i++) {
+        handlers[i] = new NullHandler(urcs[i]);
+        mock.registerEventHandler(handlers[i]);
+    }
+    MQTTOnMessageRx mqtt(mqttCallback);
+    mock.registerEventHandler(&mqtt);
+
+    ModemSerial& serial = mock;
+    bench(name, rx_bytes, [&]() {
+        mock.rewind();
+        while (!mock.done()) {
+            serial.listen(1000);
+        }
+    });
+
+    mock.deRegisterEventHandler(&mqtt);
+    for (uint8_t i = 0; i < 10; i++) {
+        mock.deRegisterEventHandler(handlers[i]);
+        delete handlers[i];
+    }
+}
+
+bool readFile(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), file)) > 0) {
+        data.insert(data.end(), buf, buf + len);
+    }
+    fclose(file);
+    return true;
+}
+
+void benchCoding() {
+    static char input[3 * 1024], output[4 * 1024 + 8];
+    for (uint32_t i = 0; i < sizeof(input); i++) input[i] = (char) (i * 31 + 7);
+    bench("encodeBase64", sizeof(input), [&]() {
+        encodeBase64(input, sizeof(input), output);
+    });
+
+    // a full length SMS: 160 septets packed in 140 bytes
+    uint8_t septets[160], packed[140], unpacked[161];
+    for (uint8_t i = 0; i < 160; i++) septets[i] = 0x20 + (i % 0x5B);
+    bench("pack7Bit", 160, [&]() {
+        pack7Bit(septets, 160, packed);
+    });
+    bench("unpack7Bit", 140, [&]() {
+        unpack7Bit(packed, 160, unpacked);
+    });
+    char decoded[161];
+    bench("decodeGSM", 160, [&]() {
+        decodeGSM(septets, 160, false, decoded);
+    });
+}
+
+void onRoute(const MQTTMessageView_t* msg, void* context) {
+    (*(uint32_t*) context)++;
+}
+
+// the same topic routed among a growing number of filters
+void benchRouter(uint32_t num_filters) {
+    static MQTTRouter router;
+    router = MQTTRouter();
+    uint32_t calls = 0;
+    char filter[32];
+    for (uint32_t i = 0; i < num_filters; i++) {
+        if (i % 2 == 0) {
+            snprintf(filter, sizeof(filter), "devices/%u/cmd/+", (unsigned) i);
+        } else {
+            snprintf(filter, sizeof(filter), "sensors/%u/#", (unsigned) i);
+        }
+        router.add(filter, onRoute, &calls);
+    }
+    MQTTMessageView_t msg;
+    msg.topic = "devices/0/cmd/reboot";
+    msg.topic_len = strlen(msg.topic);
+    msg.payload = (const uint8_t*) "";
+    msg.payload_len = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "MQTTRouter::route, %u filters", (unsigned) num_filters);
+    bench(name, msg.topic_len, [&]() {
+        router.route(msg);
+    });
+}
+
+// the commands and responses of a session, per byte exchanged
+void benchScenario() {
+    static ModemSerialMock mock;
+    static A76XX modem(mock);
+    static A76XXMQTTClient mqtt(modem, "id");
+    uint32_t bytes = scriptScenario(mock);
+    mock.rewind();
+    if (!runScenario(modem, mqtt) || !mock.done()) {
+        printf("%-34s failed: %s\n", "scenario, init to publish", mock.error());
+        return;
+    }
+    bench("scenario, init to publish", bytes, [&]() {
+        mock.rewind();
+        runScenario(modem, mqtt);
+    });
+}
+
+int main(int argc, char** argv) {
+    makeCorpus();
+
+    benchRingBuf();
+    benchWaitResponse(0);
+    benchWaitResponse(5);
+    benchWaitResponse(10);
+    benchReadLine();
+    benchParseNumbers();
+    benchCoding();
+    benchCapture();
+    benchRouter(3);
+    benchRouter(100);
+
+    // the corpus, as the backends would have recorded it
+    VectorSink sink;
+    SerialCapture capture(sink);
+    for (uint32_t pos = 0; pos < corpus_len; pos += A76XX_SERIAL_RX_CHUNK) {
+        uint32_t len = corpus_len - pos < A76XX_SERIAL_RX_CHUNK ? corpus_len - pos : A76XX_SERIAL_RX_CHUNK;
+        capture.record(false, (const uint8_t*) corpus + pos, len);
+    }
+    benchReplay("replay, corpus", sink.data);
+
+    if (argc > 1) {
+        std::vector<uint8_t> trace;
+        if (!readFile(argv[1], trace)) {
+            printf("cannot read %s\n", argv[1]);
+            return 1;
+        }
+        benchReplay("replay, capture", trace);
+    }
+    benchScenario();
+    return 0;
+}
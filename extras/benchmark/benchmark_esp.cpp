@@ -0,0 +1,94 @@
+// Host benchmark of ModemSerialESP, on the driver and FreeRTOS shim in
+// ../esp_host.
+//
+// Build and run with `make run-esp` in this directory. The corpus of
+// benchmark.cpp is received in full before each run, so every call to
+// uart_read_bytes returns at once and what is measured is the cost of the calls
+// into the driver, which on the target also take its lock and compute ticks,
+// plus the parsing. The rows "per byte" replay how waitResponse read the UART
+// before data was staged in bulk: one call to uart_read_bytes per byte, with a
+// deadline computed for each of them, each byte then going through the same
+// matcher and event handlers. Each row also reports the number of
+// driver reads per KB received.
+
+#include "bench.h"
+#include "esp_host.h"
+
+#define PORT 0
+
+// waitResponse as it was, reading the UART one byte at a time: ModemSerialESP
+// fed each byte to the same matcher and registry of event handlers
+Response_t waitResponsePerByte(MultiMatcher& matcher, EventHandlerRegistry& handlers, uint32_t timeout) {
+    TickType_t startTime = xTaskGetTickCount();
+    TickType_t timeoutTicks = pdMS_TO_TICKS(timeout);
+    matcher.reset();
+    uint8_t val;
+
+    while(1) {
+        TickType_t elapsedTime = xTaskGetTickCount() - startTime;
+        if(elapsedTime > timeoutTicks) {
+            return A76XX_RESPONSE_TIMEOUT;
+        }
+        if(uart_read_bytes(PORT, &val, 1, timeoutTicks - elapsedTime) <= 0) {
+            return A76XX_RESPONSE_TIMEOUT;
+        }
+        handlers.feed(val);
+        if(matcher.feed(val) != A76XX_MATCHER_NO_MATCH) {
+            return A76XX_RESPONSE_OK;
+        }
+    }
+}
+
+void benchWaitResponse(uint8_t num_handlers) {
+    static ModemSerialESP serial(PORT);
+    espHostUartSetRx(PORT, corpus, corpus_len);
+    NullHandler* handlers[10];
+    EventHandlerRegistry registry;
+    for (uint8_t i = 0; i < num_handlers; i++) {
+        handlers[i] = new NullHandler(urcs[i]);
+        serial.registerEventHandler(handlers[i]);
+        registry.add(handlers[i]);
+    }
+    MultiMatcher matcher;
+    matcher.add("+CMQTTCONNECT: ", 0);
+    matcher.add(RESPONSE_OK, 3);
+    matcher.add(RESPONSE_ERROR, 4);
+    matcher.compile();
+
+    char name[48];
+    uint32_t reads = espHostUartReads(PORT);
+    uint64_t bytes = 0;
+    snprintf(name, sizeof(name), "waitResponse per byte, %u handlers", num_handlers);
+    bench(name, corpus_len, [&]() {
+        espHostUartRewind(PORT);
+        if (waitResponsePerByte(matcher, registry, 1000) != Response_t::A76XX_RESPONSE_OK) {
+            printf("unexpected response\n");
+        }
+        bytes += corpus_len;
+    });
+    printf("%-34s %8.1f reads/KB\n", "", (espHostUartReads(PORT) - reads) * 1024.0 / bytes);
+
+    reads = espHostUartReads(PORT);
+    bytes = 0;
+    snprintf(name, sizeof(name), "waitResponse, %u handlers", num_handlers);
+    bench(name, corpus_len, [&]() {
+        espHostUartRewind(PORT);
+        if (serial.waitResponse("+CMQTTCONNECT: ", 1000) != Response_t::A76XX_RESPONSE_OK) {
+            printf("unexpected response\n");
+        }
+        bytes += corpus_len;
+    });
+    printf("%-34s %8.1f reads/KB\n", "", (espHostUartReads(PORT) - reads) * 1024.0 / bytes);
+
+    for (uint8_t i = 0; i < num_handlers; i++) {
+        serial.deRegisterEventHandler(handlers[i]);
+        delete handlers[i];
+    }
+}
+
+int main() {
+    makeCorpus();
+    benchWaitResponse(0);
+    benchWaitResponse(10);
+    return 0;
+}
@@ -0,0 +1,322 @@
+#include "esp_host.h"
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
+#include "nvs.h"
+}
+
+#include <string.h>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+static const auto start = std::chrono::steady_clock::now();
+
+static void sleepTicks(TickType_t ticks) {
+    if(ticks > 0 && ticks != portMAX_DELAY) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+    }
+}
+
+// UART driver
+
+struct HostUart {
+    std::mutex     lock;
+    const uint8_t* rx;
+    size_t         rx_len;
+    size_t         rx_pos;
+    uint32_t       reads;
+    size_t         tx_bytes;
+    uint32_t       baud;
+};
+
+static HostUart uarts[UART_NUM_MAX];
+
+static HostUart* getUart(uart_port_t port) {
+    if(port < 0 || port >= UART_NUM_MAX) return NULL;
+    return &uarts[port];
+}
+
+void espHostUartSetRx(uart_port_t port, const void* data, size_t len) {
+    HostUart* uart = getUart(port);
+    std::lock_guard<std::mutex> guard(uart->lock);
+    uart->rx = (const uint8_t*) data;
+    uart->rx_len = len;
+    uart->rx_pos = 0;
+}
+
+void espHostUartRewind(uart_port_t port) {
+    HostUart* uart = getUart(port);
+    std::lock_guard<std::mutex> guard(uart->lock);
+    uart->rx_pos = 0;
+}
+
+uint32_t espHostUartReads(uart_port_t port) {
+    HostUart* uart = getUart(port);
+    std::lock_guard<std::mutex> guard(uart->lock);
+    return uart->reads;
+}
+
+size_t espHostUartTxBytes(uart_port_t port) {
+    HostUart* uart = getUart(port);
+    std::lock_guard<std::mutex> guard(uart->lock);
+    return uart->tx_bytes;
+}
+
+extern "C" {
+
+int uart_read_bytes(uart_port_t port, void* buf, uint32_t len, TickType_t wait) {
+    HostUart* uart = getUart(port);
+    if(uart == NULL) return -1;
+    size_t readLen;
+    {
+        std::lock_guard<std::mutex> guard(uart->lock);
+        uart->reads++;
+        readLen = uart->rx_len - uart->rx_pos;
+        if(readLen > len) readLen = len;
+        if(readLen > 0) {
+            memcpy(buf, uart->rx + uart->rx_pos, readLen);
+            uart->rx_pos += readLen;
+        }
+    }
+    if(readLen == 0) sleepTicks(wait);
+    return readLen;
+}
+
+int uart_write_bytes(uart_port_t port, const void* data, size_t len) {
+    HostUart* uart = getUart(port);
+    if(uart == NULL) return -1;
+    std::lock_guard<std::mutex> guard(uart->lock);
+    uart->tx_bytes += len;
+    return len;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t* len) {
+    HostUart* uart = getUart(port);
+    if(uart == NULL) return ESP_FAIL;
+    std::lock_guard<std::mutex> guard(uart->lock);
+    *len = uart->rx_len - uart->rx_pos;
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t wait) {
+    return getUart(port) == NULL ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t port) {
+    HostUart* uart = getUart(port);
+    if(uart == NULL) return ESP_FAIL;
+    std::lock_guard<std::mutex> guard(uart->lock);
+    uart->rx_pos = uart->rx_len;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud) {
+    HostUart* uart = getUart(port);
+    if(uart == NULL) return ESP_FAIL;
+    std::lock_guard<std::mutex> guard(uart->lock);
+    uart->baud = baud;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t port, uint32_t* baud) {
+    HostUart* uart = getUart(port);
+    if(uart == NULL) return ESP_FAIL;
+    std::lock_guard<std::mutex> guard(uart->lock);
+    *baud = uart->baud ? uart->baud : 115200;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_hw_flow_ctrl(uart_port_t port, uart_hw_flowcontrol_t flow, uint8_t rx_threshold) {
+    return getUart(port) == NULL ? ESP_FAIL : ESP_OK;
+}
+
+// tasks
+
+TickType_t xTaskGetTickCount(void) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return pdMS_TO_TICKS(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sleepTicks(ticks);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    static int task;
+    return &task;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack_size,
+                       void* arg, UBaseType_t priority, TaskHandle_t* handle) {
+    return pdFAIL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack_size,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t task) {}
+
+// semaphores: a count, a mutex is given from the start
+
+static StaticSemaphore_t* createSemaphore(StaticSemaphore_t* sem, int count) {
+    sem->count = count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+    return createSemaphore(new StaticSemaphore_t, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buf) {
+    return createSemaphore(buf, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buf) {
+    return createSemaphore(buf, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    StaticSemaphore_t* s = (StaticSemaphore_t*) sem;
+    if(s->count == 0) {
+        sleepTicks(wait);
+        return pdFALSE;
+    }
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    StaticSemaphore_t* s = (StaticSemaphore_t*) sem;
+    if(s->count > 0) return pdFALSE;
+    s->count++;
+    return pdTRUE;
+}
+
+// there is no other task to hold a mutex
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait) {
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {}
+
+// queues and stream buffers: bytes in a deque
+
+struct HostQueue {
+    std::deque<uint8_t> data;
+    size_t              size;
+    size_t              item_size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return new HostQueue{std::deque<uint8_t>(), (size_t) length * item_size, item_size};
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+    HostQueue* q = (HostQueue*) queue;
+    if(q->data.size() + q->item_size > q->size) {
+        sleepTicks(wait);
+        return pdFALSE;
+    }
+    q->data.insert(q->data.end(), (const uint8_t*) item, (const uint8_t*) item + q->item_size);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+    HostQueue* q = (HostQueue*) queue;
+    if(q->data.empty()) {
+        sleepTicks(wait);
+        return pdFALSE;
+    }
+    std::copy(q->data.begin(), q->data.begin() + q->item_size, (uint8_t*) item);
+    q->data.erase(q->data.begin(), q->data.begin() + q->item_size);
+    return pdTRUE;
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level) {
+    return new HostQueue{std::deque<uint8_t>(), size, 1};
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t stream, const void* data, size_t len, TickType_t wait) {
+    HostQueue* q = (HostQueue*) stream;
+    size_t room = q->size - q->data.size();
+    if(room == 0) {
+        sleepTicks(wait);
+        return 0;
+    }
+    if(len > room) len = room;
+    q->data.insert(q->data.end(), (const uint8_t*) data, (const uint8_t*) data + len);
+    return len;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t stream, void* data, size_t len, TickType_t wait) {
+    HostQueue* q = (HostQueue*) stream;
+    if(q->data.empty()) {
+        sleepTicks(wait);
+        return 0;
+    }
+    if(len > q->data.size()) len = q->data.size();
+    std::copy(q->data.begin(), q->data.begin() + len, (uint8_t*) data);
+    q->data.erase(q->data.begin(), q->data.begin() + len);
+    return len;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t stream) {
+    return ((HostQueue*) stream)->data.size();
+}
+
+// NVS: blobs by namespace and key, all handles share the same ones
+
+static std::map<std::string, std::string> blobs;
+static std::map<nvs_handle_t, std::string> namespaces;
+static nvs_handle_t nextHandle = 1;
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* handle) {
+    *handle = nextHandle++;
+    namespaces[*handle] = name;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* data, size_t len) {
+    if(namespaces.count(handle) == 0) return ESP_FAIL;
+    blobs[namespaces[handle] + "/" + key] = std::string((const char*) data, len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* data, size_t* len) {
+    if(namespaces.count(handle) == 0) return ESP_FAIL;
+    auto it = blobs.find(namespaces[handle] + "/" + key);
+    if(it == blobs.end()) return ESP_FAIL;
+    // without a buffer, the length of the blob is returned
+    if(data == NULL) {
+        *len = it->second.size();
+        return ESP_OK;
+    }
+    if(*len < it->second.size()) return ESP_FAIL;
+    memcpy(data, it->second.data(), it->second.size());
+    *len = it->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return namespaces.count(handle) == 0 ? ESP_FAIL : ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    namespaces.erase(handle);
+}
+
+}
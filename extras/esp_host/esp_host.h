@@ -0,0 +1,52 @@
+/*
+    Host build of the ESP-IDF backend.
+
+    The headers in include/ declare the parts of the UART driver, FreeRTOS and
+    NVS used by ModemSerialESP, PPPSession and MQTTOutboxNVS, and esp_host.cpp
+    implements them on the host, so that the ESP backend can be built and
+    measured under extras/ with:
+
+        -DESP_PLATFORM -I../esp_host/include ../esp_host/esp_host.cpp
+
+    There is a single task: creating another one fails, so the RX task of
+    ModemSerialESP is not started and the application reads the UART itself.
+    Received data is set up front with espHostUartSetRx and is read without
+    copying it into a driver buffer; a read with nothing left waits for the
+    given number of ticks and returns nothing, as with a silent modem. Every
+    driver call takes a lock, as the driver does to access its ring buffer.
+*/
+
+#ifndef ESP_HOST_H_
+#define ESP_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "driver/uart.h"
+}
+
+/*
+    @brief Set the data the UART receives, replacing what is left.
+    @param [IN] port UART port.
+    @param [IN] data Received data, which must stay valid while it is read.
+    @param [IN] len Length of data.
+*/
+void espHostUartSetRx(uart_port_t port, const void* data, size_t len);
+
+/*
+    @brief Receive the data given to espHostUartSetRx again, from its start.
+*/
+void espHostUartRewind(uart_port_t port);
+
+/*
+    @brief Number of calls to uart_read_bytes on the port so far.
+*/
+uint32_t espHostUartReads(uart_port_t port);
+
+/*
+    @brief Number of bytes written to the port so far.
+*/
+size_t espHostUartTxBytes(uart_port_t port);
+
+#endif /* ESP_HOST_H_ */
@@ -0,0 +1,31 @@
+// Host stand-in for the UART driver of ESP-IDF, see extras/esp_host/esp_host.h.
+
+#ifndef ESP_HOST_DRIVER_UART_H_
+#define ESP_HOST_DRIVER_UART_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef int uart_port_t;
+#define UART_NUM_MAX 3
+
+typedef enum {
+    UART_HW_FLOWCTRL_DISABLE = 0,
+    UART_HW_FLOWCTRL_RTS     = 1,
+    UART_HW_FLOWCTRL_CTS     = 2,
+    UART_HW_FLOWCTRL_CTS_RTS = 3,
+} uart_hw_flowcontrol_t;
+
+int uart_read_bytes(uart_port_t port, void* buf, uint32_t len, TickType_t wait);
+int uart_write_bytes(uart_port_t port, const void* data, size_t len);
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t* len);
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t wait);
+esp_err_t uart_flush_input(uart_port_t port);
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud);
+esp_err_t uart_get_baudrate(uart_port_t port, uint32_t* baud);
+esp_err_t uart_set_hw_flow_ctrl(uart_port_t port, uart_hw_flowcontrol_t flow, uint8_t rx_threshold);
+
+#endif /* ESP_HOST_DRIVER_UART_H_ */
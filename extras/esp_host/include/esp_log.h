@@ -0,0 +1,6 @@
+#ifndef ESP_HOST_ESP_LOG_H_
+#define ESP_HOST_ESP_LOG_H_
+
+#include <stdio.h>
+
+#endif /* ESP_HOST_ESP_LOG_H_ */
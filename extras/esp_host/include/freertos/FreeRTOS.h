@@ -0,0 +1,23 @@
+// Host stand-in for the FreeRTOS of ESP-IDF, see extras/esp_host/esp_host.h.
+
+#ifndef ESP_HOST_FREERTOS_H_
+#define ESP_HOST_FREERTOS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+// one tick per millisecond
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+#define pdTICKS_TO_MS(ticks) ((uint32_t) (ticks))
+#define portMAX_DELAY ((TickType_t) 0xFFFFFFFF)
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+
+#endif /* ESP_HOST_FREERTOS_H_ */
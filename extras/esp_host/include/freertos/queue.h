@@ -0,0 +1,12 @@
+#ifndef ESP_HOST_FREERTOS_QUEUE_H_
+#define ESP_HOST_FREERTOS_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+
+#endif /* ESP_HOST_FREERTOS_QUEUE_H_ */
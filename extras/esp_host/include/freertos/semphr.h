@@ -0,0 +1,22 @@
+#ifndef ESP_HOST_FREERTOS_SEMPHR_H_
+#define ESP_HOST_FREERTOS_SEMPHR_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+typedef struct {
+    int count;
+} StaticSemaphore_t;
+
+// with a single task, taking a mutex always succeeds, a binary semaphore only
+// once it has been given
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buf);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buf);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+#endif /* ESP_HOST_FREERTOS_SEMPHR_H_ */
@@ -0,0 +1,13 @@
+#ifndef ESP_HOST_FREERTOS_STREAM_BUFFER_H_
+#define ESP_HOST_FREERTOS_STREAM_BUFFER_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level);
+size_t xStreamBufferSend(StreamBufferHandle_t stream, const void* data, size_t len, TickType_t wait);
+size_t xStreamBufferReceive(StreamBufferHandle_t stream, void* data, size_t len, TickType_t wait);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t stream);
+
+#endif /* ESP_HOST_FREERTOS_STREAM_BUFFER_H_ */
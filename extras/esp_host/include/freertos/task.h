@@ -0,0 +1,22 @@
+#ifndef ESP_HOST_FREERTOS_TASK_H_
+#define ESP_HOST_FREERTOS_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* arg);
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+// there is a single task on the host: creating another one fails
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack_size,
+                       void* arg, UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack_size,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+
+#endif /* ESP_HOST_FREERTOS_TASK_H_ */
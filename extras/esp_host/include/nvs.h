@@ -0,0 +1,19 @@
+#ifndef ESP_HOST_NVS_H_
+#define ESP_HOST_NVS_H_
+
+#include "driver/uart.h"
+
+typedef uint32_t nvs_handle_t;
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+// blobs are kept in memory
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* handle);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* data, size_t len);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* data, size_t* len);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+
+#endif /* ESP_HOST_NVS_H_ */
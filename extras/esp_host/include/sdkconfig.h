@@ -0,0 +1,2 @@
+// Host stand-in for the configuration of ESP-IDF: no lwIP PPP support, so
+// PPPLwIP is left out.
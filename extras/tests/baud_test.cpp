@@ -0,0 +1,173 @@
+// A76XX::negotiateBaudRate on a ModemSerialMock, with a virtual clock: the
+// module refusing a rate, going silent at the new rate and being asked to go
+// back, being lost at both rates and found with detectBaudRate, and RTS/CTS
+// flow control that the host supports but that is not wired.
+
+#include "test.h"
+
+// the client registers its event handlers with the mock for good
+static ModemSerialMock mock;
+static A76XX modem(mock);
+
+static void ok(const char* cmd) {
+    mock.tx(cmd);
+    mock.rx("\r\nOK\r\n");
+}
+
+// the module does not answer any of the probes
+static void silence() {
+    for (int i = 0; i < A76XX_BAUD_PROBE_ATTEMPTS; i++) {
+        mock.tx("AT\r\n");
+    }
+}
+
+// the host does not know the rate, the module is at 115200
+static void currentRate() {
+    mock.tx("AT+IPR?\r\n");
+    mock.rx("\r\n+IPR: 115200\r\n\r\nOK\r\n");
+}
+
+// a rate is tried on the host, then set back for AT+IPR
+static void tryRate(uint32_t baud) {
+    mock.baudRate(baud);
+    mock.baudRate(115200);
+}
+
+static void checkDone() {
+    CHECK(mock.done());
+    if (!mock.done()) {
+        printf("  %s\n", mock.error());
+    }
+}
+
+static void testRefused() {
+    mock.clearSteps();
+    currentRate();
+    static const char* const cmds[] = {"AT+IPR=921600\r\n", "AT+IPR=460800\r\n", "AT+IPR=230400\r\n"};
+    static const uint32_t rates[] = {921600, 460800, 230400};
+    for (int i = 0; i < 3; i++) {
+        tryRate(rates[i]);
+        mock.tx(cmds[i]);
+        mock.rx("\r\nERROR\r\n");
+        ok("AT\r\n");
+    }
+
+    CHECK(modem.negotiateBaudRate(921600, false) == 115200);
+    CHECK(modem.getLastError() == A76XX_OPERATION_SUCCEEDED);
+    CHECK(mock.getBaudRate() == 115200);
+    checkDone();
+}
+
+static void testRevert() {
+    mock.clearSteps();
+    currentRate();
+    // silent at 921600, asked to go back without waiting for its answer
+    tryRate(921600);
+    ok("AT+IPR=921600\r\n");
+    mock.baudRate(921600);
+    silence();
+    mock.tx("AT+IPR=115200\r\n");
+    mock.baudRate(115200);
+    ok("AT\r\n");
+    // then fine at 460800
+    tryRate(460800);
+    ok("AT+IPR=460800\r\n");
+    mock.baudRate(460800);
+    ok("AT\r\n");
+
+    CHECK(modem.negotiateBaudRate(921600, false) == 460800);
+    CHECK(modem.getLastError() == A76XX_OPERATION_SUCCEEDED);
+    CHECK(mock.getBaudRate() == 460800);
+    checkDone();
+}
+
+static void testDetect() {
+    mock.clearSteps();
+    currentRate();
+    // the module switched but did not take the way back
+    tryRate(921600);
+    ok("AT+IPR=921600\r\n");
+    mock.baudRate(921600);
+    silence();
+    mock.tx("AT+IPR=115200\r\n");
+    mock.baudRate(115200);
+    silence();
+    // found with detectBaudRate, the host not supporting one of the rates tried
+    mock.baudRate(115200);
+    silence();
+    mock.baudRate(3686400, false);
+    mock.baudRate(921600);
+    ok("AT\r\n");
+    ok("AT+IPREX=921600\r\n");
+
+    CHECK(modem.negotiateBaudRate(921600, false, true) == 921600);
+    CHECK(modem.getLastError() == A76XX_OPERATION_SUCCEEDED);
+    CHECK(mock.getBaudRate() == 921600);
+    checkDone();
+
+    // lost at every rate
+    mock.clearSteps();
+    currentRate();
+    tryRate(230400);
+    ok("AT+IPR=230400\r\n");
+    mock.baudRate(230400);
+    silence();
+    mock.tx("AT+IPR=115200\r\n");
+    mock.baudRate(115200);
+    silence();
+    static const uint32_t rates[] = {115200, 3686400, 921600, 460800, 230400, 3200000,
+                                     3000000, 57600, 38400, 19200, 9600};
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        mock.baudRate(rates[i], false);
+    }
+
+    CHECK(modem.negotiateBaudRate(230400, false) == 0);
+    CHECK(modem.getLastError() == A76XX_OPERATION_TIMEDOUT);
+    checkDone();
+}
+
+static void testFlowControl() {
+    // the host enables RTS/CTS but the lines are not wired: the module stops
+    // answering and flow control is disabled on both sides
+    mock.clearSteps();
+    currentRate();
+    ok("AT+IFC=2,2\r\n");
+    mock.hardwareFlowControl(true);
+    silence();
+    mock.hardwareFlowControl(false);
+    mock.tx("AT+IFC=0,0\r\n");
+    ok("AT\r\n");
+
+    CHECK(modem.negotiateBaudRate(115200, true) == 115200);
+    CHECK(modem.getLastError() == A76XX_OPERATION_SUCCEEDED);
+    checkDone();
+
+    // the host cannot enable it: the module is told to disable it again
+    mock.clearSteps();
+    currentRate();
+    ok("AT+IFC=2,2\r\n");
+    mock.hardwareFlowControl(true, false);
+    ok("AT+IFC=0,0\r\n");
+
+    CHECK(modem.negotiateBaudRate(115200, true) == 115200);
+    checkDone();
+}
+
+static void testDeviation() {
+    // a change of rate not in the transcript is reported
+    mock.clearSteps();
+    currentRate();
+    mock.baudRate(460800);
+    CHECK(modem.negotiateBaudRate(921600, false) == 0);
+    CHECK(!mock.done());
+    CHECK(strstr(mock.error(), "unexpected baud rate in step 2: 921600") != NULL);
+}
+
+int main() {
+    testRefused();
+    testRevert();
+    testDetect();
+    testFlowControl();
+    testDeviation();
+    return report("baud_test");
+}
@@ -0,0 +1,459 @@
+// CMUX connected through a socket pair to a software module, which decodes the
+// frames it receives and answers them as 3GPP TS 27.010 says, independently of
+// the implementation of the library. The test sends frames of its own through
+// the module: split, long, corrupted, and those of flow control.
+
+#include "test.h"
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define FLAG  0xF9
+#define EA    0x01
+#define CR    0x02
+#define PF    0x10
+#define SABM  0x2F
+#define UA    0x63
+#define DM    0x0F
+#define DISC  0x43
+#define UIH   0xEF
+
+#define MSG_CLD   0xC1
+#define MSG_FCON  0xA1
+#define MSG_FCOFF 0x61
+#define MSG_MSC   0xE1
+
+// flow control bit of the V.24 signals of MSC
+#define V24_FC    0x02
+
+#define FRAME_SIZE 300
+
+struct Frame {
+    uint8_t              dlci;
+    uint8_t              ctrl;
+    bool                   cr;
+    bool           long_length;
+    std::vector<uint8_t> data;
+
+    // the type of the message of the control channel, without the C/R bit
+    uint8_t type() const {
+        return data.empty() ? 0 : data[0] & ~CR;
+    }
+
+    bool command() const {
+        return !data.empty() && (data[0] & CR);
+    }
+};
+
+static uint8_t fcs(const uint8_t* data, size_t len) {
+    uint8_t crc = 0xFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xE0 : crc >> 1;
+        }
+    }
+    return 0xFF - crc;
+}
+
+// encode a frame of the module, which is not the initiator
+static std::vector<uint8_t> encode(uint8_t dlci, uint8_t ctrl, bool command,
+                                   const void* data, size_t len, bool corrupt = false) {
+    std::vector<uint8_t> frame;
+    frame.push_back(FLAG);
+    frame.push_back((dlci << 2) | (command ? 0 : CR) | EA);
+    frame.push_back(ctrl);
+    if (len > 127) {
+        frame.push_back((len << 1) & 0xFE);
+        frame.push_back(len >> 7);
+    } else {
+        frame.push_back((len << 1) | EA);
+    }
+    uint8_t check = fcs(frame.data() + 1, frame.size() - 1);
+    frame.insert(frame.end(), (const uint8_t*) data, (const uint8_t*) data + len);
+    if ((ctrl & ~PF) != UIH) {
+        check = fcs(frame.data() + 1, frame.size() - 1);
+    }
+    frame.push_back(corrupt ? check ^ 0x55 : check);
+    frame.push_back(FLAG);
+    return frame;
+}
+
+static std::vector<uint8_t> encodeControl(uint8_t type, const uint8_t* values, size_t len) {
+    std::vector<uint8_t> msg;
+    msg.push_back(type);
+    msg.push_back((len << 1) | EA);
+    msg.insert(msg.end(), values, values + len);
+    return encode(0, UIH, true, msg.data(), msg.size());
+}
+
+class Module {
+  public:
+    explicit Module(int fd)
+        : _fd(fd)
+        , _running(true)
+        , _refused(0xFF)
+        , _bad(0)
+        , _thread(&Module::run, this) {}
+
+    ~Module() {
+        _running = false;
+        _thread.join();
+    }
+
+    void send(const std::vector<uint8_t>& bytes) {
+        std::lock_guard<std::mutex> lock(_tx);
+        writeAll(_fd, bytes.data(), bytes.size());
+    }
+
+    void sendData(uint8_t dlci, const void* data, size_t len, bool corrupt = false) {
+        send(encode(dlci, UIH, true, data, len, corrupt));
+    }
+
+    void sendControl(uint8_t type, const uint8_t* values = NULL, size_t len = 0) {
+        send(encodeControl(type, values, len));
+    }
+
+    void sendMSC(uint8_t dlci, bool flow_stop) {
+        uint8_t values[2] = {(uint8_t) ((dlci << 2) | CR | EA), (uint8_t) (0x8D | (flow_stop ? V24_FC : 0))};
+        sendControl(MSG_MSC | CR, values, 2);
+    }
+
+    // answer SABM on this DLCI with DM, none at first
+    void refuse(uint8_t dlci) {
+        _refused = dlci;
+    }
+
+    // the frames received so far
+    std::vector<Frame> frames() {
+        std::lock_guard<std::mutex> lock(_rx);
+        return _frames;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_rx);
+        _frames.clear();
+    }
+
+    // wait for a frame matching `pred`
+    template <typename PRED>
+    bool waitFrame(PRED pred, Frame* out = NULL, uint32_t timeout = 1000) {
+        uint32_t start = millis();
+        do {
+            std::vector<Frame> all = frames();
+            for (size_t i = 0; i < all.size(); i++) {
+                if (pred(all[i])) {
+                    if (out != NULL) {
+                        *out = all[i];
+                    }
+                    return true;
+                }
+            }
+            delay(2);
+        } while (millis() - start < timeout);
+        return false;
+    }
+
+    uint32_t badFrames() {
+        return _bad;
+    }
+
+  private:
+    int                   _fd;
+    std::atomic<bool>     _running;
+    std::atomic<uint8_t>  _refused;
+    std::atomic<uint32_t> _bad;
+    std::mutex            _tx;
+    std::mutex            _rx;
+    std::vector<Frame>    _frames;
+    std::thread           _thread;
+
+    void answer(const Frame& frame) {
+        uint8_t ctrl = frame.ctrl & ~PF;
+        if (ctrl == SABM) {
+            send(encode(frame.dlci, (frame.dlci == _refused ? DM : UA) | PF, false, NULL, 0));
+        } else if (ctrl == DISC) {
+            send(encode(frame.dlci, UA | PF, false, NULL, 0));
+        } else if (ctrl == UIH && frame.dlci == 0 && frame.command()) {
+            // commands of the control channel are answered with the same values
+            std::vector<uint8_t> msg(frame.data);
+            msg[0] &= ~CR;
+            send(encode(0, UIH, true, msg.data(), msg.size()));
+        }
+    }
+
+    // check and answer a frame, from its address to its FCS
+    void decode(const std::vector<uint8_t>& raw, size_t header_len) {
+        Frame frame;
+        frame.dlci = raw[0] >> 2;
+        frame.cr = raw[0] & CR;
+        frame.ctrl = raw[1];
+        frame.long_length = header_len == 4;
+        size_t len = raw.size() - header_len - 1;
+        size_t covered = (frame.ctrl & ~PF) == UIH ? header_len : header_len + len;
+        if (fcs(raw.data(), covered) != raw.back()) {
+            _bad++;
+            return;
+        }
+        frame.data.assign(raw.begin() + header_len, raw.end() - 1);
+        {
+            std::lock_guard<std::mutex> lock(_rx);
+            _frames.push_back(frame);
+        }
+        answer(frame);
+    }
+
+    void run() {
+        // frames are delimited by their length, as flags are not escaped in the data
+        std::vector<uint8_t> raw;
+        size_t header_len = 0, len = 0;
+        bool in_frame = false;
+        while (_running) {
+            struct pollfd pfd = {_fd, POLLIN, 0};
+            uint8_t buf[512];
+            if (::poll(&pfd, 1, 10) <= 0) {
+                continue;
+            }
+            ssize_t n = ::read(_fd, buf, sizeof(buf));
+            for (ssize_t i = 0; i < n; i++) {
+                uint8_t c = buf[i];
+                if (!in_frame) {
+                    in_frame = c == FLAG;
+                    raw.clear();
+                    header_len = 0;
+                    continue;
+                }
+                // the closing flag of a frame, or the opening flag of the next
+                if (raw.empty() && c == FLAG) {
+                    continue;
+                }
+                if (header_len > 0 && raw.size() == header_len + len + 1) {
+                    if (c == FLAG) {
+                        decode(raw, header_len);
+                    } else {
+                        _bad++;
+                        in_frame = false;
+                    }
+                    raw.clear();
+                    header_len = 0;
+                    continue;
+                }
+                raw.push_back(c);
+                if (raw.size() == 3 && (c & EA)) {
+                    header_len = 3;
+                    len = c >> 1;
+                } else if (raw.size() == 4 && header_len == 0) {
+                    header_len = 4;
+                    len = (raw[2] >> 1) | ((size_t) c << 7);
+                }
+            }
+        }
+    }
+};
+
+static bool isControl(const Frame& f, uint8_t type, bool command) {
+    return f.dlci == 0 && (f.ctrl & ~PF) == UIH && f.type() == type && f.command() == command;
+}
+
+static void testOpen(CMUX& mux, Module& module) {
+    CHECK(mux.openChannel(1) == A76XX_GENERIC_ERROR);
+    CHECK(mux.begin() == A76XX_OPERATION_SUCCEEDED);
+    CHECK(mux.isActive());
+
+    Frame frame;
+    CHECK(module.waitFrame([](const Frame& f) { return f.dlci == 0 && f.ctrl == (SABM | PF); }, &frame));
+    // a command of the initiator
+    CHECK(frame.cr);
+
+    CHECK(mux.openChannel(1) == A76XX_OPERATION_SUCCEEDED);
+    CHECK(mux.openChannel(2) == A76XX_OPERATION_SUCCEEDED);
+    CHECK(mux.channel(1)->isOpen() && mux.channel(2)->isOpen());
+    CHECK(module.waitFrame([](const Frame& f) { return f.dlci == 2 && f.ctrl == (SABM | PF); }));
+
+    // then tells the module it is ready, without stopping it
+    CHECK(module.waitFrame([&](const Frame& f) {
+        return isControl(f, MSG_MSC, true) && f.data.size() == 4 && f.data[2] >> 2 == 1 && !(f.data[3] & V24_FC);
+    }));
+
+    module.refuse(3);
+    CHECK(mux.openChannel(3) == A76XX_GENERIC_ERROR);
+    CHECK(!mux.channel(3)->isOpen());
+    CHECK(mux.openChannel(A76XX_CMUX_CHANNELS + 1) == A76XX_GENERIC_ERROR);
+}
+
+static void testSplitFrames(CMUX& mux, Module& module) {
+    CMUXChannel& at = *mux.channel(1);
+
+    // a frame in three writes, then two frames in a single write
+    std::vector<uint8_t> frame = encode(1, UIH, true, "\r\n+CSQ: 23,99\r\n", 15);
+    std::thread writer([&]() {
+        module.send(std::vector<uint8_t>(frame.begin(), frame.begin() + 2));
+        delay(20);
+        module.send(std::vector<uint8_t>(frame.begin() + 2, frame.begin() + 9));
+        delay(20);
+        module.send(std::vector<uint8_t>(frame.begin() + 9, frame.end()));
+        std::vector<uint8_t> two = encode(1, UIH, true, "\r\nOK", 4);
+        std::vector<uint8_t> second = encode(1, UIH, true, "\r\n", 2);
+        two.insert(two.end(), second.begin(), second.end());
+        module.send(two);
+    });
+    CHECK(at.waitResponse("+CSQ: ") == Response_t::A76XX_RESPONSE_MATCH_1ST);
+    CHECK(at.parseInt() == 23);
+    CHECK(at.parseInt() == 99);
+    CHECK(at.waitResponse() == Response_t::A76XX_RESPONSE_OK);
+    writer.join();
+
+    // the AT commands sent in frames of their own
+    at.write("AT\r\n");
+    Frame sent;
+    CHECK(module.waitFrame([](const Frame& f) { return f.dlci == 1 && (f.ctrl & ~PF) == UIH; }, &sent));
+    CHECK(sent.data.size() == 4 && memcmp(sent.data.data(), "AT\r\n", 4) == 0);
+}
+
+static void testLongFrames(CMUX& mux, Module& module) {
+    CMUXChannel& data = *mux.channel(2);
+    uint8_t out[FRAME_SIZE], in[FRAME_SIZE];
+    for (int i = 0; i < FRAME_SIZE; i++) {
+        out[i] = i % 0xF0;
+    }
+
+    // received, with a length field of two bytes
+    module.sendData(2, out, FRAME_SIZE);
+    CHECK(data.readBytes(in, FRAME_SIZE) == FRAME_SIZE);
+    CHECK(memcmp(in, out, FRAME_SIZE) == 0);
+
+    // sent in a single frame
+    module.clear();
+    CHECK(data.write((const char*) out, FRAME_SIZE) == FRAME_SIZE);
+    Frame frame;
+    CHECK(module.waitFrame([](const Frame& f) { return f.dlci == 2 && (f.ctrl & ~PF) == UIH; }, &frame));
+    CHECK(frame.long_length);
+    CHECK(frame.data.size() == FRAME_SIZE && memcmp(frame.data.data(), out, FRAME_SIZE) == 0);
+    CHECK(module.badFrames() == 0);
+
+    // longer than A76XX_CMUX_FRAME_SIZE: dropped
+    uint32_t errors = mux.frameErrors();
+    static uint8_t huge[A76XX_CMUX_FRAME_SIZE + 1];
+    module.sendData(2, huge, sizeof(huge));
+    module.sendData(2, "next", 4);
+    CHECK(data.readBytes(in, 4) == 4 && memcmp(in, "next", 4) == 0);
+    CHECK(mux.frameErrors() > errors);
+    CHECK(data.available() == 0);
+}
+
+static void testBadFCS(CMUX& mux, Module& module) {
+    CMUXChannel& at = *mux.channel(1);
+    char line[32];
+    uint32_t errors = mux.frameErrors();
+    module.sendData(1, "bad\r\n", 5, true);
+    module.sendData(1, "good\r\n", 6);
+    CHECK(at.readLine(line, sizeof(line)) == 4);
+    CHECK(strcmp(line, "good") == 0);
+    CHECK(mux.frameErrors() == errors + 1);
+    CHECK(at.available() == 0);
+}
+
+static void testFlowControl(CMUX& mux, Module& module) {
+    CMUXChannel& at = *mux.channel(1);
+    CMUXChannel& data = *mux.channel(2);
+
+    // the module stops channel 1 with MSC, and lets it go 200 ms later
+    module.clear();
+    module.sendMSC(1, true);
+    at.waitAvailable(50);
+    // the command is answered with the same values
+    CHECK(module.waitFrame([](const Frame& f) {
+        return isControl(f, MSG_MSC, false) && f.data.size() == 4 && (f.data[3] & V24_FC);
+    }));
+    std::thread resume([&]() {
+        delay(200);
+        module.sendMSC(1, false);
+    });
+    uint32_t start = millis();
+    CHECK(at.write("AT\r\n") == 4);
+    uint32_t elapsed = millis() - start;
+    CHECK(elapsed >= 150 && elapsed < 1000);
+    resume.join();
+
+    // likewise for all channels with FCOFF, then FCON
+    module.sendControl(MSG_FCOFF | CR);
+    at.waitAvailable(50);
+    CHECK(module.waitFrame([](const Frame& f) { return isControl(f, MSG_FCOFF, false); }));
+    std::thread resume_all([&]() {
+        delay(200);
+        module.sendControl(MSG_FCON | CR);
+    });
+    start = millis();
+    CHECK(data.write("x", 1) == 1);
+    elapsed = millis() - start;
+    CHECK(elapsed >= 150 && elapsed < 1000);
+    resume_all.join();
+
+    // the module fills channel 2 while nobody reads it: we ask it to stop
+    module.clear();
+    static uint8_t block[200];
+    memset(block, 'd', sizeof(block));
+    for (int i = 0; i < 4; i++) {
+        module.sendData(2, block, sizeof(block));
+    }
+    at.waitAvailable(100);
+    CHECK(module.waitFrame([](const Frame& f) {
+        return isControl(f, MSG_MSC, true) && f.data[2] >> 2 == 2 && (f.data[3] & V24_FC);
+    }));
+    // the module echoes our MSC, flow control bit included, which must not
+    // stop our own writes
+    at.waitAvailable(50);
+    start = millis();
+    CHECK(data.write("y", 1) == 1);
+    CHECK(millis() - start < 100);
+
+    // and to go on once the data has been read
+    uint8_t in[sizeof(block)];
+    for (int i = 0; i < 4; i++) {
+        CHECK(data.readBytes(in, sizeof(in)) == sizeof(in));
+    }
+    CHECK(module.waitFrame([](const Frame& f) {
+        return isControl(f, MSG_MSC, true) && f.data[2] >> 2 == 2 && !(f.data[3] & V24_FC);
+    }));
+    CHECK(data.rxOverflows() == 0);
+}
+
+static void testClose(CMUX& mux, Module& module) {
+    CHECK(mux.closeChannel(2) == A76XX_OPERATION_SUCCEEDED);
+    CHECK(!mux.channel(2)->isOpen());
+    CHECK(module.waitFrame([](const Frame& f) { return f.dlci == 2 && f.ctrl == (DISC | PF); }));
+
+    module.clear();
+    CHECK(mux.end() == A76XX_OPERATION_SUCCEEDED);
+    CHECK(!mux.isActive());
+    CHECK(!mux.channel(1)->isOpen());
+    CHECK(module.waitFrame([](const Frame& f) { return f.dlci == 1 && f.ctrl == (DISC | PF); }));
+    CHECK(module.waitFrame([](const Frame& f) { return isControl(f, MSG_CLD, true); }));
+    CHECK(module.badFrames() == 0);
+}
+
+int main() {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        printf("cannot create a socket pair\n");
+        return 1;
+    }
+    ModemSerialPosix serial(sv[0]);
+    CMUX mux(serial, true, FRAME_SIZE);
+    {
+        Module module(sv[1]);
+        testOpen(mux, module);
+        testSplitFrames(mux, module);
+        testLongFrames(mux, module);
+        testBadFCS(mux, module);
+        testFlowControl(mux, module);
+        testClose(mux, module);
+    }
+    close(sv[0]);
+    close(sv[1]);
+    return report("cmux_test");
+}
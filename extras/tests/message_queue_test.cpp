@@ -0,0 +1,171 @@
+// MQTTMessageQueue: records wrapping around the end of the ring, messages
+// dropped for lack of room, the writer starting over at 0 in an empty ring, and
+// a writer and a reader running in two threads.
+
+#include "test.h"
+
+#include <atomic>
+#include <thread>
+
+// a message whose topic is its number and whose payload is derived from it
+static bool push(MQTTMessageQueue& queue, uint32_t n, size_t payload_len) {
+    char topic[16];
+    snprintf(topic, sizeof(topic), "%u", (unsigned) n);
+    static uint8_t payload[4096];
+    for (size_t i = 0; i < payload_len; i++) {
+        payload[i] = (uint8_t) (n + i);
+    }
+    uint32_t dropped = queue.dropped();
+    queue.begin(strlen(topic), payload_len);
+    queue.topic((const uint8_t*) topic, strlen(topic));
+    // in two pieces, as the module sends long payloads
+    queue.payload(payload, payload_len / 2);
+    queue.payload(payload + payload_len / 2, payload_len - payload_len / 2);
+    queue.end(true);
+    return queue.dropped() == dropped;
+}
+
+// the oldest message is message n, intact
+static bool pop(MQTTMessageQueue& queue, uint32_t n, size_t payload_len) {
+    MQTTMessageView_t msg;
+    if (!queue.peek(msg)) {
+        return false;
+    }
+    char topic[16];
+    snprintf(topic, sizeof(topic), "%u", (unsigned) n);
+    bool same = msg.topic_len == strlen(topic) && strcmp(msg.topic, topic) == 0
+             && msg.payload_len == payload_len && msg.payload[payload_len] == '\0';
+    for (size_t i = 0; same && i < payload_len; i++) {
+        same = msg.payload[i] == (uint8_t) (n + i);
+    }
+    queue.release();
+    return same;
+}
+
+static void testWrap() {
+    static uint8_t buf[1024];
+    MQTTMessageQueue queue(buf, sizeof(buf));
+
+    // records of 100 bytes or so, five of them in the ring, go around it many times
+    uint32_t written = 0, read = 0;
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < (round == 0 ? 5 : 2); i++) {
+            CHECK(push(queue, written, 80 + written % 7));
+            written++;
+        }
+        CHECK(queue.available() == written - read);
+        for (int i = 0; i < 2; i++) {
+            CHECK(pop(queue, read, 80 + read % 7));
+            read++;
+        }
+    }
+    while (read < written) {
+        CHECK(pop(queue, read, 80 + read % 7));
+        read++;
+    }
+    MQTTMessageView_t msg;
+    CHECK(!queue.peek(msg));
+    CHECK(queue.dropped() == 0);
+}
+
+static void testDrop() {
+    static uint8_t buf[1024];
+    MQTTMessageQueue queue(buf, sizeof(buf));
+
+    // the ring is full
+    CHECK(push(queue, 0, 400));
+    CHECK(push(queue, 1, 400));
+    CHECK(!push(queue, 2, 400));
+    CHECK(queue.dropped() == 1);
+    // never fits
+    CHECK(!push(queue, 3, 2000));
+    // not received entirely
+    queue.begin(1, 10);
+    queue.topic((const uint8_t*) "x", 1);
+    queue.end(false);
+    CHECK(queue.dropped() == 3);
+
+    // the messages before the drops are intact, and the room they leave is used
+    CHECK(pop(queue, 0, 400));
+    CHECK(push(queue, 4, 300));
+    CHECK(pop(queue, 1, 400));
+    CHECK(pop(queue, 4, 300));
+    CHECK(queue.available() == 0);
+}
+
+static void testRestart() {
+    static uint8_t buf[1024];
+    MQTTMessageQueue queue(buf, sizeof(buf));
+
+    // once empty, a message longer than what is left after the old position fits
+    CHECK(push(queue, 0, 600));
+    CHECK(pop(queue, 0, 600));
+    for (uint32_t n = 1; n < 5; n++) {
+        CHECK(push(queue, n, 700));
+        CHECK(pop(queue, n, 700));
+    }
+
+    // the writer restarts before the reader looks, then writes after the restart
+    CHECK(push(queue, 5, 300));
+    CHECK(pop(queue, 5, 300));
+    CHECK(push(queue, 6, 700));
+    CHECK(push(queue, 7, 100));
+    CHECK(!push(queue, 8, 700));
+    CHECK(pop(queue, 6, 700));
+    CHECK(pop(queue, 7, 100));
+
+    // a message dropped after the restart leaves the queue usable
+    CHECK(push(queue, 9, 200));
+    CHECK(pop(queue, 9, 200));
+    queue.begin(2, 700);
+    queue.end(false);
+    CHECK(push(queue, 10, 700));
+    CHECK(pop(queue, 10, 700));
+    CHECK(queue.available() == 0);
+    CHECK(queue.dropped() == 2);
+}
+
+static void testThreads() {
+    static uint8_t buf[4096];
+    MQTTMessageQueue queue(buf, sizeof(buf));
+    const uint32_t count = 200000;
+
+    // the reader checks every message, those dropped are skipped
+    std::atomic<bool> writing(true);
+    std::atomic<uint32_t> corrupted(0), received(0);
+    std::thread reader([&]() {
+        uint32_t next = 0;
+        MQTTMessageView_t msg;
+        while (writing || queue.available() > 0) {
+            if (!queue.peek(msg)) {
+                continue;
+            }
+            uint32_t n = strtoul(msg.topic, NULL, 10);
+            bool same = n >= next && msg.payload_len == n % 3000;
+            for (size_t i = 0; same && i < msg.payload_len; i++) {
+                same = msg.payload[i] == (uint8_t) (n + i);
+            }
+            if (!same) {
+                corrupted++;
+            }
+            next = n + 1;
+            received++;
+            queue.release();
+        }
+    });
+    for (uint32_t n = 0; n < count; n++) {
+        push(queue, n, n % 3000);
+    }
+    writing = false;
+    reader.join();
+    CHECK(corrupted == 0);
+    CHECK(received + queue.dropped() == count);
+}
+
+int main() {
+    testWrap();
+    testDrop();
+    testRestart();
+    testThreads();
+    return report("message_queue_test");
+}
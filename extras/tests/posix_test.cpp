@@ -0,0 +1,202 @@
+// ModemSerialPosix on a pseudo-terminal, with the module played by a thread
+// answering commands from a script.
+
+#include "test.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+static int master = -1;
+static std::atomic<bool> running(true);
+// bytes sent by the module, to check the metrics of the backend, counted
+// before they are written so that the reader never gets ahead of the count
+static std::atomic<uint32_t> sent(0);
+
+#define BULK_LEN 20000
+
+static void say(const char* str) {
+    sent += strlen(str);
+    writeAll(master, str);
+}
+
+static void answer(const std::string& line) {
+    if (line == "AT") {
+        say("\r\nOK\r\n");
+    } else if (line == "AT+CSQ") {
+        say("\r\n+CSQ: 23,99\r\n\r\nOK\r\n");
+    } else if (line == "AT+SPLIT") {
+        // a response in two writes, the second after a pause
+        say("\r\n+SPLIT: 12");
+        delay(150);
+        say("34,\"text\"\r\n\r\nOK\r\n");
+    } else if (line == "AT+BULK") {
+        // the start of the data comes with OK, the rest is read straight from
+        // the descriptor by readBytes
+        static char data[BULK_LEN];
+        for (int i = 0; i < BULK_LEN; i++) {
+            data[i] = (char) (i % 251);
+        }
+        say("\r\nOK\r\n");
+        sent += BULK_LEN;
+        writeAll(master, data, BULK_LEN);
+    } else if (line == "AT+STALE") {
+        // left unread when the baud rate changes
+        say("\r\nstale\r\n");
+    } else if (line == "AT+MUTE") {
+        // never answered
+    } else {
+        say("\r\nERROR\r\n");
+    }
+}
+
+static void module() {
+    std::string line;
+    char c;
+    while (running) {
+        struct pollfd pfd = {master, POLLIN, 0};
+        if (::poll(&pfd, 1, 10) <= 0 || ::read(master, &c, 1) != 1) {
+            continue;
+        }
+        if (c == '\r') {
+            answer(line);
+            line.clear();
+        } else if (c != '\n') {
+            line += c;
+        }
+    }
+}
+
+static void testBufferedReads(ModemSerialPosix& serial) {
+    serial.sendCMD("AT");
+    CHECK(serial.waitResponse() == Response_t::A76XX_RESPONSE_OK);
+
+    serial.sendCMD("AT+CSQ");
+    CHECK(serial.waitResponse("+CSQ: ") == Response_t::A76XX_RESPONSE_MATCH_1ST);
+    CHECK(serial.parseInt() == 23);
+    CHECK(serial.parseInt() == 99);
+    CHECK(serial.waitResponse() == Response_t::A76XX_RESPONSE_OK);
+
+    // a number and a line spanning two reads of the descriptor
+    serial.sendCMD("AT+SPLIT");
+    CHECK(serial.waitResponse("+SPLIT: ") == Response_t::A76XX_RESPONSE_MATCH_1ST);
+    CHECK(serial.parseInt() == 1234);
+    CHECK(serial.find(','));
+    char line[32];
+    CHECK(serial.readLine(line, sizeof(line)) == 6);
+    CHECK(strcmp(line, "\"text\"") == 0);
+    CHECK(serial.waitResponse() == Response_t::A76XX_RESPONSE_OK);
+
+    // the bytes staged in the ring buffer, then those read directly
+    static char data[BULK_LEN];
+    serial.sendCMD("AT+BULK");
+    CHECK(serial.waitResponse() == Response_t::A76XX_RESPONSE_OK);
+    CHECK(serial.readBytes(data, BULK_LEN) == BULK_LEN);
+    bool same = true;
+    for (int i = 0; i < BULK_LEN; i++) {
+        same = same && data[i] == (char) (i % 251);
+    }
+    CHECK(same);
+    CHECK(serial.rxOverflows() == 0);
+#if A76XX_ENABLE_METRICS
+    CHECK(serial.metrics().rx_bytes == sent);
+#endif
+}
+
+static void testTimeouts(ModemSerialPosix& serial) {
+    uint32_t start = millis();
+    CHECK(!serial.waitAvailable(100));
+    uint32_t elapsed = millis() - start;
+    CHECK(elapsed >= 100 && elapsed < 200);
+
+    serial.sendCMD("AT+MUTE");
+    start = millis();
+    CHECK(serial.waitResponse(200) == Response_t::A76XX_RESPONSE_TIMEOUT);
+    elapsed = millis() - start;
+    CHECK(elapsed >= 200 && elapsed < 300);
+
+    // poll never blocks, the command times out while polling
+    AsyncCommand_t cmd;
+    cmd.set("AT+MUTE");
+    cmd.expect(150);
+    CHECK(serial.submit(cmd));
+    start = millis();
+    uint32_t longest = 0;
+    while (!cmd.done() && millis() - start < 1000) {
+        uint32_t before = millis();
+        serial.poll();
+        if (millis() - before > longest) {
+            longest = millis() - before;
+        }
+        delay(1);
+    }
+    elapsed = millis() - start;
+    CHECK(cmd.done());
+    CHECK(cmd.response() == Response_t::A76XX_RESPONSE_TIMEOUT);
+    CHECK(elapsed >= 150 && elapsed < 250);
+    CHECK(longest < 20);
+
+    // and completes as soon as the response is there
+    AsyncCommand_t csq;
+    csq.set("AT+CSQ");
+    csq.expect(1000);
+    CHECK(serial.submit(csq));
+    CHECK(serial.run(csq) == Response_t::A76XX_RESPONSE_OK);
+}
+
+static void testLineSettings(ModemSerialPosix& serial, int slave) {
+    struct termios tty;
+    CHECK(serial.setBaudRate(921600));
+    CHECK(serial.getBaudRate() == 921600);
+    tcgetattr(slave, &tty);
+    CHECK(cfgetospeed(&tty) == B921600);
+    CHECK(!serial.setBaudRate(12345));
+    CHECK(serial.getBaudRate() == 921600);
+
+    // what was received before the change is dropped
+    serial.sendCMD("AT+STALE");
+    delay(50);
+    CHECK(serial.setBaudRate(115200));
+    CHECK(serial.getBaudRate() == 115200);
+    CHECK(serial.available() == 0);
+
+    CHECK(serial.setHardwareFlowControl(true));
+    tcgetattr(slave, &tty);
+    CHECK((tty.c_cflag & CRTSCTS) != 0);
+    CHECK(serial.setHardwareFlowControl(false));
+    tcgetattr(slave, &tty);
+    CHECK((tty.c_cflag & CRTSCTS) == 0);
+
+    // still talking to the module
+    serial.sendCMD("AT");
+    CHECK(serial.waitResponse() == Response_t::A76XX_RESPONSE_OK);
+}
+
+int main() {
+    int slave;
+    char name[64];
+    if (!openRawPty(master, slave, name)) {
+        printf("cannot open a pseudo-terminal\n");
+        return 1;
+    }
+    std::thread thread(module);
+
+    {
+        // opening the device by name configures it
+        ModemSerialPosix device(name, 460800);
+        CHECK(device.isOpen());
+        CHECK(device.getBaudRate() == 460800);
+        CHECK(!ModemSerialPosix("/nonexistent/tty").isOpen());
+    }
+
+    ModemSerialPosix serial(slave);
+    testBufferedReads(serial);
+    testTimeouts(serial);
+    testLineSettings(serial, slave);
+
+    running = false;
+    thread.join();
+    close(slave);
+    close(master);
+    return report("posix_test");
+}
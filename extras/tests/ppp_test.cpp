@@ -0,0 +1,240 @@
+// PPPSession and PPPBridgePosix, with the test playing pppd on the device of
+// the bridge and a thread playing the module, which loops the data back in data
+// mode. PPP frames are pushed through the bridge, straight over a pseudo-terminal
+// and then over a CMUX channel, and the byte rate is printed.
+
+#include "test.h"
+
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define TOTAL_LEN (1 << 20)
+
+static std::atomic<bool> running;
+
+// the FCS of RFC 1662, over the address, control, protocol and information fields
+static uint16_t fcs16(const uint8_t* data, size_t len) {
+    uint16_t fcs = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        fcs ^= data[i];
+        for (uint8_t b = 0; b < 8; b++) {
+            fcs = fcs & 1 ? (fcs >> 1) ^ 0x8408 : fcs >> 1;
+        }
+    }
+    return fcs ^ 0xFFFF;
+}
+
+static void putEscaped(std::vector<uint8_t>& out, uint8_t c) {
+    if (c == 0x7E || c == 0x7D || c < 0x20) {
+        out.push_back(0x7D);
+        out.push_back(c ^ 0x20);
+    } else {
+        out.push_back(c);
+    }
+}
+
+// IP packets of varying length in PPP frames, as pppd writes them
+static size_t makeFrames(std::vector<uint8_t>& out, size_t total) {
+    size_t frames = 0;
+    uint8_t frame[4 + 1500 + 2];
+    while (out.size() < total) {
+        size_t len = 4 + 40 + (frames * 97) % 1460;
+        frame[0] = 0xFF;
+        frame[1] = 0x03;
+        frame[2] = 0x00;
+        frame[3] = 0x21;
+        for (size_t i = 4; i < len; i++) {
+            frame[i] = (uint8_t) (i * 13 + frames);
+        }
+        uint16_t fcs = fcs16(frame, len);
+        frame[len++] = fcs & 0xFF;
+        frame[len++] = fcs >> 8;
+
+        out.push_back(0x7E);
+        for (size_t i = 0; i < len; i++) {
+            putEscaped(out, frame[i]);
+        }
+        out.push_back(0x7E);
+        frames++;
+    }
+    return frames;
+}
+
+// the frames with a good FCS in a stream
+static size_t countFrames(const uint8_t* data, size_t len) {
+    static uint8_t frame[2048];
+    size_t frames = 0, fill = 0;
+    bool escaped = false;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == 0x7E) {
+            if (fill >= 6 && fcs16(frame, fill - 2) == (frame[fill - 2] | frame[fill - 1] << 8)) {
+                frames++;
+            }
+            fill = 0;
+            escaped = false;
+        } else if (data[i] == 0x7D) {
+            escaped = true;
+        } else if (fill < sizeof(frame)) {
+            frame[fill++] = escaped ? data[i] ^ 0x20 : data[i];
+            escaped = false;
+        }
+    }
+    return frames;
+}
+
+// plays the module: dial, escape and hang up, and in data mode sends back
+// whatever it gets. A voice call is answered with OK.
+static void module(ModemSerial* serial, CMUX* mux) {
+    static uint8_t buf[4096];
+    bool online = false;
+    char line[64];
+    while (running) {
+        if (mux != NULL && !mux->channel(2)->isOpen()) {
+            mux->pump(10);
+            continue;
+        }
+        if (!online) {
+            if (serial->readLine(line, sizeof(line), 20) < 0) {
+                continue;
+            }
+            if (strcmp(line, "ATD*99#") == 0 || strcmp(line, "ATO") == 0) {
+                serial->write("\r\nCONNECT 150000000\r\n");
+                online = true;
+            } else if (strcmp(line, "ATH") == 0 || strcmp(line, "ATD*99#;") == 0) {
+                serial->write("\r\nOK\r\n");
+            } else if (line[0] != '\0') {
+                serial->write("\r\nERROR\r\n");
+            }
+            continue;
+        }
+        if (!serial->waitAvailable(20)) {
+            continue;
+        }
+        int len = serial->available();
+        len = serial->readBytes(buf, len < (int) sizeof(buf) ? len : sizeof(buf));
+        // the escape sequence comes alone, after the guard time
+        if (len == 3 && memcmp(buf, "+++", 3) == 0) {
+            serial->write("\r\nOK\r\n");
+            online = false;
+            continue;
+        }
+        size_t written = 0;
+        while (written < (size_t) len) {
+            written += serial->write((const char*) buf + written, len - written);
+        }
+    }
+}
+
+static void testBridge(ModemSerial& host, ModemSerial& modem, CMUX* mux, const char* name) {
+    running = true;
+    std::thread thread(module, &modem, mux);
+
+    PPPSession session(host);
+    CHECK(session.read(NULL, 0, 0) == 0);
+    // a voice call is not a data call
+    CHECK(session.dial("*99#;") == A76XX_GENERIC_ERROR);
+    CHECK(!session.isOnline());
+    CHECK(session.dial() == A76XX_OPERATION_SUCCEEDED);
+    CHECK(session.isOnline());
+
+    PPPBridgePosix bridge(session);
+    CHECK(bridge.begin());
+    std::atomic<bool> transferring(true);
+    std::thread downstream([&]() {
+        while (transferring && bridge.transfer(50)) {}
+    });
+
+    // pppd
+    int pppd = open(bridge.device(), O_RDWR | O_NOCTTY);
+    CHECK(pppd >= 0);
+    struct termios tty;
+    tcgetattr(pppd, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(pppd, TCSANOW, &tty);
+
+    static std::vector<uint8_t> out;
+    static uint8_t in[TOTAL_LEN + 4096];
+    out.clear();
+    size_t frames = makeFrames(out, TOTAL_LEN);
+
+    uint32_t start = millis();
+    std::thread writer([&]() {
+        writeAll(pppd, out.data(), out.size());
+    });
+    size_t got = 0;
+    while (got < out.size()) {
+        struct pollfd pfd = {pppd, POLLIN, 0};
+        if (::poll(&pfd, 1, 3000) <= 0) {
+            break;
+        }
+        ssize_t len = ::read(pppd, in + got, sizeof(in) - got);
+        if (len > 0) {
+            got += len;
+        }
+    }
+    writer.join();
+    uint32_t elapsed = millis() - start;
+    printf("  %s: %u frames, %u bytes each way in %u ms, %.1f MB/s\n", name, (unsigned) frames,
+           (unsigned) got, (unsigned) elapsed, got / 1000.0 / (elapsed ? elapsed : 1));
+
+    CHECK(got == out.size());
+    CHECK(memcmp(in, out.data(), out.size()) == 0);
+    CHECK(countFrames(in, got) == frames);
+
+    transferring = false;
+    downstream.join();
+    bridge.end();
+    close(pppd);
+
+    // back to command mode and data mode on the same call, then the end of it
+    CHECK(session.suspend(100) == A76XX_OPERATION_SUCCEEDED);
+    CHECK(!session.isOnline());
+    CHECK(session.read(in, sizeof(in), 0) == 0);
+    CHECK(session.resume() == A76XX_OPERATION_SUCCEEDED);
+    CHECK(session.isOnline());
+    CHECK(session.hangUp(100) == A76XX_OPERATION_SUCCEEDED);
+    CHECK(!session.isOnline());
+
+    running = false;
+    thread.join();
+}
+
+int main() {
+    {
+        int master, slave;
+        if (!openRawPty(master, slave)) {
+            printf("cannot open a pseudo-terminal\n");
+            return 1;
+        }
+        ModemSerialPosix host(slave), modem(master);
+        testBridge(host, modem, NULL, "direct");
+#if A76XX_ENABLE_METRICS
+        // the data read by PPPSession::read is accounted for
+        CHECK(host.metrics().rx_bytes >= TOTAL_LEN);
+#endif
+        close(slave);
+        close(master);
+    }
+    {
+        int sv[2];
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        ModemSerialPosix host(sv[0]), modem(sv[1]);
+        CMUX mux(host, true, 127), peer(modem, false, 127);
+        std::atomic<bool> opening(true);
+        std::thread thread([&]() {
+            while (opening && !peer.channel(2)->isOpen()) {
+                peer.pump(10);
+            }
+        });
+        CHECK(mux.begin() == A76XX_OPERATION_SUCCEEDED);
+        CHECK(mux.openChannel(2) == A76XX_OPERATION_SUCCEEDED);
+        opening = false;
+        thread.join();
+        testBridge(*mux.channel(2), *peer.channel(2), &peer, "cmux");
+        close(sv[0]);
+        close(sv[1]);
+    }
+    return report("ppp_test");
+}
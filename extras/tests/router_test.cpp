@@ -0,0 +1,122 @@
+// MQTTRouter: the wildcards as per MQTT, '#' matching its parent level and '+'
+// matching empty levels, topics starting with '$', and handlers removed.
+
+#include "test.h"
+
+static MQTTRouter router;
+
+// each handler sets its bit in the mask given as context
+static uint32_t hits;
+static const uint8_t bits[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+static void onMessage(const MQTTMessageView_t* msg, void* context) {
+    hits |= 1 << *(const uint8_t*) context;
+}
+
+static void add(const char* filter, uint8_t bit) {
+    CHECK(router.add(filter, onMessage, (void*) &bits[bit]));
+}
+
+// the handlers called for a topic
+static uint32_t routeTo(const char* topic) {
+    MQTTMessageView_t msg;
+    msg.topic = topic;
+    msg.topic_len = strlen(topic);
+    msg.payload = (const uint8_t*) "";
+    msg.payload_len = 0;
+    hits = 0;
+    router.route(msg);
+    return hits;
+}
+
+static void testMultiLevel() {
+    router = MQTTRouter();
+    add("a/#", 0);
+    add("#", 1);
+    add("a/b/#", 2);
+
+    // '#' matches its parent level too
+    CHECK(routeTo("a") == 0x3);
+    CHECK(routeTo("a/b") == 0x7);
+    CHECK(routeTo("a/b/c/d") == 0x7);
+    CHECK(routeTo("a/") == 0x3);
+    CHECK(routeTo("ab") == 0x2);
+    CHECK(routeTo("b/a") == 0x2);
+
+    // '#' only as the last level
+    CHECK(!router.add("a/#/b", onMessage));
+    CHECK(!router.add("a#", onMessage));
+}
+
+static void testSingleLevel() {
+    router = MQTTRouter();
+    add("a/+/c", 0);
+    add("+/+", 1);
+    add("+", 2);
+    add("a/+", 3);
+
+    // '+' matches an empty level
+    CHECK(routeTo("a//c") == 0x1);
+    CHECK(routeTo("/x") == 0x2);
+    CHECK(routeTo("a/") == 0xA);
+    CHECK(routeTo("/") == 0x2);
+    CHECK(routeTo("a/b/c") == 0x1);
+    CHECK(routeTo("a/b") == 0xA);
+    CHECK(routeTo("x") == 0x4);
+    CHECK(routeTo("a/b/c/d") == 0);
+
+    // '+' takes a whole level
+    CHECK(!router.add("a/b+", onMessage));
+    CHECK(!router.add("+a/b", onMessage));
+}
+
+static void testSystemTopics() {
+    router = MQTTRouter();
+    add("#", 0);
+    add("+/info", 1);
+    add("$SYS/#", 2);
+    add("$SYS/+", 3);
+    add("+/+/+", 4);
+
+    // no wildcard in the first level matches a topic starting with '$'
+    CHECK(routeTo("$SYS/info") == 0xC);
+    CHECK(routeTo("$SYS/a/b") == 0x4);
+    CHECK(routeTo("$SYS") == 0x4);
+    CHECK(routeTo("x/info") == 0x3);
+    // only the first level counts
+    CHECK(routeTo("a/$b/c") == 0x11);
+}
+
+static void testRemove() {
+    router = MQTTRouter();
+    add("a/+", 0);
+    add("a/+", 1);
+    add("a/#", 2);
+    CHECK(routeTo("a/b") == 0x7);
+
+    // only the handler with the same filter and context
+    CHECK(router.remove("a/+", onMessage, (void*) &bits[0]));
+    CHECK(routeTo("a/b") == 0x6);
+    CHECK(!router.remove("a/+", onMessage, (void*) &bits[0]));
+    CHECK(!router.remove("a/#", onMessage, (void*) &bits[1]));
+    CHECK(!router.remove("b/+", onMessage, (void*) &bits[1]));
+
+    CHECK(router.remove("a/+", onMessage, (void*) &bits[1]));
+    CHECK(router.remove("a/#", onMessage, (void*) &bits[2]));
+    uint32_t unmatched = router.unmatched();
+    CHECK(routeTo("a/b") == 0);
+    CHECK(router.unmatched() == unmatched + 1);
+
+    // added back, on the nodes left by the filter
+    add("a/+", 3);
+    CHECK(routeTo("a/b") == 0x8);
+    CHECK(routeTo("a") == 0);
+}
+
+int main() {
+    testMultiLevel();
+    testSingleLevel();
+    testSystemTopics();
+    testRemove();
+    return report("router_test");
+}
@@ -0,0 +1,68 @@
+// The transcript of a device starting up: A76XX::init, GPRSConnect, then
+// connecting to an MQTT broker and publishing a message, with an SMS
+// notification in the middle. Shared by the scenario test and the benchmark.
+
+#ifndef A76XX_HOST_SCENARIO_H_
+#define A76XX_HOST_SCENARIO_H_
+
+#include "A76XX.h"
+
+/*
+    @brief Add the steps of the scenario to a mock.
+
+    @param [IN] pub_result The outcome of the message reported by the module.
+    @return The number of bytes exchanged.
+*/
+inline uint32_t scriptScenario(ModemSerialMock& mock, const char* pub_result = "\r\n+CMQTTPUB: 0,0\r\n") {
+    static const char* const steps[][2] = {
+        // init
+        {"AT\r\n",                                          "\r\nOK\r\n"},
+        {"ATE0\r\n",                                        "ATE0\r\r\nOK\r\n"},
+        {"AT+CMEE=0\r\n",                                   "\r\nOK\r\n"},
+        {NULL,                                              "\r\n+CMTI: \"SM\",3\r\n"},
+        {"AT+CTZR=0\r\n",                                   "\r\nOK\r\n"},
+        {"AT+CTZU=1\r\n",                                   "\r\nOK\r\n"},
+        {"AT+CPIN?\r\n",                                    "\r\n+CPIN: READY\r\n\r\nOK\r\n"},
+        // GPRSConnect
+        {"AT+CGDCONT=1,\"IP\",\"apn\"\r\n",                 "\r\nOK\r\n"},
+        {"AT+CGACT=1,1\r\n",                                "\r\nOK\r\n"},
+        // MQTT
+        {"AT+CMQTTSTART\r\n",                               "\r\nOK\r\n\r\n+CMQTTSTART: 0\r\n"},
+        {"AT+CMQTTACCQ=0,\"id\",0\r\n",                     "\r\nOK\r\n"},
+        {"AT+CMQTTCONNECT=0,\"tcp://host:1883\",60,1\r\n",  "\r\nOK\r\n\r\n+CMQTTCONNECT: 0,0\r\n"},
+        {"AT+CMQTTTOPIC=0,5\r\n",                           "\r\n>"},
+        {"a/b/c",                                           "\r\nOK\r\n"},
+        {"AT+CMQTTPAYLOAD=0,5\r\n",                         "\r\n>"},
+        {"hello",                                           "\r\nOK\r\n"},
+        {"AT+CMQTTPUB=0,1,60,0,0\r\n",                      "\r\nOK\r\n"},
+    };
+    // how long the module takes to answer each step, in milliseconds
+    static const uint32_t latency[] = {5, 5, 2, 2, 2, 2, 10, 2, 300, 50, 2, 200, 2, 2, 2, 2, 2};
+
+    uint32_t bytes = 0;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        if (steps[i][0] != NULL) {
+            mock.tx(steps[i][0]);
+            bytes += strlen(steps[i][0]);
+        }
+        mock.rx(steps[i][1], latency[i]);
+        bytes += strlen(steps[i][1]);
+    }
+    mock.rx(pub_result, 100);
+    return bytes + strlen(pub_result);
+}
+
+/*
+    @brief Run the scenario, as an application would.
+
+    @return True if every step succeeded.
+*/
+inline bool runScenario(A76XX& modem, A76XXMQTTClient& mqtt) {
+    return modem.init()
+        && modem.GPRSConnect("apn")
+        && mqtt.begin()
+        && mqtt.connect("host", 1883, true)
+        && mqtt.publish("a/b/c", "hello", 1, 60);
+}
+
+#endif /* A76XX_HOST_SCENARIO_H_ */
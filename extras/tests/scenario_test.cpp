@@ -0,0 +1,97 @@
+// A device starting up, from A76XX::init to a published MQTT message, on a
+// ModemSerialMock replaying the transcript in scenario.h with a virtual clock.
+// Also the match strings the registry of event handlers refuses.
+
+#include "test.h"
+#include "scenario.h"
+
+// the clients register their event handlers with the mock for good
+static ModemSerialMock mock;
+static A76XX modem(mock);
+static A76XXMQTTClient mqtt(modem, "id");
+static uint8_t sms_index = 0;
+
+static void onSMS(uint8_t index) {
+    sms_index = index;
+}
+
+static void testScenario() {
+    SMSOnMessageRx sms(onSMS);
+    mock.registerEventHandler(&sms);
+
+    scriptScenario(mock);
+    CHECK(runScenario(modem, mqtt));
+    CHECK(mock.done());
+    if (!mock.done()) {
+        printf("%s\n", mock.error());
+    }
+    // the SMS notification in the middle of init is dispatched
+    CHECK(sms_index == 3);
+
+    // the same transcript again
+    for (int i = 0; i < 100; i++) {
+        mock.rewind();
+        sms_index = 0;
+        CHECK(runScenario(modem, mqtt) && mock.done() && sms_index == 3);
+    }
+    mock.deRegisterEventHandler(&sms);
+}
+
+static void testRejected() {
+
+    // the broker refuses the message after the module has taken it
+    mock.clearSteps();
+    scriptScenario(mock, "\r\n+CMQTTPUB: 0,11\r\n");
+    CHECK(!runScenario(modem, mqtt));
+    CHECK(mqtt.getLastError() == 11);
+    CHECK(mock.done());
+}
+
+static void testDeviation() {
+
+    // the library writing something else than the transcript is reported
+    mock.clearSteps();
+    mock.tx("AT\r\n");
+    mock.rx("\r\nOK\r\n");
+    mock.tx("AT+CFUN=0\r\n");
+    mock.rx("\r\nOK\r\n");
+    CHECK(!modem.init());
+    CHECK(!mock.done());
+    CHECK(strstr(mock.error(), "unexpected TX in step 2") != NULL);
+}
+
+class CountingHandler : public EventHandler_t {
+  public:
+    int count;
+    CountingHandler(const char* match_string) : EventHandler_t(match_string), count(0) {}
+    void process(ModemSerial* serial) {
+        count++;
+        serial->find('\n');
+    }
+};
+
+static void testMatchStrings() {
+
+    // the registry keys on the character after '+' or '$'
+    CountingHandler plus("+"), dollar("$"), empty(""), urc("+CX: ");
+    CHECK(!mock.registerEventHandler(&plus));
+    CHECK(!mock.registerEventHandler(&dollar));
+    CHECK(!mock.registerEventHandler(&empty));
+    CHECK(mock.registerEventHandler(&urc));
+    CHECK(!mock.registerEventHandler(&urc));
+
+    mock.clearSteps();
+    mock.rx("\r\n+CX: 1\r\n");
+    mock.listen(10);
+    CHECK(urc.count == 1);
+    CHECK(mock.done());
+    mock.deRegisterEventHandler(&urc);
+}
+
+int main() {
+    testScenario();
+    testRejected();
+    testDeviation();
+    testMatchStrings();
+    return report("scenario_test");
+}
@@ -0,0 +1,63 @@
+// Helpers shared by the host tests.
+
+#ifndef A76XX_HOST_TEST_H_
+#define A76XX_HOST_TEST_H_
+
+#include "A76XX.h"
+
+#include <pty.h>
+
+int failures = 0;
+
+// report a failed condition and carry on, so that one run shows all failures
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+// print the outcome of the test, returned by main
+int report(const char* name) {
+    printf("%s: %s (%d failures)\n", name, failures ? "FAILED" : "passed", failures);
+    return failures != 0;
+}
+
+// a pseudo-terminal in raw mode: the library opens or takes the slave side,
+// the test plays the module on the master side
+bool openRawPty(int& master, int& slave, char* name = NULL) {
+    if (openpty(&master, &slave, name, NULL, NULL) != 0) {
+        return false;
+    }
+    struct termios tty;
+    tcgetattr(master, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(master, TCSANOW, &tty);
+    tcgetattr(slave, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(slave, TCSANOW, &tty);
+    return true;
+}
+
+// write all of a buffer to a descriptor
+void writeAll(int fd, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n > 0) {
+            p += n;
+            len -= n;
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return;
+        } else {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            ::poll(&pfd, 1, 10);
+        }
+    }
+}
+
+void writeAll(int fd, const char* str) {
+    writeAll(fd, str, strlen(str));
+}
+
+#endif /* A76XX_HOST_TEST_H_ */
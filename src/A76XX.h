@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdio.h>
 
 //#include "Arduino.h"
 #include "time.h"
@@ -13,13 +14,209 @@
     #define A76XX_SERIAL_TIMEOUT_DEFAULT 1000
 #endif
 
-#ifndef A76XX_MAX_EVENT_HANDLERS
-    /* Controls the maximum number of event handlers that are stored in A76XX::ModemSerial  */
-    #define A76XX_MAX_EVENT_HANDLERS 10
+#ifndef A76XX_SERIAL_RX_CHUNK
+    /* Maximum number of bytes moved from the UART driver to the receive buffer in one call */
+    #define A76XX_SERIAL_RX_CHUNK 128
+#endif
+
+#ifndef A76XX_SERIAL_RX_BUFFER_SIZE
+    /*
+        Size in bytes, a power of two, of the receive buffer of ModemSerialESP and
+        ModemSerialPosix. With the RX task of ModemSerialESP, it must also hold the
+        data handed back by the task when the application goes idle, i.e.
+        A76XX_RX_TASK_STREAM_SIZE plus two chunks of A76XX_SERIAL_RX_CHUNK bytes.
+    */
+    #define A76XX_SERIAL_RX_BUFFER_SIZE 1024
+#endif
+
+#ifndef A76XX_RX_TASK_STACK_SIZE
+    /* Stack size in bytes of the optional RX task of ModemSerialESP */
+    #define A76XX_RX_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef A76XX_RX_TASK_PRIORITY
+    /* Default priority of the optional RX task of ModemSerialESP */
+    #define A76XX_RX_TASK_PRIORITY 10
+#endif
+
+#ifndef A76XX_RX_TASK_STREAM_SIZE
+    /* Size in bytes of the buffer used by the RX task to pass data to the application */
+    #define A76XX_RX_TASK_STREAM_SIZE 512
+#endif
+
+#ifndef A76XX_RX_TASK_RELEASE_MS
+    /*
+        The RX task processes URCs itself once the application has not used the
+        serial object for this many milliseconds.
+    */
+    #define A76XX_RX_TASK_RELEASE_MS 20
+#endif
+
+#ifndef A76XX_EVENT_QUEUE_SIZE
+    /* Number of processed URCs that can be waited for with ModemSerialESP::waitEvent */
+    #define A76XX_EVENT_QUEUE_SIZE 16
+#endif
+
+#ifndef A76XX_CMD_BUFFER_LEN
+    /* Size of the stack buffer used to coalesce the items of an AT command into one write */
+    #define A76XX_CMD_BUFFER_LEN 128
+#endif
+
+#ifndef A76XX_ASYNC_LINE_LEN
+    /*
+        Size of the buffer of an asynchronous command holding the rest of the line
+        of its response, for the parsers set with AsyncCommand_t::onResponse
+    */
+    #define A76XX_ASYNC_LINE_LEN 32
+#endif
+
+#ifdef A76XX_MAX_EVENT_HANDLERS
+    /* the maximum number of event handlers stored in ModemSerial */
+    #error "A76XX_MAX_EVENT_HANDLERS is no longer used, there is no limit on the number of event handlers, see A76XX_EVENT_HANDLER_BUCKETS"
+#endif
+
+#ifndef A76XX_EVENT_HANDLER_BUCKETS
+    /*
+        Number of buckets, a power of two up to 32, of the table indexing event handlers by
+        the first characters of their match string. There is no limit on the
+        number of handlers.
+    */
+    #define A76XX_EVENT_HANDLER_BUCKETS 16
+#endif
+
+#ifndef A76XX_URC_ARENA_SIZE
+    /*
+        Size in bytes of the buffer where URCs are captured until they are processed,
+        once the command in flight has completed. URCs that do not fit are dropped,
+        data following a URC, e.g. an MQTT payload, is truncated to leave a quarter
+        of the buffer free, unless its handler streams it.
+    */
+    #define A76XX_URC_ARENA_SIZE 512
+#endif
+
+#ifndef A76XX_CHANNEL_PRIORITY_BURST
+    /*
+        Maximum number of consecutive short commands that are given the serial
+        channel while other commands are waiting for it.
+    */
+    #define A76XX_CHANNEL_PRIORITY_BURST 4
+#endif
+
+#ifndef A76XX_CMUX_CHANNELS
+    /* Number of channels of a CMUX multiplexer, DLCI 1 to A76XX_CMUX_CHANNELS */
+    #define A76XX_CMUX_CHANNELS 4
+#endif
+
+#ifndef A76XX_CMUX_FRAME_SIZE
+    /* Maximum number of data bytes in a CMUX frame, longer frames received are dropped */
+    #define A76XX_CMUX_FRAME_SIZE 127
+#endif
+
+#ifndef A76XX_CMUX_CHANNEL_BUFFER_SIZE
+    /*
+        Size in bytes, a power of two, of the receive buffers of each CMUX channel.
+        The module is asked to stop sending on a channel when its buffer is almost full.
+    */
+    #define A76XX_CMUX_CHANNEL_BUFFER_SIZE 512
+#endif
+
+#ifndef A76XX_CMUX_POLL_MS
+    /*
+        Maximum time a task waiting for CMUX data holds the physical link, before
+        letting other tasks send or read.
+    */
+    #define A76XX_CMUX_POLL_MS 10
+#endif
+
+#ifndef A76XX_PPP_CHUNK
+    /* Maximum number of bytes moved at once between the module and the IP stack in PPP data mode */
+    #define A76XX_PPP_CHUNK 512
+#endif
+
+#ifndef A76XX_PPP_TASK_STACK_SIZE
+    /* Stack size in bytes of the task passing PPP data from the module to lwIP */
+    #define A76XX_PPP_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef A76XX_BAUD_PROBE_TIMEOUT
+    /* Time in milliseconds to wait for the answer to AT when trying a baud rate */
+    #define A76XX_BAUD_PROBE_TIMEOUT 300
+#endif
+
+#ifndef A76XX_BAUD_PROBE_ATTEMPTS
+    /* Number of times AT is sent before a baud rate is deemed not to work */
+    #define A76XX_BAUD_PROBE_ATTEMPTS 3
+#endif
+
+#ifndef A76XX_ENABLE_METRICS
+    /* Set to 1 to count the traffic and the latency of the commands, see ModemSerial::metrics */
+    #define A76XX_ENABLE_METRICS 0
+#endif
+
+#ifndef A76XX_METRICS_COMMANDS
+    /* Number of command verbs whose latency is recorded separately */
+    #define A76XX_METRICS_COMMANDS 12
+#endif
+
+#ifndef A76XX_METRICS_HANDLERS
+    /* Number of event handlers whose URCs are counted separately */
+    #define A76XX_METRICS_HANDLERS 8
+#endif
+
+#ifndef A76XX_METRICS_BUCKETS
+    /* Number of buckets of the latency histograms, the last one from 2^(n-2) ms */
+    #define A76XX_METRICS_BUCKETS 14
+#endif
+
+#ifndef A76XX_METRICS_VERB_LEN
+    /* Maximum length of a command verb recorded by the metrics, with the terminator */
+    #define A76XX_METRICS_VERB_LEN 20
+#endif
+
+#ifndef A76XX_ADAPTIVE_WAITS
+    /*
+        Number of waits following each command, e.g. for a prompt and then for the
+        final result, whose latency is learnt by the metrics to adapt their timeout
+    */
+    #define A76XX_ADAPTIVE_WAITS 3
+#endif
+
+#ifndef A76XX_ADAPTIVE_MIN_SAMPLES
+    /* Number of latencies learnt before the timeout of a wait is adapted */
+    #define A76XX_ADAPTIVE_MIN_SAMPLES 8
+#endif
+
+#ifndef A76XX_ADAPTIVE_TIMEOUT_MIN
+    /* Lower bound in milliseconds of an adaptive timeout */
+    #define A76XX_ADAPTIVE_TIMEOUT_MIN 1000
+#endif
+
+#ifndef A76XX_ADAPTIVE_MAX_BACKOFF
+    /* Maximum number of doublings of an adaptive timeout after consecutive timeouts */
+    #define A76XX_ADAPTIVE_MAX_BACKOFF 4
+#endif
+
+#ifndef A76XX_MATCHER_MAX_NODES
+    /*
+        Controls the size of the automaton used to match responses and URCs. One node
+        is used for each character of the match strings, minus shared prefixes.
+    */
+    #define A76XX_MATCHER_MAX_NODES 128
+#endif
+
+#ifndef A76XX_MATCHER_MAX_FALLBACK
+    /*
+        Number of match strings compared one by one when the automaton is full, one
+        for each of those passed to waitResponse.
+    */
+    #define A76XX_MATCHER_MAX_FALLBACK 5
 #endif
 
 #ifndef MQTT_PAYLOAD_BUFFER_LEN
-    /* Controls the maximum payload size in bytes of an MQTT message */
+    /*
+        Controls the maximum payload size in bytes of an MQTT message passed to the
+        callback. Stream longer ones with A76XXMQTTClient::setMessageSink.
+    */
     #define MQTT_PAYLOAD_BUFFER_LEN 64
 #endif
 
@@ -28,9 +225,58 @@
     #define MQTT_TOPIC_BUFFER_LEN 32
 #endif
 
-#ifndef MQTT_MESSAGE_QUEUE_SIZE
-    /* Controls the size of the queue to store MQTT message */
-    #define MQTT_MESSAGE_QUEUE_SIZE 10
+#ifdef MQTT_MESSAGE_QUEUE_SIZE
+    /* the queue used to hold a fixed number of messages of the maximum length */
+    #error "MQTT_MESSAGE_QUEUE_SIZE is no longer used, set MQTT_MESSAGE_QUEUE_BYTES to the size of the queue in bytes instead"
+#endif
+
+#ifndef MQTT_MESSAGE_QUEUE_BYTES
+    /*
+        Size in bytes of the queue of received MQTT messages, each taking its topic
+        and payload lengths plus 14 bytes
+    */
+    #define MQTT_MESSAGE_QUEUE_BYTES 1024
+#endif
+
+#ifndef MQTT_PUBLISH_WINDOW
+    /*
+        Maximum number of messages published with A76XXMQTTClient::publishPipelined
+        whose outcome has not been reported yet
+    */
+    #define MQTT_PUBLISH_WINDOW 8
+#endif
+
+#ifndef MQTT_ROUTER_MAX_NODES
+    /* Maximum number of topic levels in the filters of a MQTTRouter, shared prefixes counted once */
+    #define MQTT_ROUTER_MAX_NODES 64
+#endif
+
+#ifndef MQTT_ROUTER_MAX_ROUTES
+    /* Maximum number of handlers added to a MQTTRouter */
+    #define MQTT_ROUTER_MAX_ROUTES 32
+#endif
+
+#ifndef MQTT_ROUTER_NAME_BYTES
+    /* Size in bytes of the names of the topic levels in the filters of a MQTTRouter */
+    #define MQTT_ROUTER_NAME_BYTES 512
+#endif
+
+#ifndef MQTT_OUTBOX_BATCH
+    /* Maximum number of messages of the outbox published by each call to A76XXMQTTClient::drainOutbox */
+    #define MQTT_OUTBOX_BATCH 16
+#endif
+
+#ifndef MQTT_OUTBOX_RETRY_MS
+    /* Time in milliseconds between checks of the connection while the outbox cannot be drained */
+    #define MQTT_OUTBOX_RETRY_MS 10000
+#endif
+
+#ifndef MQTT_PUBLISH_MARGIN
+    /*
+        Time in milliseconds, after the publish timeout of a pipelined message, after
+        which its outcome is given up on and reported as timed out
+    */
+    #define MQTT_PUBLISH_MARGIN 5000
 #endif
 
 #ifndef NMEA_MESSAGE_SIZE
@@ -143,13 +389,24 @@ enum Response_t {
 
 #include "utils/base64.h"
 #include "utils/byteringbuf.h"
+#include "utils/multimatcher.h"
+#include "utils/line_tokenizer.h"
+#include "utils/channel_lock.h"
 #include "utils/CircularBuffer.hpp"
 #include "utils/smsCoding.h"
 
 #include "event_handlers.h"
+#include "deadline.h"
+#include "metrics.h"
+#include "capture.h"
 #include "modem_serial.h"
 #include "modem_serial_esp.h"
 #include "modem_serial_arduino.h"
+#include "modem_serial_posix.h"
+#include "modem_serial_mock.h"
+#include "async_command.h"
+#include "response_line.h"
+#include "cmux.h"
 
 #include "commands/internet_service.h"
 #include "commands/serial_interface.h"
@@ -165,9 +422,12 @@ enum Response_t {
 #include "commands/sms.h"
 
 #include "modem.h"
+#include "ppp.h"
 
 #include "clients/base.h"
 #include "clients/secure.h"
+#include "clients/mqtt_outbox.h"
+#include "clients/mqtt_router.h"
 #include "clients/mqtt.h"
 #include "clients/http.h"
 #include "clients/gnss.h"
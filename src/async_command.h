@@ -0,0 +1,341 @@
+#ifndef A76XX_ASYNC_COMMAND_H_
+#define A76XX_ASYNC_COMMAND_H_
+
+#include "A76XX.h"
+
+class AsyncCommand_t;
+
+/*
+    Function called when an asynchronous command is done. The rest of the line
+    following the match is available from AsyncCommand_t::line, if requested.
+*/
+typedef void (*AsyncCallback_t)(AsyncCommand_t& cmd, ModemSerial& serial);
+
+/*
+    @brief An AT command executed without blocking the caller.
+
+    @details A command is prepared with ::set and ::expect, then queued with
+        ModemSerial::submit. Commands are sent one at a time, by ModemSerial::poll,
+        which also consumes the response as it arrives and executes the event
+        handlers in between. When a final response is matched, or the command times
+        out, the command is done: its response and return code are available,
+        and its callback, if any, is executed.
+
+        Command wrappers can also set a parser, executed before the callback, that
+        parses the rest of the line of the response and sets the return code. The
+        line is read by ModemSerial::poll as it arrives, so that parsers never
+        block. Blocking wrappers
+        can then be written as: prepare the command, submit it and call
+        ModemSerial::run.
+
+        Example:
+
+            AsyncCommand_t cmd;
+            cmd.set("AT+CSQ");
+            cmd.expect("+CSQ: ", 9000);
+            serial.submit(cmd);
+            while (!cmd.done()) {
+                serial.poll();
+                // do something else
+            }
+*/
+class AsyncCommand_t {
+  friend class ModemSerial;
+
+  public:
+    enum State_t {
+        IDLE    = 0,
+        QUEUED  = 1,
+        RUNNING = 2,
+        DONE    = 3
+    };
+
+    AsyncCommand_t()
+        : _len(0)
+        , _timeout(1000)
+        , _tc(0)
+        , _parser(NULL)
+        , _parse_line(false)
+        , _in_line(false)
+        , _line_len(0)
+        , _callback(NULL)
+        , _arg(NULL)
+        , _state(State_t::IDLE)
+        , _response(Response_t::A76XX_RESPONSE_TIMEOUT)
+        , _retcode(A76XX_OPERATION_TIMEDOUT)
+        , _next(NULL) {
+        _match[0] = _match[1] = _match[2] = NULL;
+        _match[3] = RESPONSE_OK;
+        _match[4] = RESPONSE_ERROR;
+        _line[0] = '\0';
+    }
+
+    /*
+        @brief Set the command text, with the same arguments of ModemSerial::sendCMD.
+
+        @detail The trailing carriage return, line feed characters are added. The
+            command must fit in A76XX_CMD_BUFFER_LEN bytes. Do not call this while
+            the command is pending.
+        @return False if the command is too long.
+    */
+    template <typename... ARGS>
+    bool set(ARGS... args) {
+        ModemSerial::CommandBuffer buf(_text, sizeof(_text), NULL);
+        ModemSerial::appendCMD(buf, args..., "\r\n");
+        _len = buf.overflow() ? 0 : buf.length();
+        _state = State_t::IDLE;
+        return _len > 0;
+    }
+
+    /*
+        @brief Set the strings that complete the command, as for ModemSerial::waitResponse.
+
+        @detail If not called, the command completes on the default OK and ERROR
+            strings, with a timeout of 1000 milliseconds.
+    */
+    void expect(const char* match_1,
+                const char* match_2,
+                const char* match_3,
+                uint32_t timeout = 1000,
+                bool match_OK = true,
+                bool match_ERROR = true) {
+        _match[0] = match_1;
+        _match[1] = match_2;
+        _match[2] = match_3;
+        _match[3] = match_OK ? RESPONSE_OK : NULL;
+        _match[4] = match_ERROR ? RESPONSE_ERROR : NULL;
+        _timeout = timeout;
+    }
+
+    void expect(const char* match_1,
+                uint32_t timeout = 1000,
+                bool match_OK = true,
+                bool match_ERROR = true) {
+        expect(match_1, NULL, NULL, timeout, match_OK, match_ERROR);
+    }
+
+    void expect(uint32_t timeout,
+                bool match_OK = true,
+                bool match_ERROR = true) {
+        expect(NULL, NULL, NULL, timeout, match_OK, match_ERROR);
+    }
+
+    /*
+        @brief Set a function that parses the rest of the response and sets the
+            return code. Used by command wrappers.
+
+        @param [IN] parser The function.
+        @param [IN] whole_line Whether the command is only done once the rest of
+            the line following one of the strings passed to ::expect has arrived,
+            see ::line. Not for OK and ERROR, which end their line.
+    */
+    void onResponse(AsyncCallback_t parser, bool whole_line = false) {
+        _parser = parser;
+        _parse_line = whole_line;
+    }
+
+    /*
+        @brief The rest of the line following the match, without the line ending,
+            if requested with ::onResponse. Truncated to A76XX_ASYNC_LINE_LEN - 1
+            characters.
+    */
+    const char* line() {
+        return _line;
+    }
+
+    /*
+        @brief Set a function called when the command is done.
+
+        @param [IN] callback The function.
+        @param [IN] arg Any pointer, available with ::arg from the callback.
+    */
+    void onComplete(AsyncCallback_t callback, void* arg = NULL) {
+        _callback = callback;
+        _arg = arg;
+    }
+
+    State_t state() {
+        return _state;
+    }
+
+    bool done() {
+        return _state == State_t::DONE;
+    }
+
+    /*
+        @brief The response matched, or A76XX_RESPONSE_TIMEOUT.
+    */
+    Response_t response() {
+        return _response;
+    }
+
+    /*
+        @brief The return code: A76XX_OPERATION_SUCCEEDED if any of the match
+            strings has been found, unless a parser has set a different value.
+    */
+    int32_t retcode() {
+        return _retcode;
+    }
+
+    void setRetcode(int32_t retcode) {
+        _retcode = retcode;
+    }
+
+    void* arg() {
+        return _arg;
+    }
+
+  private:
+    char            _text[A76XX_CMD_BUFFER_LEN];
+    size_t                                 _len;
+    const char*                       _match[5];
+    uint32_t                           _timeout;
+    TimeoutCalc                             _tc;
+    AsyncCallback_t                     _parser;
+    bool                            _parse_line;
+    // reading the rest of the line of the response, held in _response
+    bool                               _in_line;
+    char                _line[A76XX_ASYNC_LINE_LEN];
+    size_t                            _line_len;
+    AsyncCallback_t                   _callback;
+    void*                                  _arg;
+    State_t                              _state;
+    Response_t                        _response;
+    int32_t                            _retcode;
+    AsyncCommand_t*                       _next;
+};
+
+inline bool ModemSerial::submit(AsyncCommand_t& cmd) {
+    if (cmd._len == 0 || cmd._state == AsyncCommand_t::QUEUED || cmd._state == AsyncCommand_t::RUNNING) {
+        return false;
+    }
+    cmd._state = AsyncCommand_t::QUEUED;
+    cmd._in_line = false;
+    cmd._line_len = 0;
+    cmd._line[0] = '\0';
+    cmd._next = NULL;
+    if (_cmd_tail == NULL) {
+        _cmd_head = &cmd;
+    } else {
+        _cmd_tail->_next = &cmd;
+    }
+    _cmd_tail = &cmd;
+    return true;
+}
+
+inline void ModemSerial::completeCommand(Response_t rsp) {
+    AsyncCommand_t* cmd = _cmd_head;
+    _cmd_head = cmd->_next;
+    if (_cmd_head == NULL) {
+        _cmd_tail = NULL;
+    }
+
+    cmd->_response = rsp;
+    switch (rsp) {
+        case Response_t::A76XX_RESPONSE_TIMEOUT : {
+            cmd->_retcode = A76XX_OPERATION_TIMEDOUT;
+            break;
+        }
+        case Response_t::A76XX_RESPONSE_ERROR : {
+            cmd->_retcode = A76XX_GENERIC_ERROR;
+            break;
+        }
+        default : {
+            cmd->_retcode = A76XX_OPERATION_SUCCEEDED;
+        }
+    }
+    if (cmd->_parser != NULL) {
+        cmd->_parser(*cmd, *this);
+    }
+    // set before the callback, which may submit the command again
+    cmd->_state = AsyncCommand_t::DONE;
+    // taken by poll when the command was sent
+    endTransaction();
+    if (cmd->_callback != NULL) {
+        cmd->_callback(*cmd, *this);
+    }
+}
+
+inline void ModemSerial::poll() {
+    static const char* const no_match[5] = {NULL, NULL, NULL, NULL, NULL};
+    Response_t rsp;
+
+    while (true) {
+        AsyncCommand_t* cmd = _cmd_head;
+
+        // nothing pending, but URCs must still be processed
+        if (cmd == NULL) {
+            if (tryBeginTransaction()) {
+                pollResponse(no_match, rsp);
+                endTransaction();
+            }
+            return;
+        }
+
+        if (cmd->_state == AsyncCommand_t::QUEUED) {
+            // another task is using the channel, try again at the next call
+            if (!tryBeginTransaction()) {
+                return;
+            }
+            metricsCommand((const char*) cmd->_text);
+            write(cmd->_text, cmd->_len);
+            cmd->_tc = TimeoutCalc(waitTimeout(cmd->_timeout, cmd->_match));
+            cmd->_state = AsyncCommand_t::RUNNING;
+        }
+
+        if (!cmd->_in_line && pollResponse(cmd->_match, rsp)) {
+            if (!cmd->_parse_line || rsp == Response_t::A76XX_RESPONSE_OK ||
+                    rsp == Response_t::A76XX_RESPONSE_ERROR) {
+                completeCommand(rsp);
+                continue;
+            }
+            cmd->_in_line = true;
+            cmd->_response = rsp;
+        }
+        if (cmd->_in_line && pollLine(*cmd)) {
+            completeCommand(cmd->_response);
+            continue;
+        }
+        if (cmd->_tc.expired()) {
+            completeCommand(timeoutResponse());
+            continue;
+        }
+        return;
+    }
+}
+
+inline bool ModemSerial::pollLine(AsyncCommand_t& cmd) {
+    int c;
+    while ((c = read()) >= 0) {
+        if (c == '\n') {
+            cmd._in_line = false;
+            // the line ending has been consumed here, not by the matchers
+            _matcher.reset();
+            _handlers.lineStart();
+            return true;
+        }
+        if (c != '\r' && cmd._line_len < sizeof(cmd._line) - 1) {
+            cmd._line[cmd._line_len++] = c;
+            cmd._line[cmd._line_len] = '\0';
+        }
+    }
+    return false;
+}
+
+inline Response_t ModemSerial::run(AsyncCommand_t& cmd) {
+    while (cmd._state == AsyncCommand_t::QUEUED || cmd._state == AsyncCommand_t::RUNNING) {
+        {
+            // block while another task holds the channel, rather than spin
+            Transaction txn(*this);
+            poll();
+        }
+        // after poll, the head of the queue is running: sleep until data
+        // arrives for it or it times out
+        if (!cmd.done() && _cmd_head != NULL) {
+            waitAvailable(_cmd_head->_tc.remaining());
+        }
+    }
+    return cmd._response;
+}
+
+#endif /* A76XX_ASYNC_COMMAND_H_ */
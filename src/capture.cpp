@@ -0,0 +1,173 @@
+#include "A76XX.h"
+
+static void putLE(uint8_t* buf, uint32_t val, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t) (val >> (8 * i));
+    }
+}
+
+static uint32_t getLE(const uint8_t* buf, uint8_t len) {
+    uint32_t val = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        val |= (uint32_t) buf[i] << (8 * i);
+    }
+    return val;
+}
+
+SerialCapture::SerialCapture(uint8_t* buf, size_t size)
+    : _ring(buf)
+    , _size(size)
+    , _head(0)
+    , _used(0)
+    , _sink(NULL)
+    , _header_sent(false)
+    , _dropped(0) {}
+
+SerialCapture::SerialCapture(CaptureSink& sink)
+    : _ring(NULL)
+    , _size(0)
+    , _head(0)
+    , _used(0)
+    , _sink(&sink)
+    , _header_sent(false)
+    , _dropped(0) {}
+
+void SerialCapture::header(uint8_t* buf) {
+    memcpy(buf, "A76C", 4);
+    buf[4] = A76XX_CAPTURE_VERSION;
+    buf[5] = buf[6] = buf[7] = 0;
+}
+
+void SerialCapture::record(bool tx, const uint8_t* data, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    if (len > A76XX_CAPTURE_MAX_DATA) {
+        len = A76XX_CAPTURE_MAX_DATA;
+    }
+    uint8_t rec[A76XX_CAPTURE_RECORD_LEN];
+    putLE(rec, TimeoutCalc::now(), 4);
+
+    _lock.acquire();
+    if (_sink != NULL) {
+        if (!_header_sent) {
+            uint8_t head[A76XX_CAPTURE_HEADER_LEN];
+            header(head);
+            _sink->write(head, sizeof(head));
+            _header_sent = true;
+        }
+        putLE(rec + 4, len | (tx ? A76XX_CAPTURE_TX : 0), 2);
+        _sink->write(rec, sizeof(rec));
+        _sink->write(data, len);
+        _lock.release();
+        return;
+    }
+
+    if (len > _size - A76XX_CAPTURE_RECORD_LEN) {
+        len = _size - A76XX_CAPTURE_RECORD_LEN;
+    }
+    putLE(rec + 4, len | (tx ? A76XX_CAPTURE_TX : 0), 2);
+    // drop the oldest records until the new one fits
+    while (_size - _used < sizeof(rec) + len) {
+        uint8_t old[A76XX_CAPTURE_RECORD_LEN];
+        get(_head, old, sizeof(old));
+        size_t old_len = sizeof(old) + (getLE(old + 4, 2) & A76XX_CAPTURE_MAX_DATA);
+        _head = (_head + old_len) % _size;
+        _used -= old_len;
+        _dropped++;
+    }
+    put(rec, sizeof(rec));
+    put(data, len);
+    _lock.release();
+}
+
+void SerialCapture::put(const uint8_t* data, size_t len) {
+    size_t pos = (_head + _used) % _size;
+    size_t first = _size - pos < len ? _size - pos : len;
+    memcpy(_ring + pos, data, first);
+    memcpy(_ring, data + first, len - first);
+    _used += len;
+}
+
+void SerialCapture::get(size_t pos, uint8_t* data, size_t len) {
+    size_t first = _size - pos < len ? _size - pos : len;
+    memcpy(data, _ring + pos, first);
+    memcpy(data + first, _ring, len - first);
+}
+
+size_t SerialCapture::dump(CaptureSink& out) {
+    if (_ring == NULL) {
+        return 0;
+    }
+    uint8_t head[A76XX_CAPTURE_HEADER_LEN];
+    header(head);
+    _lock.acquire();
+    out.write(head, sizeof(head));
+    // the records, in at most two pieces
+    size_t first = _size - _head < _used ? _size - _head : _used;
+    out.write(_ring + _head, first);
+    if (_used > first) {
+        out.write(_ring, _used - first);
+    }
+    size_t len = sizeof(head) + _used;
+    _lock.release();
+    return len;
+}
+
+size_t SerialCapture::dump(uint8_t* buf, size_t size) {
+    if (_ring == NULL || size < A76XX_CAPTURE_HEADER_LEN) {
+        return 0;
+    }
+    header(buf);
+    size_t len = A76XX_CAPTURE_HEADER_LEN;
+    _lock.acquire();
+    // whole records only
+    size_t pos = 0;
+    while (pos < _used) {
+        uint8_t rec[A76XX_CAPTURE_RECORD_LEN];
+        get((_head + pos) % _size, rec, sizeof(rec));
+        size_t rec_len = sizeof(rec) + (getLE(rec + 4, 2) & A76XX_CAPTURE_MAX_DATA);
+        if (len + rec_len > size) {
+            break;
+        }
+        get((_head + pos) % _size, buf + len, rec_len);
+        len += rec_len;
+        pos += rec_len;
+    }
+    _lock.release();
+    return len;
+}
+
+void SerialCapture::clear() {
+    _lock.acquire();
+    _head = 0;
+    _used = 0;
+    _dropped = 0;
+    _lock.release();
+}
+
+CaptureReader::CaptureReader(const uint8_t* data, size_t len)
+    : _data(data)
+    , _len(len)
+    , _pos(A76XX_CAPTURE_HEADER_LEN) {
+    _valid = len >= A76XX_CAPTURE_HEADER_LEN
+          && memcmp(data, "A76C", 4) == 0
+          && data[4] == A76XX_CAPTURE_VERSION;
+}
+
+bool CaptureReader::next(CaptureRecord_t& rec) {
+    if (!_valid || _pos + A76XX_CAPTURE_RECORD_LEN > _len) {
+        return false;
+    }
+    uint16_t len_tx = getLE(_data + _pos + 4, 2);
+    size_t len = len_tx & A76XX_CAPTURE_MAX_DATA;
+    if (_pos + A76XX_CAPTURE_RECORD_LEN + len > _len) {
+        return false;
+    }
+    rec.time_ms = getLE(_data + _pos, 4);
+    rec.tx = (len_tx & A76XX_CAPTURE_TX) != 0;
+    rec.data = _data + _pos + A76XX_CAPTURE_RECORD_LEN;
+    rec.len = len;
+    _pos += A76XX_CAPTURE_RECORD_LEN + len;
+    return true;
+}
@@ -0,0 +1,186 @@
+#ifndef A76XX_CAPTURE_H_
+#define A76XX_CAPTURE_H_
+
+#include "A76XX.h"
+
+/*
+    Format of a capture, as written by SerialCapture::dump and read by CaptureReader.
+
+    A header of A76XX_CAPTURE_HEADER_LEN bytes: the magic "A76C", the version of
+    the format and three reserved bytes. Then one record per chunk of data, in
+    the order the chunks went through the serial object: the time in milliseconds
+    (4 bytes), the length of the data, with A76XX_CAPTURE_TX set for data sent to
+    the module (2 bytes), then the data. Numbers are little endian.
+*/
+#define A76XX_CAPTURE_VERSION          1
+#define A76XX_CAPTURE_HEADER_LEN       8
+#define A76XX_CAPTURE_RECORD_LEN       6
+#define A76XX_CAPTURE_TX          0x8000
+#define A76XX_CAPTURE_MAX_DATA    0x7FFF
+
+/*
+    @brief Where a capture is written to, e.g. a file or a socket.
+*/
+class CaptureSink {
+  public:
+    /*
+        @brief Write part of a capture. Called with the lock of the capture held,
+            from the task that sent or received the data: it must not block for long.
+    */
+    virtual void write(const uint8_t* data, size_t len) = 0;
+
+    virtual ~CaptureSink() {}
+};
+
+/*
+    @brief A record of a capture, see CaptureReader.
+*/
+struct CaptureRecord_t {
+    uint32_t           time_ms;
+    bool                    tx;
+    const uint8_t*        data;
+    size_t                 len;
+};
+
+/*
+    @brief Records the data sent and received by serial objects, with the time,
+        see ModemSerial::setCapture.
+
+    @details Records are kept in a ring, on a buffer given by the application,
+        the oldest being dropped to make room for new ones, or are passed on to a
+        sink as they come. Recording a chunk of data costs two copies and no
+        formatting. The ring is turned into a capture by ::dump, e.g. to upload it
+        when something went wrong, and can be replayed on a host with
+        ModemSerialMock::replay.
+
+        A capture can be shared by several serial objects, e.g. the channels of a
+        CMUX multiplexer, or the physical link below them.
+
+        Example:
+
+            static uint8_t ring[8192];
+            SerialCapture capture(ring, sizeof(ring));
+            serial.setCapture(&capture);
+            ...
+            capture.dump(sink);
+*/
+class SerialCapture {
+  public:
+    /*
+        @brief Record into a ring.
+
+        @param [IN] buf The storage of the ring, which must outlive the object.
+        @param [IN] size The size of the storage, at least A76XX_CAPTURE_RECORD_LEN
+            + 1 bytes.
+    */
+    SerialCapture(uint8_t* buf, size_t size);
+
+    /*
+        @brief Record to a sink, starting with the header of the capture.
+    */
+    SerialCapture(CaptureSink& sink);
+
+    /*
+        @brief Record a chunk of data, called by the serial objects. Chunks
+            longer than the ring, or A76XX_CAPTURE_MAX_DATA, are truncated.
+
+        @param [IN] tx Whether the data has been sent to the module.
+    */
+    void record(bool tx, const uint8_t* data, size_t len);
+
+    /*
+        @brief Write the capture of the records in the ring, from the oldest.
+
+        @return The number of bytes written, 0 without a ring.
+    */
+    size_t dump(CaptureSink& out);
+
+    /*
+        @brief Copy the capture of the records in the ring, from the oldest, as
+            long as they fit in the buffer.
+
+        @return The number of bytes copied, 0 without a ring.
+    */
+    size_t dump(uint8_t* buf, size_t size);
+
+    /*
+        @brief The size of the capture written by ::dump.
+    */
+    size_t size() {
+        return _ring == NULL ? 0 : A76XX_CAPTURE_HEADER_LEN + _used;
+    }
+
+    /*
+        @brief Drop all records.
+    */
+    void clear();
+
+    /*
+        @brief Number of records dropped to make room for new ones.
+    */
+    uint32_t dropped() {
+        return _dropped;
+    }
+
+  private:
+    uint8_t*                            _ring;
+    size_t                              _size;
+    size_t                              _head;
+    size_t                              _used;
+    CaptureSink*                        _sink;
+    bool                       _header_sent;
+    uint32_t                         _dropped;
+    ChannelLock                         _lock;
+
+    static void header(uint8_t* buf);
+
+    // copy in and out of the ring, wrapping around
+    void put(const uint8_t* data, size_t len);
+    void get(size_t pos, uint8_t* data, size_t len);
+};
+
+/*
+    @brief Iterate over the records of a capture.
+
+    Example:
+
+        CaptureReader reader(data, len);
+        CaptureRecord_t rec;
+        while (reader.next(rec)) {
+            ...
+        }
+*/
+class CaptureReader {
+  public:
+    CaptureReader(const uint8_t* data, size_t len);
+
+    /*
+        @brief Whether the data starts with the header of a capture of this version.
+    */
+    bool valid() {
+        return _valid;
+    }
+
+    /*
+        @brief Read the next record.
+
+        @return False at the end of the capture, or if the rest of the capture is
+            truncated.
+    */
+    bool next(CaptureRecord_t& rec);
+
+    /*
+        @brief Start again from the first record.
+    */
+    void rewind() {
+        _pos = A76XX_CAPTURE_HEADER_LEN;
+    }
+
+  private:
+    const uint8_t*                      _data;
+    size_t                               _len;
+    size_t                               _pos;
+    bool                               _valid;
+};
+
+#endif /* A76XX_CAPTURE_H_ */
@@ -32,32 +32,14 @@ class GNSSOnNMEAMessage : public EventHandler_t {
     */
     GNSSOnNMEAMessage(const char* match_string, 
         CircularBuffer<NMEAMessage_t, GNSS_NMEA_QUEUE_SIZE>& queue)
-        : EventHandler_t(match_string)
+        : EventHandler_t(match_string, true)
         , _nmea_queue(queue) {}
     
-    void process(ModemSerial* serial) {
+    void processFrame(URCFrame_t& frame) {
         NMEAMessage_t msg;
-        uint16_t i;
 
-        // copy the match string at the beginning of the message to have the full message
-        for (i = 0; i < strlen(match_string); i++)
-            msg.payload[i] = match_string[i];
-        
-        // keep reading from that point until <CR>, then read <LF> and close the string
-        for (i = strlen(match_string); i < NMEA_MESSAGE_SIZE; i++) {
-            // wait until a char becomes available
-            while (serial->available() == 0) {}
-
-            // read and process
-            char c = static_cast<char>(serial->read());
-            if (c == '\r') {
-                serial->read(); 
-                msg.payload[i] = '\0';
-                break;
-            } else {
-                msg.payload[i] = c;
-            }
-        }
+        // the match string at the beginning of the message, then the rest of the line
+        snprintf(msg.payload, sizeof(msg.payload), "%s%s", match_string, frame.line);
 
         _nmea_queue.push(msg);
     }
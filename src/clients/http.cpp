@@ -69,7 +69,10 @@ bool A76XXHTTPClient::request(uint8_t method,
                               const char* content_type,
                               const char* accept) {
     int8_t retcode;
-    
+
+    // the request parameters are shared by all users of the module
+    ModemSerial::Transaction txn(_serial);
+
     // set url
     retcode = _http_cmds.configHttpURL(_server_name, _server_port, path, _use_ssl);
     A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
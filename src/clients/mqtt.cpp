@@ -1,39 +1,289 @@
 #include "A76XX.h"
 
 
-void MQTTOnMessageRx::process(ModemSerial* serial) {
-    MQTTMessage_t msg;
+size_t MQTTOnMessageRx::bodyLength(URCFrame_t& frame) {
+    if (_sink != NULL) {
+        streamLine(frame);
+    }
+    // the topic and the payload follow the lines "TOPIC: <client_index>,<length>"
+    // and "PAYLOAD: <client_index>,<length>", long payloads in several pieces
+    if (frame.startsWith("TOPIC: ") || frame.startsWith("PAYLOAD: ")) {
+        frame.find(',');
+        return frame.parseInt();
+    }
+    return 0;
+}
 
-    // skip the client index
-    serial->find(','); uint16_t   topic_length = serial->parseInt();
-    serial->find(','); uint16_t payload_length = serial->parseInt();
+void MQTTOnMessageRx::streamLine(URCFrame_t& frame) {
+    // "START: <client_index>,<topic_total_len>,<payload_total_len>"
+    if (frame.startsWith("START: ")) {
+        if (_streaming) {
+            _sink->end(false);
+        }
+        frame.find(',');
+        _topic_left = frame.parseInt();
+        frame.find(',');
+        _payload_left = frame.parseInt();
+        _streaming = true;
+        _sink->begin(_topic_left, _payload_left);
+    } else if (frame.startsWith("TOPIC: ")) {
+        _in_topic = true;
+    } else if (frame.startsWith("PAYLOAD: ")) {
+        _in_topic = false;
+    } else if (frame.startsWith("END: ") && _streaming) {
+        _streaming = false;
+        _sink->end(_topic_left == 0 && _payload_left == 0);
+    }
+}
 
-    serial->waitResponse("+CMQTTRXTOPIC: "); serial->find('\n');
-    if (topic_length < sizeof(msg.topic)) {
-        serial->readBytes(msg.topic, topic_length);
-        msg.topic[topic_length] = '\0';
+void MQTTOnMessageRx::bodyChunk(const uint8_t* data, size_t len) {
+    size_t& left = _in_topic ? _topic_left : _payload_left;
+    left = len < left ? left - len : 0;
+    if (_in_topic) {
+        _sink->topic(data, len);
     } else {
-        // read what we can't store, then overwrite
-        serial->readBytes(msg.topic, topic_length - sizeof(msg.topic) + 1);
-        serial->readBytes(msg.topic, sizeof(msg.topic) - 1);
-        msg.topic[sizeof(msg.topic)] = '\0';
+        _sink->payload(data, len);
     }
+}
 
-    serial->waitResponse("+CMQTTRXPAYLOAD: "); serial->find('\n');
-    if (payload_length < sizeof(msg.payload)) {
-        serial->readBytes(msg.payload, payload_length);
-        msg.payload[payload_length] = '\0';
-    } else {
-        // read what we can't store, then overwrite
-        serial->readBytes(msg.payload, payload_length - sizeof(msg.payload) + 1);
-        serial->readBytes(msg.payload, sizeof(msg.payload) - 1);
-        msg.payload[sizeof(msg.payload)] = '\0';
+void MQTTOnMessageRx::setSink(MQTTMessageSink* sink) {
+    if (_streaming) {
+        _sink->end(false);
+        _streaming = false;
+    }
+    _sink = sink;
+}
+
+// append what fits in buf, leaving room for the terminator
+static void appendData(char* buf, size_t size, size_t& len, const uint8_t* data, size_t data_len) {
+    if (data_len > size - 1 - len) {
+        data_len = size - 1 - len;
+    }
+    memcpy(buf + len, data, data_len);
+    len += data_len;
+}
+
+MQTTMessageQueue::MQTTMessageQueue(uint8_t* buf, size_t size)
+    : _buf(buf)
+    , _size(size)
+    , _head(0)
+    , _tail(0)
+    , _pushed(0)
+    , _popped(0)
+    , _dropped(0)
+    , _restart(false)
+    , _writing(false)
+    , _restarting(false) {}
+
+bool MQTTMessageQueue::reserve(size_t length, size_t& start) {
+    size_t head = _head;
+    // a restart the reader has not seen yet left nothing before the head
+    size_t tail = __atomic_load_n(&_restart, __ATOMIC_ACQUIRE) ? 0 : __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+    _restarting = false;
+    // empty, and the reader holds no message: the whole ring is free
+    if (head == tail) {
+        _restarting = head != 0;
+        start = 0;
+        return true;
+    }
+    // the head never catches up with the tail, which would mean empty
+    if (head > tail) {
+        if (_size - head > length || (_size - head == length && tail > 0)) {
+            start = head;
+            return true;
+        }
+        if (tail > length) {
+            // mark the end of the ring, if there is room for it
+            if (_size - head >= sizeof(RecordHeader)) {
+                RecordHeader wrap = {(uint32_t) (_size - head), RECORD_WRAP, 0};
+                memcpy(_buf + head, &wrap, sizeof(wrap));
+            }
+            start = 0;
+            return true;
+        }
+        return false;
+    }
+    if (tail - head > length) {
+        start = head;
+        return true;
+    }
+    return false;
+}
+
+void MQTTMessageQueue::begin(size_t topic_len, size_t payload_len) {
+    if (_writing) {
+        _dropped++;
+    }
+    _record.topic_len = topic_len;
+    _record.payload_len = payload_len;
+    _record.length = sizeof(RecordHeader) + topic_len + 1 + payload_len + 1;
+    _topic_fill = 0;
+    _payload_fill = 0;
+    _writing = _record.length < _size && reserve(_record.length, _start);
+    if (!_writing) {
+        _dropped++;
+    }
+}
+
+void MQTTMessageQueue::topic(const uint8_t* data, size_t len) {
+    if (!_writing) {
+        return;
+    }
+    if (len > _record.topic_len - _topic_fill) {
+        len = _record.topic_len - _topic_fill;
+    }
+    memcpy(_buf + _start + sizeof(RecordHeader) + _topic_fill, data, len);
+    _topic_fill += len;
+}
+
+void MQTTMessageQueue::payload(const uint8_t* data, size_t len) {
+    if (!_writing) {
+        return;
+    }
+    if (len > _record.payload_len - _payload_fill) {
+        len = _record.payload_len - _payload_fill;
+    }
+    memcpy(_buf + _start + sizeof(RecordHeader) + _record.topic_len + 1 + _payload_fill, data, len);
+    _payload_fill += len;
+}
+
+void MQTTMessageQueue::end(bool complete) {
+    if (!_writing) {
+        return;
+    }
+    _writing = false;
+    if (!complete || _topic_fill != _record.topic_len || _payload_fill != _record.payload_len) {
+        _dropped++;
+        return;
+    }
+    uint8_t* rec = _buf + _start;
+    memcpy(rec, &_record, sizeof(_record));
+    rec[sizeof(RecordHeader) + _record.topic_len] = '\0';
+    rec[_record.length - 1] = '\0';
+    size_t head = _start + _record.length;
+    // the reader moves its tail to 0 when it sees the record
+    if (_restarting) {
+        __atomic_store_n(&_restart, true, __ATOMIC_RELEASE);
+    }
+    // the record is written before it is published to the reader
+    __atomic_store_n(&_head, head == _size ? 0 : head, __ATOMIC_RELEASE);
+    __atomic_store_n(&_pushed, _pushed + 1, __ATOMIC_RELEASE);
+}
+
+uint32_t MQTTMessageQueue::available() {
+    return __atomic_load_n(&_pushed, __ATOMIC_ACQUIRE) - _popped;
+}
+
+void MQTTMessageQueue::skipWrap(size_t head) {
+    // the writer started over at 0 once the ring was empty, the record there is
+    // complete even if its end is the old position of the head
+    if (__atomic_load_n(&_restart, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&_tail, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&_restart, false, __ATOMIC_RELEASE);
+        return;
+    }
+    if (_tail == head) {
+        return;
+    }
+    RecordHeader header;
+    if (_size - _tail < sizeof(RecordHeader)) {
+        __atomic_store_n(&_tail, 0, __ATOMIC_RELEASE);
+        return;
+    }
+    memcpy(&header, _buf + _tail, sizeof(header));
+    if (header.topic_len == RECORD_WRAP) {
+        __atomic_store_n(&_tail, 0, __ATOMIC_RELEASE);
+    }
+}
+
+bool MQTTMessageQueue::peek(MQTTMessageView_t& msg) {
+    size_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    skipWrap(head);
+    if (_tail == head) {
+        return false;
+    }
+    RecordHeader header;
+    memcpy(&header, _buf + _tail, sizeof(header));
+    msg.topic = (const char*) _buf + _tail + sizeof(RecordHeader);
+    msg.topic_len = header.topic_len;
+    msg.payload = _buf + _tail + sizeof(RecordHeader) + header.topic_len + 1;
+    msg.payload_len = header.payload_len;
+    return true;
+}
+
+void MQTTMessageQueue::release() {
+    size_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+    skipWrap(head);
+    if (_tail == head) {
+        return;
+    }
+    RecordHeader header;
+    memcpy(&header, _buf + _tail, sizeof(header));
+    size_t tail = _tail + header.length;
+    __atomic_store_n(&_tail, tail == _size ? 0 : tail, __ATOMIC_RELEASE);
+    __atomic_store_n(&_popped, _popped + 1, __ATOMIC_RELEASE);
+}
+
+void MQTTOnMessageRx::processFrame(URCFrame_t& frame) {
+    // streamed as captured, routed once complete
+    if (_sink != NULL) {
+        if (_router != NULL && _queue != NULL && frame.startsWith("END: ")) {
+            _router->dispatch(*_queue);
+        }
+        return;
+    }
+    if (frame.startsWith("START: ")) {
+        _topic_len = 0;
+        _payload_len = 0;
+    } else if (frame.startsWith("TOPIC: ")) {
+        appendData(_msg.topic, sizeof(_msg.topic), _topic_len, frame.body, frame.body_len);
+    } else if (frame.startsWith("PAYLOAD: ")) {
+        appendData(_msg.payload, sizeof(_msg.payload), _payload_len, frame.body, frame.body_len);
+    } else if (frame.startsWith("END: ")) {
+        _msg.topic[_topic_len] = '\0';
+        _msg.payload[_payload_len] = '\0';
+
+        if(_mqttEvtCb) _mqttEvtCb(&_msg);
     }
+}
 
-    serial->waitResponse("+CMQTTRXEND: "); serial->find('\n');
+void MQTTOnPublish::processFrame(URCFrame_t& frame) {
+    // the line sent before ERROR, when publishing failed straight away
+    if (++_processed == _skip) {
+        return;
+    }
+    frame.find(',');
+    complete(frame.parseInt());
+}
+
+uint16_t MQTTOnPublish::push(uint8_t pub_timeout, const uint32_t* outbox_seq) {
+    InFlight& entry = _in_flight[(_head + _count) % MQTT_PUBLISH_WINDOW];
+    entry.id = _next_id++;
+    entry.expiry_ms = TimeoutCalc::now() + pub_timeout * 1000UL + MQTT_PUBLISH_MARGIN;
+    entry.from_outbox = outbox_seq != NULL;
+    entry.outbox_seq = outbox_seq != NULL ? *outbox_seq : 0;
+    _count++;
+    return entry.id;
+}
+
+void MQTTOnPublish::complete(int8_t retcode) {
+    if (_count == 0) {
+        return;
+    }
+    InFlight entry = _in_flight[_head];
+    _head = (_head + 1) % MQTT_PUBLISH_WINDOW;
+    _count--;
+    if (entry.from_outbox) {
+        if (_outbox != NULL) {
+            _outbox->settle(entry.outbox_seq, retcode == 0);
+        }
+    } else if (_callback != NULL) {
+        _callback(entry.id, retcode);
+    }
+}
 
-    //messageQueue.push(msg); //use callback function instead
-    if(_mqttEvtCb) _mqttEvtCb(&msg);
+bool MQTTOnPublish::oldestExpired() {
+    return _count > 0 && (int32_t) (TimeoutCalc::now() - _in_flight[_head].expiry_ms) >= 0;
 }
 
 A76XXMQTTClient::A76XXMQTTClient(A76XX& modem, const char* clientID, bool use_ssl, mqttEvtCb_t mqttCallback)
@@ -42,9 +292,19 @@ A76XXMQTTClient::A76XXMQTTClient(A76XX& modem, const char* clientID, bool use_ss
     , _clientID(clientID)
     , _use_ssl(use_ssl)
     , _on_message_rx_handler(mqttCallback)
+    , _rx_queue(_rx_arena, sizeof(_rx_arena))
+    , _router(NULL)
+    , _publish_window(0)
+    , _outbox(NULL)
+    , _outbox_connected(false)
+    , _outbox_check_ms(0)
+    , _draining(false)
     , _client_index(0)
     , _session_id(0) {
         // enable parsing MQTT URCs
+        if (mqttCallback == NULL) {
+            _on_message_rx_handler.setSink(&_rx_queue);
+        }
         _serial.registerEventHandler(&_on_message_rx_handler);
     }
 
@@ -77,16 +337,24 @@ bool A76XXMQTTClient::connect(const char* server_name, int port,
                               int will_qos) {
     int8_t retcode;
 
-    if (will_message != NULL && will_topic != NULL) {
-        retcode = _mqtt_cmds.setWillTopic(_client_index, will_topic);
-        A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
-        retcode = _mqtt_cmds.setWillMessage(_client_index, will_message, will_qos);
+    {
+        // the will must not be replaced by another task before connecting
+        ModemSerial::Transaction txn(_serial);
+
+        if (will_message != NULL && will_topic != NULL) {
+            retcode = _mqtt_cmds.setWillTopic(_client_index, will_topic);
+            A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
+            retcode = _mqtt_cmds.setWillMessage(_client_index, will_message, will_qos);
+            A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
+        }
+
+        retcode = _mqtt_cmds.connect(_client_index, server_name, port, clean_session, keepalive, username, password);
         A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
     }
 
-    retcode = _mqtt_cmds.connect(_client_index, server_name, port, clean_session, keepalive, username, password);
-    A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
-
+    // the messages held while disconnected
+    _outbox_connected = true;
+    drainOutbox();
     return true;
 }
 
@@ -112,7 +380,22 @@ bool A76XXMQTTClient::publish(const char* topic,
                               uint8_t qos,
                               uint8_t pub_timeout,
                               bool retained,
-                              bool dup) {
+                              bool dup,
+                              const Deadline& deadline) {
+    // the outcome of pipelined messages would be taken for that of this one
+    if (!waitPublished(0, deadline.remaining())) {
+        return false;
+    }
+
+    // topic and payload are held by the module until the message is published
+    ModemSerial::Transaction txn(_serial, deadline);
+
+    // the module should not wait for the acknowledgement longer than we do
+    uint32_t left = deadline.remaining() / 1000;
+    if (left < pub_timeout) {
+        pub_timeout = left > 0 ? left : 1;
+    }
+
     int8_t retcode = _mqtt_cmds.setTopic(_client_index, topic);
     A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
 
@@ -130,9 +413,219 @@ bool A76XXMQTTClient::publish(const char* topic,
                               uint8_t qos,
                               uint8_t pub_timeout,
                               bool retained,
-                              bool dup) {
+                              bool dup,
+                              const Deadline& deadline) {
     return publish(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload), qos,
-            pub_timeout, retained, dup);
+            pub_timeout, retained, dup, deadline);
+}
+
+bool A76XXMQTTClient::setPublishWindow(uint8_t window, mqttPubCb_t callback) {
+    if (window > MQTT_PUBLISH_WINDOW) {
+        window = MQTT_PUBLISH_WINDOW;
+    }
+    if (window > 0) {
+        _on_publish_handler.setCallback(callback);
+        if (_publish_window == 0) {
+            _on_publish_handler.reset();
+            _serial.registerEventHandler(&_on_publish_handler);
+        }
+        _publish_window = window;
+        return true;
+    }
+    if (_publish_window == 0) {
+        return true;
+    }
+    // the messages in flight would be taken for timed out
+    if (_on_publish_handler.count() > 0 && _serial.eventsDeferred()) {
+        _last_error_code = A76XX_GENERIC_ERROR;
+        return false;
+    }
+    bool ok = waitPublished(0);
+    _serial.deRegisterEventHandler(&_on_publish_handler);
+    // outcomes that never came
+    while (_on_publish_handler.count() > 0) {
+        _on_publish_handler.complete(A76XX_OPERATION_TIMEDOUT);
+    }
+    _publish_window = 0;
+    return ok;
+}
+
+bool A76XXMQTTClient::waitPublished(uint8_t max_in_flight, uint32_t timeout) {
+    // the outcomes would only be processed after waiting for them
+    if (_on_publish_handler.count() > max_in_flight && _serial.eventsDeferred()) {
+        _last_error_code = A76XX_GENERIC_ERROR;
+        return false;
+    }
+    TimeoutCalc tc(timeout);
+    while (_on_publish_handler.count() > max_in_flight) {
+        if (_on_publish_handler.oldestExpired()) {
+            ModemSerial::Transaction txn(_serial);
+            _on_publish_handler.complete(A76XX_OPERATION_TIMEDOUT);
+            continue;
+        }
+        if (tc.expired()) {
+            _last_error_code = A76XX_OPERATION_TIMEDOUT;
+            return false;
+        }
+        // outcomes are reported at the end of the transaction of listen
+        if (_serial.waitAvailable(tc.remaining())) {
+            _serial.listen(10);
+        }
+    }
+    return true;
+}
+
+bool A76XXMQTTClient::publishPipelined(const char* topic,
+                                       const uint8_t* payload,
+                                       uint32_t length,
+                                       uint8_t qos,
+                                       uint8_t pub_timeout,
+                                       bool retained,
+                                       bool dup,
+                                       uint16_t* msg_id) {
+    return pipeline(topic, payload, length, qos, pub_timeout, retained, dup, msg_id, NULL);
+}
+
+bool A76XXMQTTClient::pipeline(const char* topic,
+                               const uint8_t* payload,
+                               uint32_t length,
+                               uint8_t qos,
+                               uint8_t pub_timeout,
+                               bool retained,
+                               bool dup,
+                               uint16_t* msg_id,
+                               const uint32_t* outbox_seq) {
+    if (_publish_window == 0) {
+        _last_error_code = A76XX_GENERIC_ERROR;
+        return false;
+    }
+    if (!waitPublished(_publish_window - 1, pub_timeout * 1000UL + MQTT_PUBLISH_MARGIN)) {
+        return false;
+    }
+
+    ModemSerial::Transaction txn(_serial);
+
+    int8_t retcode = _mqtt_cmds.setTopic(_client_index, topic);
+    A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
+
+    retcode = _mqtt_cmds.setPayload(_client_index, payload, length);
+    A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
+
+    uint32_t captured = _on_publish_handler.captured();
+    retcode = _mqtt_cmds.publishNoWait(_client_index, qos, pub_timeout, retained, dup);
+    if (retcode != A76XX_OPERATION_SUCCEEDED && _on_publish_handler.captured() != captured) {
+        _on_publish_handler.skipLast();
+    }
+    A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
+
+    uint16_t id = _on_publish_handler.push(pub_timeout, outbox_seq);
+    if (msg_id != NULL) {
+        *msg_id = id;
+    }
+    return true;
+}
+
+bool A76XXMQTTClient::publishPipelined(const char* topic,
+                                       const char* payload,
+                                       uint8_t qos,
+                                       uint8_t pub_timeout,
+                                       bool retained,
+                                       bool dup,
+                                       uint16_t* msg_id) {
+    return publishPipelined(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload),
+            qos, pub_timeout, retained, dup, msg_id);
+}
+
+void A76XXMQTTClient::setOutbox(MQTTOutbox* outbox) {
+    ModemSerial::Transaction txn(_serial, true);
+    _outbox = outbox;
+    _on_publish_handler.setOutbox(outbox);
+}
+
+bool A76XXMQTTClient::publishQueued(const char* topic,
+                                    const uint8_t* payload,
+                                    uint32_t length,
+                                    uint8_t qos,
+                                    uint8_t pub_timeout,
+                                    bool retained) {
+    if (_outbox == NULL) {
+        return publish(topic, payload, length, qos, pub_timeout, retained);
+    }
+    bool queued;
+    {
+        ModemSerial::Transaction txn(_serial, true);
+        queued = _outbox->push(topic, payload, length, qos, pub_timeout, retained);
+    }
+    drainOutbox();
+    if (!queued) {
+        _last_error_code = A76XX_GENERIC_ERROR;
+    }
+    return queued;
+}
+
+bool A76XXMQTTClient::publishQueued(const char* topic,
+                                    const char* payload,
+                                    uint8_t qos,
+                                    uint8_t pub_timeout,
+                                    bool retained) {
+    return publishQueued(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload),
+            qos, pub_timeout, retained);
+}
+
+bool A76XXMQTTClient::outboxConnected() {
+    if (_outbox_connected) {
+        return true;
+    }
+    if (TimeoutCalc::now() - _outbox_check_ms < MQTT_OUTBOX_RETRY_MS && _outbox_check_ms != 0) {
+        return false;
+    }
+    _outbox_check_ms = TimeoutCalc::now();
+    _outbox_connected = isConnected();
+    return _outbox_connected;
+}
+
+uint32_t A76XXMQTTClient::drainOutbox(uint32_t max_messages) {
+    if (_outbox == NULL || _draining || _outbox->depth() == 0 || !outboxConnected()) {
+        return 0;
+    }
+    _draining = true;
+    uint32_t sent = 0;
+    while (sent < max_messages) {
+        // wait for room outside of the transaction, for outcomes to be processed
+        if (_publish_window > 0 && !waitPublished(_publish_window - 1, MQTT_PUBLISH_MARGIN)) {
+            break;
+        }
+
+        ModemSerial::Transaction txn(_serial);
+        OutboxRecord_t rec;
+        if (!_outbox->next(rec)) {
+            break;
+        }
+        bool ok;
+        if (_publish_window > 0) {
+            ok = pipeline(rec.topic, rec.payload, rec.length, rec.qos, rec.pub_timeout,
+                          rec.retained, false, NULL, &rec.seq);
+            if (ok) {
+                _outbox->publishing(rec.seq);
+            }
+        } else {
+            ok = publish(rec.topic, rec.payload, rec.length, rec.qos, rec.pub_timeout, rec.retained);
+            _outbox->settle(rec.seq, ok);
+        }
+        if (!ok) {
+            // check the connection before trying again
+            _outbox_connected = false;
+            _outbox_check_ms = TimeoutCalc::now();
+            break;
+        }
+        sent++;
+    }
+    {
+        ModemSerial::Transaction txn(_serial, true);
+        _outbox->sync();
+    }
+    _draining = false;
+    return sent;
 }
 
 bool A76XXMQTTClient::subscribe(const char* topic, uint8_t qos) {
@@ -141,12 +634,69 @@ bool A76XXMQTTClient::subscribe(const char* topic, uint8_t qos) {
     return true;
 }
 
+bool A76XXMQTTClient::subscribe(const char* filter, uint8_t qos, mqttRouteCb_t handler, void* context) {
+    if (_router == NULL || !_router->add(filter, handler, context)) {
+        _last_error_code = A76XX_GENERIC_ERROR;
+        return false;
+    }
+    if (!subscribe(filter, qos)) {
+        _router->remove(filter, handler, context);
+        return false;
+    }
+    return true;
+}
+
+void A76XXMQTTClient::setRouter(MQTTRouter* router) {
+    ModemSerial::Transaction txn(_serial, true);
+    _router = router;
+    _on_message_rx_handler.setRouter(router, &_rx_queue);
+}
+
+uint32_t A76XXMQTTClient::dispatchMessages() {
+    if (_router == NULL) {
+        return 0;
+    }
+    // the queue has a single reader, which may also be the RX task
+    ModemSerial::Transaction txn(_serial, true);
+    return _router->dispatch(_rx_queue);
+}
+
+void A76XXMQTTClient::setMessageSink(MQTTMessageSink* sink) {
+    // not while a message is being captured
+    ModemSerial::Transaction txn(_serial, true);
+    if (sink == NULL && !_on_message_rx_handler.hasCallback()) {
+        sink = &_rx_queue;
+    }
+    _on_message_rx_handler.setSink(sink);
+}
+
 uint32_t A76XXMQTTClient::messageAvailable() {
-    return _on_message_rx_handler.messageQueue.size();
+    return _rx_queue.available();
+}
+
+bool A76XXMQTTClient::peekMessage(MQTTMessageView_t& msg) {
+    return _rx_queue.peek(msg);
+}
+
+void A76XXMQTTClient::releaseMessage() {
+    _rx_queue.release();
 }
 
 MQTTMessage_t A76XXMQTTClient::getMessage() {
-    return _on_message_rx_handler.messageQueue.shift();
+    MQTTMessage_t msg;
+    msg.topic[0] = '\0';
+    msg.payload[0] = '\0';
+    MQTTMessageView_t view;
+    if (_rx_queue.peek(view)) {
+        size_t len = view.topic_len < sizeof(msg.topic) - 1 ? view.topic_len : sizeof(msg.topic) - 1;
+        memcpy(msg.topic, view.topic, len);
+        msg.topic[len] = '\0';
+        len = view.payload_len < sizeof(msg.payload) - 1 ? view.payload_len : sizeof(msg.payload) - 1;
+        memcpy(msg.payload, view.payload, len);
+        msg.payload[len] = '\0';
+        _rx_queue.release();
+    }
+    return msg;
 }
 
 bool A76XXMQTTClient::isConnected() {
@@ -12,33 +12,327 @@ struct MQTTMessage_t {
 typedef void (*mqttEvtCb_t) (MQTTMessage_t* msg);
 
 /*
-    @brief Handler of the URC "+CMQTTRXSTART".
-
-    @details This object is responsible of detecting, parsing and storing 
-        incoming MQTT messages sent to the device. It has one important 
-        member, "messageQueue", i.e. a CircularBuffer object used to store 
-        incoming messages if they arrive at a high rate. The size of this
-        buffer is define by the variable MQTT_MESSAGE_QUEUE_SIZE. If messages
-        arrive at a faster rate than they are read, older messages are dropped.
-        The maximum length of the topic and payload of MQTT messages shored in 
-        this queue if defined by the variables MQTT_TOPIC_BUFFER_LEN and 
-        MQTT_PAYLOAD_BUFFER_LEN, respectively.
+    @brief Receiver of incoming MQTT messages of any length, see
+        A76XXMQTTClient::setMessageSink.
+
+    @details The topic and the payload are passed in chunks, as they are received
+        from the module, with no copy in between. For each message, ::begin is
+        called first with the total lengths announced by the module, then ::topic
+        and ::payload with consecutive chunks, then ::end. The methods are called
+        in the middle of the command in flight, or by the RX task of
+        ModemSerialESP, so they must neither block nor issue commands: store the
+        data, or flag it for the main loop.
+*/
+class MQTTMessageSink {
+  public:
+    virtual void begin(size_t topic_len, size_t payload_len) = 0;
+    virtual void topic(const uint8_t* data, size_t len) = 0;
+    virtual void payload(const uint8_t* data, size_t len) = 0;
+
+    /*
+        @param [IN] complete Whether all the bytes announced by ::begin were received.
+    */
+    virtual void end(bool complete) = 0;
+
+    virtual ~MQTTMessageSink() {}
+};
+
+/*
+    @brief A received message, in place in a MQTTMessageQueue. The topic and the
+        payload are followed by a null character.
+*/
+struct MQTTMessageView_t {
+    const char*                               topic;
+    size_t                                topic_len;
+    const uint8_t*                          payload;
+    size_t                              payload_len;
+};
+
+/*
+    @brief Queue of received MQTT messages, kept back to back in a ring of bytes, so
+        that the same memory holds many short messages or a few long ones.
+
+    @details Messages are written as they are received, as a MQTTMessageSink, in
+        a record of their exact length, which is reserved when the module announces
+        the message and never wraps around the end of the ring. When there is no
+        room, the new message is dropped, as are messages not received entirely.
+        In an empty queue the writer starts over at the beginning of the ring, so
+        any message shorter than the ring fits there, whatever came before.
+
+        Messages are read in place with ::peek, then removed with ::release. One
+        task can write while another reads, e.g. the RX task of ModemSerialESP and
+        the application, without locks.
+*/
+class MQTTMessageQueue : public MQTTMessageSink {
+  public:
+    /*
+        @param [IN] buf The storage of the messages, which must outlive the object.
+        @param [IN] size The size of the storage.
+    */
+    MQTTMessageQueue(uint8_t* buf, size_t size);
+
+    void begin(size_t topic_len, size_t payload_len);
+    void topic(const uint8_t* data, size_t len);
+    void payload(const uint8_t* data, size_t len);
+    void end(bool complete);
+
+    /*
+        @brief Number of messages that can be read.
+    */
+    uint32_t available();
+
+    /*
+        @brief Look at the oldest message, without removing it.
+
+        @return False if there is none. Otherwise the message stays valid until
+            ::release is called.
+    */
+    bool peek(MQTTMessageView_t& msg);
+
+    /*
+        @brief Remove the oldest message.
+    */
+    void release();
+
+    /*
+        @brief Number of messages dropped, for lack of room or because they were
+            not received entirely.
+    */
+    uint32_t dropped() {
+        return _dropped;
+    }
+
+  private:
+    // stored before the topic of each message, or marking the end of the ring
+    // when the next message did not fit there, with topic_len set to RECORD_WRAP
+    struct RecordHeader {
+        uint32_t          length;
+        uint32_t       topic_len;
+        uint32_t     payload_len;
+    };
+    static const uint32_t RECORD_WRAP = 0xFFFFFFFF;
+
+    uint8_t*                                     _buf;
+    size_t                                      _size;
+    // offsets of the end of the last message written and of the oldest message,
+    // each only changed by the writer and the reader respectively
+    size_t                                      _head;
+    size_t                                      _tail;
+    uint32_t                                  _pushed;
+    uint32_t                                  _popped;
+    uint32_t                                 _dropped;
+    // set by the writer when it started over at 0 in an empty ring, cleared by
+    // the reader once its tail has followed
+    bool                                     _restart;
+
+    // the message being written, if any
+    bool                                     _writing;
+    bool                                  _restarting;
+    size_t                                     _start;
+    RecordHeader                              _record;
+    size_t                                _topic_fill;
+    size_t                              _payload_fill;
+
+    // where a record of the given length fits, or false
+    bool reserve(size_t length, size_t& start);
+    // move to the start of the ring, past its end or after a restart of the writer
+    void skipWrap(size_t head);
+};
+
+/*
+    @brief Handler of the URCs "+CMQTTRXSTART", "+CMQTTRXTOPIC", "+CMQTTRXPAYLOAD"
+        and "+CMQTTRXEND".
+
+    @details This object is responsible of detecting and parsing incoming MQTT
+        messages sent to the device, and of passing them either to a sink, e.g. the
+        MQTTMessageQueue of the client, or to a callback.
+
+        With a sink, the topic and the payload are streamed to it as they are
+        received, including the pieces of long topics and payloads that the module
+        sends in several "+CMQTTRXTOPIC" and "+CMQTTRXPAYLOAD" segments.
+
+        Otherwise the handler is deferred: the topic and the payload are captured
+        with the lines announcing them, and the message is assembled once the
+        command in flight has completed, then passed to the callback. The maximum
+        length of the topic and payload are then defined by the variables
+        MQTT_TOPIC_BUFFER_LEN and MQTT_PAYLOAD_BUFFER_LEN, respectively: longer
+        ones are truncated.
 
         This event does not produces a A76XXURC_t URC code when A76XX::listen
         is called.
 */
 class MQTTOnMessageRx : public EventHandler_t {
   public:
-    CircularBuffer<MQTTMessage_t, MQTT_MESSAGE_QUEUE_SIZE>  messageQueue;
-    
     MQTTOnMessageRx(mqttEvtCb_t mqttEvtCb)
-        : EventHandler_t("+CMQTTRXSTART: "),
-          _mqttEvtCb(mqttEvtCb) {}
-    
-    void process(ModemSerial* serial);
+        : EventHandler_t("+CMQTTRX", true),
+          _mqttEvtCb(mqttEvtCb),
+          _topic_len(0),
+          _payload_len(0),
+          _sink(NULL),
+          _streaming(false),
+          _router(NULL),
+          _queue(NULL) {}
+
+    size_t bodyLength(URCFrame_t& frame);
+
+    bool streamsBody(URCFrame_t& frame) {
+        return _streaming;
+    }
+
+    void bodyChunk(const uint8_t* data, size_t len);
+
+    void processFrame(URCFrame_t& frame);
+
+    void setSink(MQTTMessageSink* sink);
+
+    bool hasCallback() {
+        return _mqttEvtCb != NULL;
+    }
+
+    /*
+        @brief Route the messages of a queue once received, see
+            A76XXMQTTClient::setRouter.
+    */
+    void setRouter(MQTTRouter* router, MQTTMessageQueue* queue) {
+        _router = router;
+        _queue = queue;
+    }
 
   private:
     mqttEvtCb_t _mqttEvtCb;
+
+    // the message being received
+    MQTTMessage_t     _msg;
+    size_t      _topic_len;
+    size_t    _payload_len;
+
+    // the message being streamed to the sink, as its lines are captured
+    MQTTMessageSink*         _sink;
+    bool                _streaming;
+    bool             _in_topic;
+    size_t         _topic_left;
+    size_t       _payload_left;
+
+    MQTTRouter*            _router;
+    MQTTMessageQueue*       _queue;
+
+    void streamLine(URCFrame_t& frame);
+};
+
+
+typedef void (*mqttPubCb_t) (uint16_t msg_id, int8_t retcode);
+
+/*
+    @brief Handler of the URC "+CMQTTPUB", the outcome of the messages published
+        with A76XXMQTTClient::publishPipelined.
+
+    @details The module reports outcomes in the order the messages were published,
+        without identifying them, so each outcome is matched with the oldest
+        message in flight. The handler is deferred: outcomes are reported once the
+        command in flight has completed, by calling the callback with the
+        identifier of the message and the error code of the module, 0 on success.
+
+        When publishing fails straight away, the module sends a line "+CMQTTPUB: "
+        before ERROR, which is not the outcome of a message in flight: the client
+        marks it with ::skipLast, counting lines as they are captured.
+
+        The outcome of messages from the outbox of the client settles them in the
+        outbox instead.
+*/
+class MQTTOnPublish : public EventHandler_t {
+  public:
+    MQTTOnPublish()
+        : EventHandler_t("+CMQTTPUB: ", true)
+        , _callback(NULL)
+        , _outbox(NULL)
+        , _head(0)
+        , _count(0)
+        , _next_id(0)
+        , _captured(0)
+        , _processed(0)
+        , _skip(0) {}
+
+    size_t bodyLength(URCFrame_t& frame) {
+        _captured++;
+        return 0;
+    }
+
+    void processFrame(URCFrame_t& frame);
+
+    void setCallback(mqttPubCb_t callback) {
+        _callback = callback;
+    }
+
+    void setOutbox(MQTTOutbox* outbox) {
+        _outbox = outbox;
+    }
+
+    /*
+        @brief Start afresh, with no message in flight.
+    */
+    void reset() {
+        _count = 0;
+        _captured = 0;
+        _processed = 0;
+        _skip = 0;
+    }
+
+    /*
+        @brief Add a message, returning its identifier.
+
+        @param [IN] outbox_seq The sequence number of the message in the outbox, or
+            NULL if it does not come from the outbox.
+    */
+    uint16_t push(uint8_t pub_timeout, const uint32_t* outbox_seq = NULL);
+
+    /*
+        @brief Report the outcome of the oldest message.
+    */
+    void complete(int8_t retcode);
+
+    /*
+        @brief Number of lines captured so far.
+    */
+    uint32_t captured() {
+        return _captured;
+    }
+
+    /*
+        @brief Ignore the last line captured.
+    */
+    void skipLast() {
+        _skip = _captured;
+    }
+
+    /*
+        @brief Number of messages in flight.
+    */
+    uint8_t count() {
+        return _count;
+    }
+
+    /*
+        @brief Whether the oldest message has gone unanswered for too long.
+    */
+    bool oldestExpired();
+
+  private:
+    struct InFlight {
+        uint16_t                  id;
+        uint32_t           expiry_ms;
+        bool             from_outbox;
+        uint32_t          outbox_seq;
+    };
+
+    mqttPubCb_t                                   _callback;
+    MQTTOutbox*                                     _outbox;
+    InFlight                 _in_flight[MQTT_PUBLISH_WINDOW];
+    uint8_t                                           _head;
+    uint8_t                                          _count;
+    uint16_t                                       _next_id;
+    uint32_t                                      _captured;
+    uint32_t                                     _processed;
+    uint32_t                                          _skip;
 };
 
 
@@ -48,6 +342,31 @@ class A76XXMQTTClient : public A76XXSecureClient {
     const char*                                       _clientID;
     bool                                               _use_ssl;
     MQTTOnMessageRx                      _on_message_rx_handler;
+    // where messages go without a callback or a sink of the application
+    uint8_t                   _rx_arena[MQTT_MESSAGE_QUEUE_BYTES];
+    MQTTMessageQueue                                  _rx_queue;
+    MQTTRouter*                                         _router;
+    MQTTOnPublish                           _on_publish_handler;
+    uint8_t                                     _publish_window;
+    MQTTOutbox*                                         _outbox;
+    // whether the connection was up when last seen, and when it was last checked
+    bool                                      _outbox_connected;
+    uint32_t                                   _outbox_check_ms;
+    bool                                             _draining;
+
+    // publish without waiting, for the outbox if outbox_seq is not NULL
+    bool pipeline(const char* topic,
+                  const uint8_t* payload,
+                  uint32_t length,
+                  uint8_t qos,
+                  uint8_t pub_timeout,
+                  bool retained,
+                  bool dup,
+                  uint16_t* msg_id,
+                  const uint32_t* outbox_seq);
+
+    // whether the outbox can be drained, checking the connection now and then
+    bool outboxConnected();
 
     // these two are set to zero by default until a use
     // case for allowing these to change comes up
@@ -131,6 +450,8 @@ class A76XXMQTTClient : public A76XXSecureClient {
             this timeout. The range is from 1 to 180 seconds.
         @param [IN] retained The retain flag of the publish message.
         @param [IN] dup The dup flag to the message.
+        @param [IN] deadline When the whole operation must be over, from setting the
+            topic to the acknowledgement of the message, which also bounds pub_timeout.
 
         @return True on success. If false, use getLastError() to get detail on the error
     */
@@ -140,7 +461,8 @@ class A76XXMQTTClient : public A76XXSecureClient {
                  uint8_t qos,
                  uint8_t pub_timeout,
                  bool retained = false,
-                 bool dup = false);
+                 bool dup = false,
+                 const Deadline& deadline = Deadline());
 
     /*
         @brief Publish a message.
@@ -152,6 +474,8 @@ class A76XXMQTTClient : public A76XXSecureClient {
             this timeout. The range is from 1 to 180 seconds.
         @param [IN] retained The retain flag of the publish message.
         @param [IN] dup The dup flag to the message.
+        @param [IN] deadline When the whole operation must be over, from setting the
+            topic to the acknowledgement of the message, which also bounds pub_timeout.
 
         @return True on success. If false, use getLastError() to get detail on the error
     */
@@ -160,7 +484,113 @@ class A76XXMQTTClient : public A76XXSecureClient {
                  uint8_t qos,
                  uint8_t pub_timeout,
                  bool retained = false,
-                 bool dup = false);
+                 bool dup = false,
+                 const Deadline& deadline = Deadline());
+
+    /*
+        @brief Publish messages without waiting for the outcome of the previous ones.
+
+        @detail Up to `window` messages, at most MQTT_PUBLISH_WINDOW, can await their
+            outcome, e.g. the acknowledgement of the broker, while the next ones are
+            sent, so that the rate of messages is bound by the bandwidth rather than
+            the round trip time. Outcomes are reported to the callback, in the order
+            the messages were published. With a window of 0, the default, messages
+            in flight are waited for and pipelining ends.
+        @param [IN] window The number of messages in flight.
+        @param [IN] callback Called with the identifier returned by ::publishPipelined
+            and the error code of the module, 0 on success, or
+            A76XX_OPERATION_TIMEDOUT if the module did not report an outcome. It is
+            called once the command in flight has completed, while URCs are
+            processed: it can issue commands, but not wait for other outcomes, so
+            ::publish fails there while messages are in flight, and so does
+            ::publishPipelined while the window is full.
+        @return False if the messages in flight were not all completed, or, within a
+            transaction or an event handler, if there are messages in flight.
+    */
+    bool setPublishWindow(uint8_t window, mqttPubCb_t callback = NULL);
+
+    /*
+        @brief Publish a message without waiting for its outcome, see ::setPublishWindow.
+
+        @detail Blocks while the window is full, or fails if the outcomes cannot be
+            processed meanwhile, see ::waitPublished. The parameters are those of ::publish.
+        @param [OUT] msg_id The identifier of the message, passed to the callback.
+        @return True if the module has taken the message. If false, use getLastError()
+            to get detail on the error.
+    */
+    bool publishPipelined(const char* topic,
+                          const uint8_t* payload,
+                          uint32_t length,
+                          uint8_t qos,
+                          uint8_t pub_timeout,
+                          bool retained = false,
+                          bool dup = false,
+                          uint16_t* msg_id = NULL);
+
+    bool publishPipelined(const char* topic,
+                          const char* payload,
+                          uint8_t qos,
+                          uint8_t pub_timeout,
+                          bool retained = false,
+                          bool dup = false,
+                          uint16_t* msg_id = NULL);
+
+    /*
+        @brief Block until at most `max_in_flight` pipelined messages await their outcome.
+
+        @detail Outcomes are processed at the end of the outermost transaction, so
+            within a transaction, including the callbacks of event handlers, this
+            fails straight away with A76XX_GENERIC_ERROR rather than waiting.
+        @param [IN] timeout Return after this time in milliseconds.
+        @return False on timeout, or if the outcomes cannot be waited for.
+    */
+    bool waitPublished(uint8_t max_in_flight = 0, uint32_t timeout = 60000);
+
+    /*
+        @brief Hold messages in an outbox until they can be published, see
+            ::publishQueued. NULL to stop.
+
+        @detail The outbox must outlive its use. It is drained, in batches of
+            MQTT_OUTBOX_BATCH messages, when a message is queued and after connecting.
+            Messages are pipelined if a publish window is set, see ::setPublishWindow,
+            and published one at a time otherwise.
+    */
+    void setOutbox(MQTTOutbox* outbox);
+
+    /*
+        @brief Queue a message in the outbox, then publish the messages queued so
+            far, in order, if the client is connected.
+
+        @detail Without an outbox, this is ::publish. Messages are published at least
+            once: after a reboot, those published but not yet removed from a
+            store are published again. The parameters are those of ::publish.
+        @return True if the message was queued, false if the outbox dropped it, see
+            OutboxPolicy_t.
+    */
+    bool publishQueued(const char* topic,
+                       const uint8_t* payload,
+                       uint32_t length,
+                       uint8_t qos,
+                       uint8_t pub_timeout,
+                       bool retained = false);
+
+    bool publishQueued(const char* topic,
+                       const char* payload,
+                       uint8_t qos,
+                       uint8_t pub_timeout,
+                       bool retained = false);
+
+    /*
+        @brief Publish messages of the outbox, if the client is connected.
+
+        @detail While the connection is down, it is checked at most every
+            MQTT_OUTBOX_RETRY_MS milliseconds. Call this regularly, e.g. in the main
+            loop, for messages to go out when coverage comes back.
+        @param [IN] max_messages The maximum number of messages to publish.
+        @return The number of messages published, or handed to the module when
+            pipelined.
+    */
+    uint32_t drainOutbox(uint32_t max_messages = MQTT_OUTBOX_BATCH);
 
     /*
         @brief Subscribe to a topic.
@@ -171,19 +601,80 @@ class A76XXMQTTClient : public A76XXSecureClient {
     */
     bool subscribe(const char* topic, uint8_t qos = 0);
 
+    /*
+        @brief Subscribe to a topic filter, and call a handler with the messages
+            matching it, see ::setRouter.
+
+        @param [IN] filter The topic filter, which can include wildcards.
+        @param [IN] qos The quality of service of the subscription.
+        @param [IN] handler The function called with each matching message.
+        @param [IN] context Passed to the handler as is, e.g. an object.
+        @return False if there is no router, the router is full, or the
+            subscription failed.
+    */
+    bool subscribe(const char* filter, uint8_t qos, mqttRouteCb_t handler, void* context = NULL);
+
+    /*
+        @brief Dispatch the messages received to handlers, by topic filter. NULL
+            to stop.
+
+        @detail Messages kept in the queue of the client are routed once the
+            command in flight has completed, or when calling A76XX::listen, like
+            the callback given to the constructor, or by ::dispatchMessages. The
+            handlers can issue commands. The router must outlive its use.
+    */
+    void setRouter(MQTTRouter* router);
+
+    /*
+        @brief Route the messages waiting in the queue of the client, if there is
+            a router.
+
+        @return The number of messages routed.
+    */
+    uint32_t dispatchMessages();
+
+    /*
+        @brief Stream incoming messages to a sink rather than to the callback given
+            to the constructor, or to the queue of the client if there is none. NULL
+            to go back to these.
+
+        @detail Messages are then not limited by MQTT_TOPIC_BUFFER_LEN and
+            MQTT_PAYLOAD_BUFFER_LEN, nor by the URC arena. The sink must outlive
+            its use.
+    */
+    void setMessageSink(MQTTMessageSink* sink);
+
     /*
         @brief Check if messages have been received.
 
+        @details Without a callback given to the constructor, messages are kept in a
+            MQTTMessageQueue of MQTT_MESSAGE_QUEUE_BYTES bytes, as they are received.
         @return The number of messages available.
     */
     uint32_t messageAvailable();
 
+    /*
+        @brief Look at the oldest message received, in place, without copying it.
+
+        @return False if there is none. Otherwise the message stays valid until
+            ::releaseMessage is called.
+    */
+    bool peekMessage(MQTTMessageView_t& msg);
+
+    /*
+        @brief Remove the oldest message received, once done with ::peekMessage.
+    */
+    void releaseMessage();
+
     /*
         @brief Get last message received.
 
         @details You should only call this function if the result of calling
             A76XXMQTTClient::messageAvailable is greater than zero. The result of 
             calling this function when no messages are available is undetermined.
+            The message is copied, and its topic and payload truncated to
+            MQTT_TOPIC_BUFFER_LEN and MQTT_PAYLOAD_BUFFER_LEN: see ::peekMessage
+            for long messages.
 
         @return A MQTTMessage_t object, with fields `topic` and `payload`.
     */
@@ -0,0 +1,266 @@
+#include "A76XX.h"
+#include <stddef.h>
+
+#define OUTBOX_FLAG_RETAINED   0x01
+#define OUTBOX_FLAG_PUBLISHING 0x02
+
+#if !defined(ARDUINO) || defined(ESP_PLATFORM)
+bool OutboxStoreFile::save(const uint8_t* data, size_t len) {
+    char tmp[128];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", _path) >= (int) sizeof(tmp)) {
+        return false;
+    }
+    FILE* file = fopen(tmp, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fwrite(data, 1, len, file) == len;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(tmp);
+        return false;
+    }
+    // rename does not replace an existing file everywhere, e.g. on SPIFFS
+    remove(_path);
+    return rename(tmp, _path) == 0;
+}
+
+size_t OutboxStoreFile::load(uint8_t* buf, size_t size) {
+    FILE* file = fopen(_path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t len = fread(buf, 1, size, file);
+    // the saved messages must fit entirely
+    if (len == size && fgetc(file) != EOF) {
+        len = 0;
+    }
+    fclose(file);
+    return len;
+}
+#endif
+
+#if !defined(ARDUINO) && defined(ESP_PLATFORM)
+bool OutboxStoreNVS::save(const uint8_t* data, size_t len) {
+    nvs_handle_t handle;
+    if (nvs_open(_namespace, NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    bool ok = nvs_set_blob(handle, _key, data, len) == ESP_OK && nvs_commit(handle) == ESP_OK;
+    nvs_close(handle);
+    return ok;
+}
+
+size_t OutboxStoreNVS::load(uint8_t* buf, size_t size) {
+    nvs_handle_t handle;
+    if (nvs_open(_namespace, NVS_READONLY, &handle) != ESP_OK) {
+        return 0;
+    }
+    size_t len = size;
+    if (nvs_get_blob(handle, _key, buf, &len) != ESP_OK) {
+        len = 0;
+    }
+    nvs_close(handle);
+    return len;
+}
+#endif
+
+MQTTOutbox::MQTTOutbox(uint8_t* buf, size_t size, OutboxPolicy_t policy, OutboxStore* store)
+    : _buf(buf)
+    , _size(size)
+    , _head(0)
+    , _fill(0)
+    , _policy(policy)
+    , _store(store)
+    , _next_seq(0) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool MQTTOutbox::restore() {
+    if (_store == NULL) {
+        return false;
+    }
+    size_t len = _store->load(_buf, _size);
+
+    // the saved messages must follow each other up to the end
+    size_t pos = 0;
+    uint32_t depth = 0;
+    uint32_t next_seq = 0;
+    while (pos + sizeof(RecordHeader) <= len) {
+        RecordHeader header;
+        memcpy(&header, _buf + pos, sizeof(header));
+        if (recordLength(header) > len - pos) {
+            break;
+        }
+        if (header.seq >= next_seq) {
+            next_seq = header.seq + 1;
+        }
+        pos += recordLength(header);
+        depth++;
+    }
+    _head = 0;
+    if (pos != len) {
+        _fill = 0;
+        _stats.depth = 0;
+        updateBytes();
+        return false;
+    }
+    _fill = len;
+    _next_seq = next_seq;
+    _stats.depth = depth;
+    // whatever was being published before the reboot is published again
+    requeue();
+    updateBytes();
+    return true;
+}
+
+bool MQTTOutbox::sync() {
+    if (_store == NULL) {
+        return true;
+    }
+    return _store->save(_buf + _head, _fill - _head);
+}
+
+bool MQTTOutbox::push(const char* topic, const uint8_t* payload, uint32_t length,
+                      uint8_t qos, uint8_t pub_timeout, bool retained) {
+    RecordHeader header;
+    header.seq = _next_seq;
+    header.payload_len = length;
+    header.topic_len = strlen(topic);
+    header.qos = qos;
+    header.pub_timeout = pub_timeout;
+    header.flags = retained ? OUTBOX_FLAG_RETAINED : 0;
+    size_t len = recordLength(header);
+
+    if (len > _size) {
+        _stats.dropped++;
+        return false;
+    }
+    while (_fill - _head + len > _size) {
+        if (_policy == OUTBOX_DROP_NEWEST || !dropOldest()) {
+            _stats.dropped++;
+            return false;
+        }
+    }
+    // compact, as the message does not fit at the end
+    if (_fill + len > _size) {
+        memmove(_buf, _buf + _head, _fill - _head);
+        _fill -= _head;
+        _head = 0;
+    }
+
+    memcpy(_buf + _fill, &header, sizeof(header));
+    memcpy(_buf + _fill + sizeof(header), topic, header.topic_len + 1);
+    memcpy(_buf + _fill + sizeof(header) + header.topic_len + 1, payload, length);
+    _fill += len;
+    _next_seq++;
+    _stats.depth++;
+    _stats.enqueued++;
+    updateBytes();
+    sync();
+    return true;
+}
+
+bool MQTTOutbox::next(OutboxRecord_t& rec) {
+    size_t pos = _head;
+    while (pos < _fill) {
+        RecordHeader header;
+        memcpy(&header, _buf + pos, sizeof(header));
+        if ((header.flags & OUTBOX_FLAG_PUBLISHING) == 0) {
+            rec.seq = header.seq;
+            rec.topic = (const char*) _buf + pos + sizeof(header);
+            rec.payload = _buf + pos + sizeof(header) + header.topic_len + 1;
+            rec.length = header.payload_len;
+            rec.qos = header.qos;
+            rec.pub_timeout = header.pub_timeout;
+            rec.retained = (header.flags & OUTBOX_FLAG_RETAINED) != 0;
+            return true;
+        }
+        pos += recordLength(header);
+    }
+    return false;
+}
+
+size_t MQTTOutbox::find(uint32_t seq) {
+    size_t pos = _head;
+    while (pos < _fill) {
+        RecordHeader header;
+        memcpy(&header, _buf + pos, sizeof(header));
+        if (header.seq == seq) {
+            return pos;
+        }
+        pos += recordLength(header);
+    }
+    return _fill;
+}
+
+void MQTTOutbox::publishing(uint32_t seq) {
+    size_t pos = find(seq);
+    if (pos < _fill) {
+        _buf[pos + offsetof(RecordHeader, flags)] |= OUTBOX_FLAG_PUBLISHING;
+    }
+}
+
+void MQTTOutbox::settle(uint32_t seq, bool success) {
+    size_t pos = find(seq);
+    if (pos == _fill) {
+        return;
+    }
+    if (success) {
+        // wherever it is, as the messages before it may have failed
+        remove(pos);
+        _stats.sent++;
+    } else {
+        _buf[pos + offsetof(RecordHeader, flags)] &= ~OUTBOX_FLAG_PUBLISHING;
+        _stats.failed++;
+    }
+}
+
+void MQTTOutbox::requeue() {
+    size_t pos = _head;
+    while (pos < _fill) {
+        RecordHeader header;
+        memcpy(&header, _buf + pos, sizeof(header));
+        _buf[pos + offsetof(RecordHeader, flags)] &= ~OUTBOX_FLAG_PUBLISHING;
+        pos += recordLength(header);
+    }
+}
+
+void MQTTOutbox::remove(size_t pos) {
+    RecordHeader header;
+    memcpy(&header, _buf + pos, sizeof(header));
+    size_t len = recordLength(header);
+    if (pos == _head) {
+        _head += len;
+    } else {
+        memmove(_buf + pos, _buf + pos + len, _fill - pos - len);
+        _fill -= len;
+    }
+    if (_head == _fill) {
+        _head = _fill = 0;
+    }
+    _stats.depth--;
+    updateBytes();
+}
+
+bool MQTTOutbox::dropOldest() {
+    size_t pos = _head;
+    while (pos < _fill) {
+        RecordHeader header;
+        memcpy(&header, _buf + pos, sizeof(header));
+        if ((header.flags & OUTBOX_FLAG_PUBLISHING) == 0) {
+            remove(pos);
+            _stats.dropped++;
+            return true;
+        }
+        pos += recordLength(header);
+    }
+    return false;
+}
+
+void MQTTOutbox::updateBytes() {
+    _stats.bytes = _fill - _head;
+    if (_stats.bytes > _stats.peak_bytes) {
+        _stats.peak_bytes = _stats.bytes;
+    }
+}
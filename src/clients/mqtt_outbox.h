@@ -0,0 +1,252 @@
+#ifndef A76XX_MQTT_OUTBOX_H_
+#define A76XX_MQTT_OUTBOX_H_
+
+#if !defined(ARDUINO) && defined(ESP_PLATFORM)
+    extern "C" {
+    #include "nvs.h"
+    }
+#endif
+
+/*
+    @brief What to drop when a message does not fit in a full outbox.
+*/
+enum OutboxPolicy_t {
+    OUTBOX_DROP_OLDEST = 0,
+    OUTBOX_DROP_NEWEST = 1
+};
+
+/*
+    @brief Counters of an outbox, see MQTTOutbox::stats.
+*/
+struct OutboxStats_t {
+    // messages and bytes held now, and the most bytes ever held
+    uint32_t                                  depth;
+    uint32_t                                  bytes;
+    uint32_t                             peak_bytes;
+    // messages queued, published, dropped for lack of room, and failed attempts
+    uint32_t                               enqueued;
+    uint32_t                                   sent;
+    uint32_t                                dropped;
+    uint32_t                                 failed;
+};
+
+/*
+    @brief A message held by an outbox. The pointers are valid until the next
+        message is queued or settled.
+*/
+struct OutboxRecord_t {
+    uint32_t                                    seq;
+    const char*                               topic;
+    const uint8_t*                          payload;
+    uint32_t                                 length;
+    uint8_t                                     qos;
+    uint8_t                             pub_timeout;
+    bool                                   retained;
+};
+
+/*
+    @brief Where the messages of an outbox are kept across reboots.
+
+    @details The outbox saves all its messages at once, as a single block of
+        bytes, after queuing a message and after each batch published.
+*/
+class OutboxStore {
+  public:
+    /*
+        @brief Replace the saved messages.
+
+        @return False if they could not be saved.
+    */
+    virtual bool save(const uint8_t* data, size_t len) = 0;
+
+    /*
+        @brief Copy the saved messages.
+
+        @return The number of bytes copied, 0 if there are none or they do not fit.
+    */
+    virtual size_t load(uint8_t* buf, size_t size) = 0;
+
+    virtual ~OutboxStore() {}
+};
+
+#if !defined(ARDUINO) || defined(ESP_PLATFORM)
+/*
+    @brief Keep the messages of an outbox in a file, e.g. on Linux, or on a SPIFFS
+        or LittleFS partition on the ESP32.
+
+    @details The file is written next to its final path and renamed over it, so
+        that a reset while saving leaves the previous messages.
+*/
+class OutboxStoreFile : public OutboxStore {
+  public:
+    /*
+        @param [IN] path The path of the file, which must outlive the object.
+    */
+    OutboxStoreFile(const char* path)
+        : _path(path) {}
+
+    bool save(const uint8_t* data, size_t len);
+    size_t load(uint8_t* buf, size_t size);
+
+  private:
+    const char* _path;
+};
+#endif
+
+#if !defined(ARDUINO) && defined(ESP_PLATFORM)
+/*
+    @brief Keep the messages of an outbox in a blob of the NVS flash storage.
+
+    @details NVS must have been initialised, e.g. with nvs_flash_init. Blobs are
+        limited by the size of the NVS partition, so keep the outbox small.
+*/
+class OutboxStoreNVS : public OutboxStore {
+  public:
+    /*
+        @param [IN] name_space The NVS namespace, which must outlive the object.
+        @param [IN] key The key of the blob, which must outlive the object.
+    */
+    OutboxStoreNVS(const char* name_space = "a76xx", const char* key = "outbox")
+        : _namespace(name_space)
+        , _key(key) {}
+
+    bool save(const uint8_t* data, size_t len);
+    size_t load(uint8_t* buf, size_t size);
+
+  private:
+    const char* _namespace;
+    const char* _key;
+};
+#endif
+
+/*
+    @brief A bounded queue of MQTT messages waiting to be published, e.g. while the
+        network is out of reach, see A76XXMQTTClient::setOutbox.
+
+    @details Messages are kept back to back in a buffer given by the application,
+        each with its topic and payload, so that short messages take little room.
+        Published messages are removed at once, wherever they are, and the buffer
+        is compacted when a message does not fit at the end. When it is full, either the oldest
+        messages are dropped to make room, or the new one is, depending on the
+        policy. Messages awaiting the outcome of their publication are never
+        dropped.
+
+        With a store, the messages are saved when one is queued and after each
+        batch published, and can be restored after a reboot with ::restore.
+
+        The outbox does not lock: the client only uses it while holding the serial
+        channel.
+
+        Example:
+
+            static uint8_t buf[4096];
+            OutboxStoreFile store("/var/lib/app/outbox");
+            MQTTOutbox outbox(buf, sizeof(buf), OUTBOX_DROP_OLDEST, &store);
+            outbox.restore();
+            mqtt.setOutbox(&outbox);
+            ...
+            mqtt.publishQueued("sensors/1", "21.5", 1, 60);
+*/
+class MQTTOutbox {
+  public:
+    /*
+        @param [IN] buf The storage of the messages, which must outlive the object.
+        @param [IN] size The size of the storage.
+        @param [IN] policy What to drop when the outbox is full.
+        @param [IN] store Where to save the messages, NULL to keep them in RAM only.
+    */
+    MQTTOutbox(uint8_t* buf, size_t size, OutboxPolicy_t policy = OUTBOX_DROP_OLDEST,
+               OutboxStore* store = NULL);
+
+    /*
+        @brief Replace the messages with those saved in the store.
+
+        @return False if there is no store or the saved messages are not valid.
+    */
+    bool restore();
+
+    /*
+        @brief Save the messages in the store, if any.
+    */
+    bool sync();
+
+    /*
+        @brief Queue a message.
+
+        @return False if it was dropped, because of the policy or because it does
+            not fit in the outbox at all.
+    */
+    bool push(const char* topic, const uint8_t* payload, uint32_t length,
+              uint8_t qos, uint8_t pub_timeout, bool retained);
+
+    /*
+        @brief The oldest message that is not being published.
+
+        @return False if there is none.
+    */
+    bool next(OutboxRecord_t& rec);
+
+    /*
+        @brief Mark a message as being published.
+    */
+    void publishing(uint32_t seq);
+
+    /*
+        @brief Settle the publication of a message: remove it on success, otherwise
+            queue it again for a later attempt.
+    */
+    void settle(uint32_t seq, bool success);
+
+    /*
+        @brief Queue again the messages being published, e.g. after a reboot.
+    */
+    void requeue();
+
+    /*
+        @brief Number of messages held.
+    */
+    uint32_t depth() {
+        return _stats.depth;
+    }
+
+    /*
+        @brief The counters of the outbox.
+    */
+    const OutboxStats_t& stats() {
+        return _stats;
+    }
+
+  private:
+    // stored in the buffer before the topic, null terminated, and the payload
+    struct RecordHeader {
+        uint32_t             seq;
+        uint32_t     payload_len;
+        uint16_t       topic_len;
+        uint8_t              qos;
+        uint8_t      pub_timeout;
+        uint8_t            flags;
+    };
+
+    uint8_t*                                     _buf;
+    size_t                                      _size;
+    size_t                                      _head;
+    size_t                                      _fill;
+    OutboxPolicy_t                            _policy;
+    OutboxStore*                               _store;
+    uint32_t                                _next_seq;
+    OutboxStats_t                              _stats;
+
+    static size_t recordLength(const RecordHeader& header) {
+        return sizeof(RecordHeader) + header.topic_len + 1 + header.payload_len;
+    }
+
+    // the offset of a message, _fill if it is not held
+    size_t find(uint32_t seq);
+    // drop the oldest message that is not being published
+    bool dropOldest();
+    // remove the message at an offset
+    void remove(size_t pos);
+    void updateBytes();
+};
+
+#endif /* A76XX_MQTT_OUTBOX_H_ */
@@ -0,0 +1,233 @@
+#include "A76XX.h"
+
+#define ROUTER_FNV_OFFSET 2166136261UL
+#define ROUTER_FNV_PRIME  16777619UL
+
+MQTTRouter::MQTTRouter()
+    : _node_count(0)
+    , _free_route(0)
+    , _names_fill(0)
+    , _unmatched(0) {
+    for (uint16_t i = 0; i < TABLE_SIZE; i++) {
+        _table[i] = NONE;
+    }
+    for (uint16_t i = 0; i < MQTT_ROUTER_MAX_ROUTES; i++) {
+        _routes[i].next = i + 1 < MQTT_ROUTER_MAX_ROUTES ? i + 1 : NONE;
+    }
+    // the root, before the first level
+    newNode(NONE);
+}
+
+uint32_t MQTTRouter::hashName(const char* name, size_t len) {
+    uint32_t hash = ROUTER_FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t) name[i]) * ROUTER_FNV_PRIME;
+    }
+    return hash;
+}
+
+uint16_t MQTTRouter::newNode(uint16_t parent) {
+    if (_node_count == MQTT_ROUTER_MAX_NODES) {
+        return NONE;
+    }
+    Node& node = _nodes[_node_count];
+    node.parent = parent;
+    node.name = 0;
+    node.name_len = 0;
+    node.plus = NONE;
+    node.hash = NONE;
+    node.routes = NONE;
+    return _node_count++;
+}
+
+uint16_t MQTTRouter::child(uint16_t parent, const char* name, size_t len, uint32_t name_hash) {
+    uint16_t i = slot(parent, name_hash);
+    while (_table[i] != NONE) {
+        Node& node = _nodes[_table[i]];
+        if (node.parent == parent && node.name_len == len && memcmp(_names + node.name, name, len) == 0) {
+            return _table[i];
+        }
+        i = (i + 1) % TABLE_SIZE;
+    }
+    return NONE;
+}
+
+uint16_t MQTTRouter::addChild(uint16_t parent, const char* name, size_t len) {
+    if (len > sizeof(_names) - _names_fill) {
+        return NONE;
+    }
+    uint16_t index = newNode(parent);
+    if (index == NONE) {
+        return NONE;
+    }
+    Node& node = _nodes[index];
+    memcpy(_names + _names_fill, name, len);
+    node.name = _names_fill;
+    node.name_len = len;
+    _names_fill += len;
+
+    // there are twice as many slots as nodes, so there is always a free one
+    uint16_t i = slot(parent, hashName(name, len));
+    while (_table[i] != NONE) {
+        i = (i + 1) % TABLE_SIZE;
+    }
+    _table[i] = index;
+    return index;
+}
+
+uint16_t MQTTRouter::find(const char* filter, bool create) {
+    if (filter == NULL || *filter == '\0') {
+        return NONE;
+    }
+    uint16_t index = 0;
+    const char* level = filter;
+    while (true) {
+        const char* end = strchr(level, '/');
+        size_t len = end != NULL ? end - level : strlen(level);
+        uint16_t next;
+        if (len == 1 && (level[0] == '#' || level[0] == '+')) {
+            // "#" must be the last level
+            if (level[0] == '#' && end != NULL) {
+                return NONE;
+            }
+            uint16_t& wildcard = level[0] == '#' ? _nodes[index].hash : _nodes[index].plus;
+            if (wildcard == NONE && create) {
+                wildcard = newNode(index);
+            }
+            next = wildcard;
+        } else {
+            // wildcards take a whole level
+            if (memchr(level, '+', len) != NULL || memchr(level, '#', len) != NULL) {
+                return NONE;
+            }
+            next = child(index, level, len, hashName(level, len));
+            if (next == NONE && create) {
+                next = addChild(index, level, len);
+            }
+        }
+        if (next == NONE || end == NULL) {
+            return next;
+        }
+        index = next;
+        level = end + 1;
+    }
+}
+
+bool MQTTRouter::add(const char* filter, mqttRouteCb_t handler, void* context) {
+    if (handler == NULL || _free_route == NONE) {
+        return false;
+    }
+    uint16_t index = find(filter, true);
+    if (index == NONE) {
+        return false;
+    }
+    uint16_t r = _free_route;
+    _free_route = _routes[r].next;
+    _routes[r].handler = handler;
+    _routes[r].context = context;
+    _routes[r].next = NONE;
+
+    // handlers are called in the order they were added
+    uint16_t* link = &_nodes[index].routes;
+    while (*link != NONE) {
+        link = &_routes[*link].next;
+    }
+    *link = r;
+    return true;
+}
+
+bool MQTTRouter::remove(const char* filter, mqttRouteCb_t handler, void* context) {
+    uint16_t index = find(filter, false);
+    if (index == NONE) {
+        return false;
+    }
+    uint16_t* link = &_nodes[index].routes;
+    while (*link != NONE) {
+        uint16_t r = *link;
+        if (_routes[r].handler == handler && _routes[r].context == context) {
+            *link = _routes[r].next;
+            _routes[r].next = _free_route;
+            _free_route = r;
+            return true;
+        }
+        link = &_routes[r].next;
+    }
+    return false;
+}
+
+uint32_t MQTTRouter::call(uint16_t index, const MQTTMessageView_t& msg) {
+    uint32_t calls = 0;
+    uint16_t r = _nodes[index].routes;
+    while (r != NONE) {
+        // the handler may remove itself
+        uint16_t next = _routes[r].next;
+        _routes[r].handler(&msg, _routes[r].context);
+        calls++;
+        r = next;
+    }
+    return calls;
+}
+
+uint32_t MQTTRouter::route(const MQTTMessageView_t& msg) {
+    // the nodes matching the levels so far, at most one per node of the trie
+    uint16_t active[MQTT_ROUTER_MAX_NODES];
+    uint16_t next[MQTT_ROUTER_MAX_NODES];
+    size_t num_active = 1;
+    active[0] = 0;
+
+    // no wildcard matches "$SYS" and the like in the first level
+    bool system = msg.topic_len > 0 && msg.topic[0] == '$';
+    uint32_t calls = 0;
+    size_t start = 0;
+    uint32_t hash = ROUTER_FNV_OFFSET;
+    for (size_t i = 0; i <= msg.topic_len && num_active > 0; i++) {
+        if (i < msg.topic_len && msg.topic[i] != '/') {
+            hash = (hash ^ (uint8_t) msg.topic[i]) * ROUTER_FNV_PRIME;
+            continue;
+        }
+
+        size_t num_next = 0;
+        for (size_t a = 0; a < num_active; a++) {
+            Node& node = _nodes[active[a]];
+            bool wildcards = !(system && active[a] == 0);
+            // "#" matches this level and the following ones
+            if (wildcards && node.hash != NONE) {
+                calls += call(node.hash, msg);
+            }
+            uint16_t c = child(active[a], msg.topic + start, i - start, hash);
+            if (c != NONE) {
+                next[num_next++] = c;
+            }
+            if (wildcards && node.plus != NONE) {
+                next[num_next++] = node.plus;
+            }
+        }
+        memcpy(active, next, num_next * sizeof(next[0]));
+        num_active = num_next;
+        start = i + 1;
+        hash = ROUTER_FNV_OFFSET;
+    }
+
+    // the filters ending with the topic, and those followed by "#", matching no level
+    for (size_t a = 0; a < num_active; a++) {
+        calls += call(active[a], msg);
+        if (_nodes[active[a]].hash != NONE) {
+            calls += call(_nodes[active[a]].hash, msg);
+        }
+    }
+    if (calls == 0) {
+        _unmatched++;
+    }
+    return calls;
+}
+
+uint32_t MQTTRouter::dispatch(MQTTMessageQueue& queue) {
+    uint32_t count = 0;
+    MQTTMessageView_t msg;
+    while (queue.peek(msg)) {
+        route(msg);
+        queue.release();
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,129 @@
+#ifndef A76XX_MQTT_ROUTER_H_
+#define A76XX_MQTT_ROUTER_H_
+
+// forward declarations
+struct MQTTMessageView_t;
+class MQTTMessageQueue;
+
+typedef void (*mqttRouteCb_t) (const MQTTMessageView_t* msg, void* context);
+
+/*
+    @brief Dispatch received MQTT messages to handlers, by topic filter, see
+        A76XXMQTTClient::setRouter.
+
+    @details Filters are compiled into a trie of topic levels, with the wildcards
+        "+", one level, and "#", any number of levels including none, as per MQTT.
+        Topics starting with '$' are not matched by a wildcard in the first level.
+
+        A topic is routed in a single pass over its characters: the nodes reached
+        so far are advanced at the end of each level, the child of a node named by
+        the level being found in a hash table, so that the cost depends on the
+        depth of the topic and on the wildcards that match it, not on the number of
+        filters. Several filters can match a message, and several handlers can be
+        added with the same filter: they are all called.
+
+        Nodes, handlers and the names of the levels are kept in fixed pools, of
+        MQTT_ROUTER_MAX_NODES, MQTT_ROUTER_MAX_ROUTES and MQTT_ROUTER_NAME_BYTES
+        entries. Removing a handler frees its entry, but not the nodes of its
+        filter, which are used again if the filter is added back.
+
+        Example:
+
+            void onCommand(const MQTTMessageView_t* msg, void* context) {
+                Device* device = (Device*) context;
+                ...
+            }
+
+            MQTTRouter router;
+            mqtt.setRouter(&router);
+            mqtt.subscribe("devices/42/cmd/+", 1, onCommand, &device);
+*/
+class MQTTRouter {
+  public:
+    MQTTRouter();
+
+    /*
+        @brief Call a handler for the messages whose topic matches a filter.
+
+        @param [IN] filter The topic filter, e.g. "sensors/+/temperature" or "config/#".
+        @param [IN] handler The function called with each matching message.
+        @param [IN] context Passed to the handler as is.
+        @return False if the filter is not valid or a pool is full.
+    */
+    bool add(const char* filter, mqttRouteCb_t handler, void* context = NULL);
+
+    /*
+        @brief Stop calling a handler added with the same filter and context.
+
+        @return False if there is no such handler.
+    */
+    bool remove(const char* filter, mqttRouteCb_t handler, void* context = NULL);
+
+    /*
+        @brief Call the handlers whose filter matches the topic of a message.
+
+        @return The number of handlers called.
+    */
+    uint32_t route(const MQTTMessageView_t& msg);
+
+    /*
+        @brief Route, then release, the messages of a queue.
+
+        @return The number of messages routed.
+    */
+    uint32_t dispatch(MQTTMessageQueue& queue);
+
+    /*
+        @brief Number of messages routed to no handler.
+    */
+    uint32_t unmatched() {
+        return _unmatched;
+    }
+
+  private:
+    static const uint16_t NONE = 0xFFFF;
+    static const uint16_t TABLE_SIZE = 2 * MQTT_ROUTER_MAX_NODES;
+
+    // a level of one or more filters; the children named by a level are found
+    // in the hash table, the wildcards are linked from their parent
+    struct Node {
+        uint16_t           parent;
+        uint16_t             name;
+        uint16_t         name_len;
+        uint16_t             plus;
+        uint16_t             hash;
+        uint16_t           routes;
+    };
+
+    struct Route {
+        mqttRouteCb_t     handler;
+        void*             context;
+        uint16_t             next;
+    };
+
+    Node                    _nodes[MQTT_ROUTER_MAX_NODES];
+    uint16_t                                   _node_count;
+    Route                  _routes[MQTT_ROUTER_MAX_ROUTES];
+    uint16_t                                   _free_route;
+    // open addressing, on the parent and the name of the level
+    uint16_t                             _table[TABLE_SIZE];
+    char                     _names[MQTT_ROUTER_NAME_BYTES];
+    uint16_t                                   _names_fill;
+    uint32_t                                    _unmatched;
+
+    static uint32_t hashName(const char* name, size_t len);
+
+    static uint16_t slot(uint16_t parent, uint32_t name_hash) {
+        return (name_hash ^ (parent * 0x9E3779B1UL)) % TABLE_SIZE;
+    }
+
+    // the child of a node named by a level, or NONE
+    uint16_t child(uint16_t parent, const char* name, size_t len, uint32_t name_hash);
+    uint16_t addChild(uint16_t parent, const char* name, size_t len);
+    uint16_t newNode(uint16_t parent);
+    // the node of the last level of a filter, or NONE if invalid or missing
+    uint16_t find(const char* filter, bool create);
+    uint32_t call(uint16_t node, const MQTTMessageView_t& msg);
+};
+
+#endif /* A76XX_MQTT_ROUTER_H_ */
@@ -1,6 +1,6 @@
 #include "A76XX.h"
 
-void SMSOnMessageRx::process(ModemSerial* serial) {
+void SMSOnMessageRx::processFrame(URCFrame_t& frame) {
     // In this event-driven method, we don't want to further process the
     // message, because Control might be busy with some other stuff.
     // We only provide the message index to the callback function and
@@ -11,9 +11,9 @@ void SMSOnMessageRx::process(ModemSerial* serial) {
     // We don't need to evaluate <mem3> (it should always be "SM"),
     // so we can discard it
 
-    serial->find(',');
-    uint8_t smsIdx = serial->parseInt();
-    serial->find('\n');
+    LineTokenizer fields = frame.fields();
+    fields.skip();
+    uint8_t smsIdx = fields.next().toInt();
 
     if(_smsEvtCb) _smsEvtCb(smsIdx);
 
@@ -32,9 +32,9 @@ typedef void (*smsEvtCb_t) (uint8_t smsIndex);
 class SMSOnMessageRx : public EventHandler_t {
   public:
     SMSOnMessageRx(smsEvtCb_t smsEvtCb) :
-      EventHandler_t("+CMTI: "), _smsEvtCb(smsEvtCb) {}
+      EventHandler_t("+CMTI: ", true), _smsEvtCb(smsEvtCb) {}
 
-    void process(ModemSerial* serial);
+    void processFrame(URCFrame_t& frame);
 
   private:
     smsEvtCb_t _smsEvtCb;
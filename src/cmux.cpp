@@ -0,0 +1,633 @@
+#include "A76XX.h"
+
+// framing of the basic option
+#define CMUX_FLAG           0xF9
+#define CMUX_EA             0x01
+#define CMUX_CR             0x02
+#define CMUX_PF             0x10
+
+// frame types, in the control field
+#define CMUX_SABM           0x2F
+#define CMUX_UA             0x63
+#define CMUX_DM             0x0F
+#define CMUX_DISC           0x43
+#define CMUX_UIH            0xEF
+#define CMUX_UI             0x03
+
+// messages of the control channel, with the EA bit and without the C/R bit
+#define CMUX_MSG_CLD        0xC1
+#define CMUX_MSG_TEST       0x21
+#define CMUX_MSG_FCON       0xA1
+#define CMUX_MSG_FCOFF      0x61
+#define CMUX_MSG_MSC        0xE1
+#define CMUX_MSG_NSC        0x11
+
+// V.24 signals of the modem status command: RTC, RTR and DV, and flow control
+#define CMUX_V24_SIGNALS    0x8D
+#define CMUX_V24_FC         0x02
+
+// the remainder of a valid frame, FCS included
+#define CMUX_FCS_GOOD       0xCF
+
+enum {
+    CMUX_RX_FLAG,
+    CMUX_RX_ADDRESS,
+    CMUX_RX_CONTROL,
+    CMUX_RX_LENGTH,
+    CMUX_RX_LENGTH2,
+    CMUX_RX_DATA,
+    CMUX_RX_FCS,
+    CMUX_RX_END
+};
+
+// CRC-8 of 27.010, reflected polynomial x^8 + x^2 + x + 1
+static uint8_t fcsByte(uint8_t fcs, uint8_t c) {
+    fcs ^= c;
+    for (uint8_t i = 0; i < 8; i++) {
+        fcs = (fcs & 1) ? (fcs >> 1) ^ 0xE0 : fcs >> 1;
+    }
+    return fcs;
+}
+
+CMUX::CMUX(ModemSerial& serial, bool initiator, uint16_t frame_size)
+    : _serial(serial)
+    , _initiator(initiator)
+    , _frame_size(frame_size > 0 && frame_size < A76XX_CMUX_FRAME_SIZE ? frame_size : A76XX_CMUX_FRAME_SIZE)
+    , _ctrl_state(CMUX_LINK_CLOSED)
+    , _peer_fc_all(false)
+    , _frame_errors(0)
+    , _rx_state(CMUX_RX_FLAG) {
+    for (uint8_t i = 0; i < A76XX_CMUX_CHANNELS; i++) {
+        _channels[i]._mux = this;
+        _channels[i]._dlci = i + 1;
+    }
+}
+
+int8_t CMUX::begin(uint32_t timeout) {
+    _ctrl_state = CMUX_LINK_OPENING;
+    if (!sendFrame(0, CMUX_SABM | CMUX_PF, true, NULL, 0)) {
+        _ctrl_state = CMUX_LINK_CLOSED;
+        return A76XX_GENERIC_ERROR;
+    }
+    return waitLink(0, CMUX_LINK_OPENING, timeout);
+}
+
+int8_t CMUX::end(uint32_t timeout) {
+    TimeoutCalc tc(timeout);
+    int8_t retcode = A76XX_OPERATION_SUCCEEDED;
+    for (uint8_t dlci = 1; dlci <= A76XX_CMUX_CHANNELS; dlci++) {
+        if (linkState(dlci) != CMUX_LINK_CLOSED) {
+            if (closeChannel(dlci, tc.remaining()) != A76XX_OPERATION_SUCCEEDED) {
+                retcode = A76XX_OPERATION_TIMEDOUT;
+            }
+        }
+    }
+    if (_ctrl_state != CMUX_LINK_CLOSED) {
+        // the close down command is answered before the module leaves the multiplexer
+        _ctrl_state = CMUX_LINK_CLOSING;
+        sendControl(CMUX_MSG_CLD | CMUX_CR, NULL, 0);
+        if (waitLink(0, CMUX_LINK_CLOSING, tc.remaining()) != A76XX_OPERATION_SUCCEEDED) {
+            retcode = A76XX_OPERATION_TIMEDOUT;
+        }
+    }
+    closeAll();
+    return retcode;
+}
+
+int8_t CMUX::openChannel(uint8_t dlci, uint32_t timeout) {
+    if (dlci < 1 || dlci > A76XX_CMUX_CHANNELS || _ctrl_state != CMUX_LINK_OPEN) {
+        return A76XX_GENERIC_ERROR;
+    }
+    if (linkState(dlci) == CMUX_LINK_OPEN) {
+        return A76XX_OPERATION_SUCCEEDED;
+    }
+    CMUXChannel& ch = _channels[dlci - 1];
+    ch._peer_fc = false;
+    ch._local_fc = false;
+    ch._state = CMUX_LINK_OPENING;
+    if (!sendFrame(dlci, CMUX_SABM | CMUX_PF, true, NULL, 0)) {
+        ch._state = CMUX_LINK_CLOSED;
+        return A76XX_GENERIC_ERROR;
+    }
+    int8_t retcode = waitLink(dlci, CMUX_LINK_OPENING, timeout);
+    A76XX_RETCODE_ASSERT_RETURN(retcode)
+
+    // tell the module that we are ready to exchange data
+    sendMSC(dlci, false, true);
+    return A76XX_OPERATION_SUCCEEDED;
+}
+
+int8_t CMUX::closeChannel(uint8_t dlci, uint32_t timeout) {
+    if (dlci < 1 || dlci > A76XX_CMUX_CHANNELS) {
+        return A76XX_GENERIC_ERROR;
+    }
+    if (linkState(dlci) == CMUX_LINK_CLOSED) {
+        return A76XX_OPERATION_SUCCEEDED;
+    }
+    linkState(dlci) = CMUX_LINK_CLOSING;
+    sendFrame(dlci, CMUX_DISC | CMUX_PF, true, NULL, 0);
+    return waitLink(dlci, CMUX_LINK_CLOSING, timeout);
+}
+
+CMUXChannel* CMUX::channel(uint8_t dlci) {
+    if (dlci < 1 || dlci > A76XX_CMUX_CHANNELS) {
+        return NULL;
+    }
+    return &_channels[dlci - 1];
+}
+
+bool CMUX::pump(uint32_t wait) {
+    TimeoutCalc tc(wait);
+    while (1) {
+        _rx_lock.acquire();
+        bool frame = false;
+        int c;
+        while (!frame && (c = _serial.read()) >= 0) {
+            frame = feed(c);
+        }
+        if (!frame && !tc.expired()) {
+            // wait in slices, letting other tasks read in our place
+            uint32_t slice = tc.remaining();
+            _serial.waitAvailable(slice < A76XX_CMUX_POLL_MS ? slice : A76XX_CMUX_POLL_MS);
+        }
+        _rx_lock.release();
+        if (frame) {
+            return true;
+        }
+        if (tc.expired()) {
+            return false;
+        }
+    }
+}
+
+bool CMUX::feed(uint8_t c) {
+    switch (_rx_state) {
+        case CMUX_RX_FLAG:
+            if (c == CMUX_FLAG) {
+                _rx_state = CMUX_RX_ADDRESS;
+            }
+            return false;
+
+        case CMUX_RX_ADDRESS:
+            // the closing flag of a frame can be followed by the opening flag of the next
+            if (c == CMUX_FLAG) {
+                return false;
+            }
+            if (!(c & CMUX_EA)) {
+                break;
+            }
+            _rx_addr = c;
+            _rx_fcs = fcsByte(0xFF, c);
+            _rx_state = CMUX_RX_CONTROL;
+            return false;
+
+        case CMUX_RX_CONTROL:
+            _rx_ctrl = c;
+            _rx_fcs = fcsByte(_rx_fcs, c);
+            _rx_state = CMUX_RX_LENGTH;
+            return false;
+
+        case CMUX_RX_LENGTH:
+        case CMUX_RX_LENGTH2:
+            _rx_fcs = fcsByte(_rx_fcs, c);
+            if (_rx_state == CMUX_RX_LENGTH) {
+                _rx_len = c >> 1;
+                if (!(c & CMUX_EA)) {
+                    _rx_state = CMUX_RX_LENGTH2;
+                    return false;
+                }
+            } else {
+                _rx_len |= (uint16_t) c << 7;
+            }
+            if (_rx_len > A76XX_CMUX_FRAME_SIZE) {
+                break;
+            }
+            _rx_pos = 0;
+            _rx_state = _rx_len > 0 ? CMUX_RX_DATA : CMUX_RX_FCS;
+            return false;
+
+        case CMUX_RX_DATA:
+            _rx_data[_rx_pos++] = c;
+            // the FCS of UIH frames only covers the header
+            if ((_rx_ctrl & ~CMUX_PF) != CMUX_UIH) {
+                _rx_fcs = fcsByte(_rx_fcs, c);
+            }
+            if (_rx_pos == _rx_len) {
+                _rx_state = CMUX_RX_FCS;
+            }
+            return false;
+
+        case CMUX_RX_FCS:
+            if (fcsByte(_rx_fcs, c) != CMUX_FCS_GOOD) {
+                break;
+            }
+            _rx_state = CMUX_RX_END;
+            return false;
+
+        case CMUX_RX_END:
+            if (c != CMUX_FLAG) {
+                break;
+            }
+            _rx_state = CMUX_RX_ADDRESS;
+            dispatch();
+            return true;
+    }
+
+    // drop the frame and look for the next flag
+    _frame_errors++;
+    _rx_state = c == CMUX_FLAG ? CMUX_RX_ADDRESS : CMUX_RX_FLAG;
+    return false;
+}
+
+void CMUX::dispatch() {
+    uint8_t dlci = _rx_addr >> 2;
+    uint8_t ctrl = _rx_ctrl & ~CMUX_PF;
+
+    if (dlci > A76XX_CMUX_CHANNELS) {
+        if (ctrl == CMUX_SABM || ctrl == CMUX_DISC) {
+            sendFrame(dlci, CMUX_DM | CMUX_PF, false, NULL, 0);
+        }
+        return;
+    }
+
+    volatile uint8_t& state = linkState(dlci);
+    switch (ctrl) {
+        case CMUX_SABM:
+            // channels are only opened once the control channel is
+            if (dlci > 0 && _ctrl_state != CMUX_LINK_OPEN) {
+                sendFrame(dlci, CMUX_DM | CMUX_PF, false, NULL, 0);
+                break;
+            }
+            if (dlci > 0) {
+                _channels[dlci - 1]._peer_fc = false;
+                _channels[dlci - 1]._local_fc = false;
+            }
+            state = CMUX_LINK_OPEN;
+            sendFrame(dlci, CMUX_UA | CMUX_PF, false, NULL, 0);
+            break;
+
+        case CMUX_DISC:
+            sendFrame(dlci, (state == CMUX_LINK_CLOSED ? CMUX_DM : CMUX_UA) | CMUX_PF, false, NULL, 0);
+            if (dlci == 0) {
+                closeAll();
+            } else {
+                state = CMUX_LINK_CLOSED;
+            }
+            break;
+
+        case CMUX_UA:
+            if (state == CMUX_LINK_OPENING) {
+                state = CMUX_LINK_OPEN;
+            } else if (state == CMUX_LINK_CLOSING) {
+                state = CMUX_LINK_CLOSED;
+            }
+            break;
+
+        case CMUX_DM:
+            if (dlci == 0) {
+                closeAll();
+            } else {
+                state = CMUX_LINK_CLOSED;
+            }
+            break;
+
+        case CMUX_UIH:
+        case CMUX_UI:
+            if (dlci == 0) {
+                control(_rx_data, _rx_len);
+            } else if (state == CMUX_LINK_OPEN) {
+                CMUXChannel& ch = _channels[dlci - 1];
+                ch._rx.write(_rx_data, _rx_len);
+                if (!ch._local_fc && ch._rx.getUsed() > highWater()) {
+                    ch._local_fc = true;
+                    sendMSC(dlci, true, true);
+                }
+            }
+            break;
+    }
+}
+
+void CMUX::control(const uint8_t* data, size_t len) {
+    size_t pos = 0;
+    while (pos + 2 <= len) {
+        uint8_t type = data[pos++];
+        size_t values_len = data[pos] >> 1;
+        if (!(data[pos++] & CMUX_EA)) {
+            if (pos >= len) {
+                return;
+            }
+            values_len |= (size_t) data[pos++] << 7;
+        }
+        if (pos + values_len > len) {
+            return;
+        }
+        const uint8_t* values = data + pos;
+        pos += values_len;
+
+        bool command = type & CMUX_CR;
+        switch (type & ~CMUX_CR) {
+            case CMUX_MSG_MSC:
+                // a response only echoes the signals we sent
+                if (command && values_len >= 2) {
+                    uint8_t dlci = values[0] >> 2;
+                    if (dlci >= 1 && dlci <= A76XX_CMUX_CHANNELS) {
+                        _channels[dlci - 1]._peer_fc = values[1] & CMUX_V24_FC;
+                    }
+                }
+                break;
+
+            case CMUX_MSG_FCON:
+            case CMUX_MSG_FCOFF:
+                if (command) {
+                    _peer_fc_all = (type & ~CMUX_CR) == CMUX_MSG_FCOFF;
+                }
+                break;
+
+            case CMUX_MSG_CLD:
+                if (!command && _ctrl_state == CMUX_LINK_CLOSING) {
+                    closeAll();
+                }
+                break;
+
+            case CMUX_MSG_TEST:
+            case CMUX_MSG_NSC:
+                break;
+
+            default:
+                // not supported, answered with the type of the command
+                if (command) {
+                    sendControl(CMUX_MSG_NSC, &type, 1);
+                }
+                continue;
+        }
+
+        // supported commands are answered with the same values
+        if (command) {
+            sendControl(type & ~CMUX_CR, values, values_len);
+            if ((type & ~CMUX_CR) == CMUX_MSG_CLD) {
+                closeAll();
+            }
+        }
+    }
+}
+
+bool CMUX::sendFrame(uint8_t dlci, uint8_t ctrl, bool command, const uint8_t* data, size_t len) {
+    uint8_t frame[A76XX_CMUX_FRAME_SIZE + 7];
+    size_t pos = 0;
+    // the C/R bit is set on the commands of the initiator and the responses of the other end
+    frame[pos++] = CMUX_FLAG;
+    frame[pos++] = (dlci << 2) | (command == _initiator ? CMUX_CR : 0) | CMUX_EA;
+    frame[pos++] = ctrl;
+    if (len > 127) {
+        frame[pos++] = (len << 1) & 0xFE;
+        frame[pos++] = len >> 7;
+    } else {
+        frame[pos++] = (len << 1) | CMUX_EA;
+    }
+    uint8_t fcs = 0xFF;
+    for (size_t i = 1; i < pos; i++) {
+        fcs = fcsByte(fcs, frame[i]);
+    }
+    if (len > 0) {
+        memcpy(frame + pos, data, len);
+    }
+    if ((ctrl & ~CMUX_PF) != CMUX_UIH) {
+        for (size_t i = 0; i < len; i++) {
+            fcs = fcsByte(fcs, data[i]);
+        }
+    }
+    pos += len;
+    frame[pos++] = 0xFF - fcs;
+    frame[pos++] = CMUX_FLAG;
+
+    _tx_lock.acquire();
+    size_t written = _serial.write((const char*) frame, pos);
+    _tx_lock.release();
+    return written == pos;
+}
+
+bool CMUX::sendControl(uint8_t type, const uint8_t* values, size_t len) {
+    uint8_t msg[A76XX_CMUX_FRAME_SIZE];
+    // e.g. the echo of a long test command is truncated
+    if (len > sizeof(msg) - 2) {
+        len = sizeof(msg) - 2;
+    }
+    msg[0] = type;
+    msg[1] = (len << 1) | CMUX_EA;
+    if (len > 0) {
+        memcpy(msg + 2, values, len);
+    }
+    return sendFrame(0, CMUX_UIH, true, msg, len + 2);
+}
+
+bool CMUX::sendMSC(uint8_t dlci, bool flow_stop, bool command) {
+    uint8_t values[2] = {
+        (uint8_t) ((dlci << 2) | CMUX_CR | CMUX_EA),
+        (uint8_t) (CMUX_V24_SIGNALS | (flow_stop ? CMUX_V24_FC : 0))
+    };
+    return sendControl(CMUX_MSG_MSC | (command ? CMUX_CR : 0), values, sizeof(values));
+}
+
+int8_t CMUX::waitLink(uint8_t dlci, uint8_t from, uint32_t timeout) {
+    TimeoutCalc tc(timeout);
+    volatile uint8_t& state = linkState(dlci);
+    while (state == from) {
+        if (!pump(tc.remaining()) && tc.expired() && state == from) {
+            state = CMUX_LINK_CLOSED;
+            return A76XX_OPERATION_TIMEDOUT;
+        }
+    }
+    // a refused request leaves the link closed
+    if (from == CMUX_LINK_OPENING && state != CMUX_LINK_OPEN) {
+        return A76XX_GENERIC_ERROR;
+    }
+    return A76XX_OPERATION_SUCCEEDED;
+}
+
+void CMUX::closeAll() {
+    _ctrl_state = CMUX_LINK_CLOSED;
+    _peer_fc_all = false;
+    for (uint8_t i = 0; i < A76XX_CMUX_CHANNELS; i++) {
+        _channels[i]._state = CMUX_LINK_CLOSED;
+    }
+}
+
+size_t CMUXChannel::rxOverflows() {
+    return _rx.overflows();
+}
+
+bool CMUXChannel::stage() {
+    if (_mux == NULL) {
+        return false;
+    }
+    _mux->_rx_lock.acquire();
+    size_t len = _rx.getUsed();
+    if (len > _buf.getFree()) {
+        len = _buf.getFree();
+    }
+    if (len > 0) {
+        const uint8_t* data = _rx.linearize();
+        _buf.write(data, len);
+        traceRx(data, len);
+        _rx.consume(len);
+    }
+    // let the peer send again once the queue is mostly empty
+    if (_local_fc && _rx.getUsed() <= A76XX_CMUX_CHANNEL_BUFFER_SIZE / 4) {
+        _local_fc = false;
+        _mux->sendMSC(_dlci, false, true);
+    }
+    _mux->_rx_lock.release();
+    return _buf.getUsed() > 0;
+}
+
+bool CMUXChannel::fill(uint32_t wait) {
+    if (_buf.getUsed() > 0) return true;
+    TimeoutCalc tc(wait);
+    while (1) {
+        if (stage()) return true;
+        if (_state != CMUX_LINK_OPEN) return false;
+        if (!_mux->pump(tc.remaining()) && tc.expired()) return stage();
+    }
+}
+
+size_t CMUXChannel::readNumber(char* numberBuf, size_t len, bool decimal) {
+    TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+    size_t numberLen = 0;
+    bool seenDot = false;
+    int c;
+
+    //look for first occurrence of a valid char
+    while (1) {
+        c = timedPeek(tc);
+        if (c < 0) {
+            numberBuf[0] = '\0';
+            return 0;
+        }
+        if ((c >= '0' && c <= '9') || c == '-' || (decimal && c == '.')) break;
+        _buf.consume(1);
+    }
+
+    //minus is only valid as first char, the dot only once
+    while (numberLen < len - 1) {
+        c = timedPeek(tc);
+        if (c < 0) break;
+        bool valid = (c >= '0' && c <= '9')
+                  || (c == '-' && numberLen == 0)
+                  || (decimal && c == '.' && !seenDot);
+        if (!valid) break;
+        if (c == '.') seenDot = true;
+        numberBuf[numberLen++] = c;
+        _buf.consume(1);
+    }
+    numberBuf[numberLen] = '\0';
+    return numberLen;
+}
+
+Response_t CMUXChannel::waitResponse(const char* match_1,
+                                     const char* match_2,
+                                     const char* match_3,
+                                     uint32_t timeout,
+                                     bool match_OK,
+                                     bool match_ERROR) {
+    const char* cmp_str[5] = {
+            match_1,
+            match_2,
+            match_3,
+            match_OK ? RESPONSE_OK : NULL,
+            match_ERROR ? RESPONSE_ERROR : NULL
+    };
+    compileMatcher(cmp_str);
+    TimeoutCalc tc(waitTimeout(timeout, cmp_str));
+
+    Response_t rsp;
+    uint8_t val;
+
+    while (1) {
+        if (!_buf.pop(&val)) {
+            if (tc.expired() || !fill(tc.remaining())) {
+                return timeoutResponse();
+            }
+            continue;
+        }
+
+        //final responses and URCs are all found by the same automaton
+        if (matchByte(val, cmp_str, rsp)) {
+            return rsp;
+        }
+    }
+}
+
+long CMUXChannel::parseInt() {
+    char numberBuf[20];
+    if (readNumber(numberBuf, sizeof(numberBuf), false) == 0) return 0L;
+    return strtol(numberBuf, NULL, 10);
+}
+
+float CMUXChannel::parseFloat() {
+    char numberBuf[20];
+    if (readNumber(numberBuf, sizeof(numberBuf), true) == 0) return 0.0f;
+    return strtof(numberBuf, NULL);
+}
+
+void CMUXChannel::flush() {
+    _mux->_serial.flush();
+}
+
+bool CMUXChannel::find(char terminator) {
+    uint8_t val;
+    while (fill(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+        while (_buf.pop(&val)) {
+            if (val == (uint8_t) terminator) {
+                return true;
+            }
+        }
+    }
+    //timeout
+    return false;
+}
+
+size_t CMUXChannel::write(const char* data, size_t size) {
+    size_t written = 0;
+    TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+    while (written < size && _state == CMUX_LINK_OPEN) {
+        // wait while the peer asks us to stop sending
+        if (_peer_fc || _mux->_peer_fc_all) {
+            if (!_mux->pump(tc.remaining()) && tc.expired()) break;
+            continue;
+        }
+        size_t len = size - written;
+        if (len > _mux->_frame_size) {
+            len = _mux->_frame_size;
+        }
+        if (!_mux->sendFrame(_dlci, CMUX_UIH, true, (const uint8_t*) data + written, len)) break;
+        written += len;
+    }
+    traceTx((const uint8_t*) data, written);
+    return written;
+}
+
+size_t CMUXChannel::readBytesUntil(char terminator, char* buf, int len) {
+    uint8_t val;
+    size_t writeLen = 0;
+    while (fill(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+        while (_buf.pop(&val)) {
+            if (val == (uint8_t) terminator) {
+                return writeLen;
+            }
+            //save value to buffer
+            buf[writeLen++] = val;
+            if (writeLen == (size_t) len) return len;
+        }
+    }
+    //timeout
+    return 0;
+}
+
+size_t CMUXChannel::readBytes(void* buf, int len) {
+    size_t readLen = 0;
+    TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+    while (readLen < (size_t) len && fill(tc.remaining())) {
+        readLen += _buf.read((uint8_t*) buf + readLen, len - readLen);
+    }
+    return readLen;
+}
@@ -0,0 +1,335 @@
+#ifndef A76XX_CMUX_H_
+#define A76XX_CMUX_H_
+
+#include "A76XX.h"
+
+static_assert(A76XX_CMUX_CHANNEL_BUFFER_SIZE >= 2 * A76XX_CMUX_FRAME_SIZE,
+              "A CMUX channel buffer must hold at least two frames");
+
+class CMUX;
+
+// state of the link of a DLCI
+enum CMUXLinkState_t {
+    CMUX_LINK_CLOSED  = 0,
+    CMUX_LINK_OPENING = 1,
+    CMUX_LINK_OPEN    = 2,
+    CMUX_LINK_CLOSING = 3
+};
+
+/*
+    @brief A virtual channel of a CMUX multiplexer, used like any other serial
+        object, e.g. to construct A76XX or the command classes.
+
+    @details Each channel has its own parser, event handlers and transactions,
+        so that tasks using different channels run in parallel, e.g. AT commands
+        on one channel while GNSS sentences stream on another. Whichever task
+        reads the physical link queues the data of all channels; each channel then
+        stages its own data in a second buffer, only used by the task reading it.
+
+        Channels belong to the multiplexer, see CMUX::channel.
+*/
+class CMUXChannel final : public ModemSerial {
+    friend class CMUX;
+
+  public:
+    CMUXChannel()
+        : _mux(NULL)
+        , _dlci(0)
+        , _state(CMUX_LINK_CLOSED)
+        , _peer_fc(false)
+        , _local_fc(false) {}
+
+    /*
+        @brief The DLCI of the channel, from 1.
+    */
+    uint8_t dlci() {
+        return _dlci;
+    }
+
+    /*
+        @brief Whether the channel has been opened and not closed since.
+    */
+    bool isOpen() {
+        return _state == CMUX_LINK_OPEN;
+    }
+
+    /*
+        @brief Number of received bytes lost because the channel buffer was full.
+    */
+    size_t rxOverflows() override;
+
+    // the overloads with fewer match strings, hidden by the override below
+    using ModemSerial::waitResponse;
+
+    Response_t waitResponse(const char* match_1,
+                            const char* match_2,
+                            const char* match_3,
+                            uint32_t timeout = 1000,
+                            bool match_OK = true,
+                            bool match_ERROR = true) override;
+
+    bool waitAvailable(uint32_t timeout) override {
+        return fill(timeout);
+    }
+
+    int readLine(char* buf, size_t size, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT) override {
+        return readLineFrom(*this, buf, size, timeout);
+    }
+
+    int available() override {
+        fill(0);
+        return _buf.getUsed();
+    }
+
+    long parseInt() override;
+    float parseFloat() override;
+    void flush() override;
+
+    int peek() override {
+        uint8_t val;
+        if (!fill(0) || !_buf.peek(&val)) return -1;
+        return val;
+    }
+
+    int read() override {
+        uint8_t val;
+        if (!fill(0) || !_buf.pop(&val)) return -1;
+        return val;
+    }
+
+    bool find(char terminator) override;
+
+    size_t write(const char* data) override {
+        return write(data, strlen(data));
+    }
+
+    size_t write(const char* data, size_t size) override;
+    size_t readBytesUntil(char terminator, char* buf, int len) override;
+    size_t readBytes(void* buf, int len) override;
+
+  private:
+    CMUX*                                               _mux;
+    uint8_t                                            _dlci;
+    volatile uint8_t                                  _state;
+    // whether the peer asked us to stop sending, and whether we asked the peer
+    volatile bool                                   _peer_fc;
+    bool                                           _local_fc;
+    // data queued by the multiplexer, guarded by its lock
+    ByteRingBuf<A76XX_CMUX_CHANNEL_BUFFER_SIZE>          _rx;
+    // data staged for the task using the channel
+    ByteRingBuf<A76XX_CMUX_CHANNEL_BUFFER_SIZE>         _buf;
+
+    /*
+        @brief Stage the data queued for the channel, reading the physical link
+            if there is none.
+
+        @param [IN] wait Milliseconds to wait for at least one byte if nothing is buffered.
+        @return False if no data is available within the given time.
+    */
+    bool fill(uint32_t wait);
+
+    // move the queued data to the staging buffer, return whether there is any
+    bool stage();
+
+    int timedPeek(TimeoutCalc& tc) {
+        uint8_t val;
+        if (!fill(tc.remaining()) || !_buf.peek(&val)) return -1;
+        return val;
+    }
+
+    size_t readNumber(char* numberBuf, size_t len, bool decimal);
+};
+
+/*
+    @brief GSM 07.10 (3GPP TS 27.010) multiplexer, basic option, over a serial
+        object connected to the module.
+
+    @details Once the module has been switched to multiplexing mode, e.g. with
+        SerialInterfaceCommands::enableMUX, all data is exchanged in frames that
+        carry a DLCI, the number of a virtual channel. ::begin opens the control
+        channel, DLCI 0, then ::openChannel each of the channels used, which are
+        accessed with ::channel. ::end closes all of them and the module goes back
+        to plain AT commands.
+
+        There is no task reading the physical link: frames are read and dispatched
+        to their channel by whichever task waits for data on a channel, holding the
+        receive lock of the multiplexer for at most A76XX_CMUX_POLL_MS at a time, so
+        that tasks waiting on other channels take turns. Frames are written under a
+        separate lock, so that sending never waits for a reader. Hence the physical
+        serial object must not be used directly, nor its RX task started, while
+        multiplexing, but must allow one task to read while another one writes.
+
+        Flow control is per channel, with modem status commands: the peer is asked
+        to stop sending when the buffer of a channel is almost full, and the
+        channel stops sending when the peer asks for it.
+
+        The multiplexer can also take the role of the module, answering the
+        requests of the other end, e.g. to test an application on a host with two
+        multiplexers connected to each other.
+
+        Example:
+
+            serial.enableMUX();
+            CMUX mux(SerialAT);
+            mux.begin();
+            mux.openChannel(1);
+            mux.openChannel(2);
+            A76XX modem(*mux.channel(1));
+            GNSSClient gnss(*mux.channel(2));
+*/
+class CMUX {
+    friend class CMUXChannel;
+
+  public:
+    /*
+        @brief Construct a multiplexer on the serial object connected to the module.
+
+        @param [IN] serial The physical serial object.
+        @param [IN] initiator Whether this end opens the multiplexer, false to
+            play the part of the module.
+        @param [IN] frame_size Maximum number of bytes of data sent in one frame,
+            the N1 parameter of AT+CMUX, 31 unless set otherwise. Frames received
+            can be up to A76XX_CMUX_FRAME_SIZE bytes long.
+    */
+    CMUX(ModemSerial& serial, bool initiator = true, uint16_t frame_size = 31);
+
+    /*
+        @brief Open the control channel.
+
+        @param [IN] timeout Time to wait for the answer of the module.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT, or
+            A76XX_GENERIC_ERROR if the module refused.
+    */
+    int8_t begin(uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT);
+
+    /*
+        @brief Close all channels, then leave multiplexing mode.
+
+        @param [IN] timeout Time to wait for the answers of the module.
+        @return A76XX_OPERATION_SUCCEEDED or A76XX_OPERATION_TIMEDOUT. All channels
+            are closed in any case.
+    */
+    int8_t end(uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT);
+
+    /*
+        @brief Open a channel, once the control channel is open.
+
+        @param [IN] dlci The channel, from 1 to A76XX_CMUX_CHANNELS.
+        @param [IN] timeout Time to wait for the answer of the module.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT, or
+            A76XX_GENERIC_ERROR if the module refused or the DLCI is not valid.
+    */
+    int8_t openChannel(uint8_t dlci, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT);
+
+    /*
+        @brief Close a channel.
+
+        @param [IN] dlci The channel, from 1 to A76XX_CMUX_CHANNELS.
+        @param [IN] timeout Time to wait for the answer of the module.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT, or
+            A76XX_GENERIC_ERROR if the DLCI is not valid. The channel is closed
+            in any case.
+    */
+    int8_t closeChannel(uint8_t dlci, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT);
+
+    /*
+        @brief The serial object of a channel.
+
+        @param [IN] dlci The channel, from 1 to A76XX_CMUX_CHANNELS.
+        @return The channel, or NULL if the DLCI is not valid.
+    */
+    CMUXChannel* channel(uint8_t dlci);
+
+    /*
+        @brief Whether the control channel is open.
+    */
+    bool isActive() {
+        return _ctrl_state == CMUX_LINK_OPEN;
+    }
+
+    /*
+        @brief Read the physical link and dispatch the frames received.
+
+        @detail Called by the channels when they wait for data. Call it when no
+            channel is read, e.g. for the multiplexer of the module when testing,
+            so that the requests of the other end are answered.
+        @param [IN] wait Milliseconds to wait for a frame.
+        @return True if a frame has been received.
+    */
+    bool pump(uint32_t wait);
+
+    /*
+        @brief Number of frames dropped because they were corrupted, or too long.
+    */
+    uint32_t frameErrors() {
+        return _frame_errors;
+    }
+
+  private:
+    ModemSerial&                                     _serial;
+    const bool                                    _initiator;
+    const uint16_t                               _frame_size;
+    // held to read the link and the channel queues, and to write a frame
+    ChannelLock                                     _rx_lock;
+    ChannelLock                                     _tx_lock;
+    volatile uint8_t                             _ctrl_state;
+    // whether the peer stopped all channels
+    volatile bool                               _peer_fc_all;
+    CMUXChannel                _channels[A76XX_CMUX_CHANNELS];
+    uint32_t                                   _frame_errors;
+
+    // state of the frame being received
+    uint8_t                                        _rx_state;
+    uint8_t                                         _rx_addr;
+    uint8_t                                         _rx_ctrl;
+    uint8_t                                          _rx_fcs;
+    uint16_t                                         _rx_len;
+    uint16_t                                         _rx_pos;
+    uint8_t                   _rx_data[A76XX_CMUX_FRAME_SIZE];
+
+    /*
+        @brief Advance the frame being received by one byte.
+
+        @return True if the byte completes a valid frame, which has been dispatched.
+    */
+    bool feed(uint8_t c);
+
+    void dispatch();
+    void control(const uint8_t* data, size_t len);
+
+    /*
+        @brief Send a frame, in a single write.
+
+        @param [IN] dlci The channel.
+        @param [IN] ctrl The control field, i.e. the frame type and P/F bit.
+        @param [IN] command Whether the frame is a command rather than a response.
+        @param [IN] data The information field, at most A76XX_CMUX_FRAME_SIZE bytes.
+        @param [IN] len Length of the information field.
+        @return True if the whole frame has been written.
+    */
+    bool sendFrame(uint8_t dlci, uint8_t ctrl, bool command, const uint8_t* data, size_t len);
+
+    // send a message on the control channel, the type including the C/R bit
+    bool sendControl(uint8_t type, const uint8_t* values, size_t len);
+
+    // send a modem status command, or response, for a channel
+    bool sendMSC(uint8_t dlci, bool flow_stop, bool command);
+
+    volatile uint8_t& linkState(uint8_t dlci) {
+        return dlci == 0 ? _ctrl_state : _channels[dlci - 1]._state;
+    }
+
+    // pump until the state of the link changes from `from`, or time out
+    int8_t waitLink(uint8_t dlci, uint8_t from, uint32_t timeout);
+
+    // the peer closed the multiplexer
+    void closeAll();
+
+    // number of queued bytes above which the peer is asked to stop sending
+    size_t highWater() {
+        size_t mark = A76XX_CMUX_CHANNEL_BUFFER_SIZE - 2 * _frame_size;
+        return mark > A76XX_CMUX_CHANNEL_BUFFER_SIZE / 2 ? mark : A76XX_CMUX_CHANNEL_BUFFER_SIZE / 2;
+    }
+};
+
+#endif /* A76XX_CMUX_H_ */
@@ -82,11 +82,12 @@ enum GPSStart_t {
     HOT
 };
 
-class GNSSCommands {
+template <typename SERIAL = ModemSerial>
+class GNSSCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    GNSSCommands(ModemSerial& serial)
+    GNSSCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     /*
@@ -97,6 +98,7 @@ class GNSSCommands {
             or A76XX_GNSS_NOT_READY.
     */
     int8_t powerControl(bool enable_GNSS) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CGNSSPWR=", enable_GNSS ? 1 : 0);
         switch (_serial.waitResponse("+CGNSSPWR: READY!", 9000, !enable_GNSS, true)) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
@@ -120,6 +122,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t start(GPSStart_t _start) {
+        ModemSerial::Transaction txn(_serial);
         switch (_start) {
             case COLD: { _serial.sendCMD("AT+CGPSCOLD"); break; }
             case WARM: { _serial.sendCMD("AT+CGPSWARM"); break; }
@@ -145,6 +148,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setUART3BaudRate(uint32_t baud_rate) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGNSSIPR=", baud_rate);
         switch (_serial.waitResponse(9000)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -166,6 +170,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setSupportMode(uint8_t mode) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGNSSMODE=", mode);
         switch (_serial.waitResponse(9000)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -189,6 +194,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setNMEASentence(uint8_t nmea_mask) {
+        ModemSerial::Transaction txn(_serial, true);
         uint8_t nGGA = (nmea_mask & A76XX_GNSS_nGGA) >> 0;
         uint8_t nGLL = (nmea_mask & A76XX_GNSS_nGLL) >> 1;
         uint8_t nGSA = (nmea_mask & A76XX_GNSS_nGSA) >> 2; 
@@ -219,6 +225,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setNMEARate(uint8_t nmea_rate) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGPSNMEARATE=", nmea_rate);
         switch (_serial.waitResponse(9000)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -239,6 +246,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t startTestMode() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CGPSFTM=1");
         switch (_serial.waitResponse(9000)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -259,6 +267,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t stopTestMode() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CGPSFTM=0");
         switch (_serial.waitResponse(9000)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -280,30 +289,37 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t getGNSSInfo(GNSSInfo_t& info) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGNSSINFO");
         switch (_serial.waitResponse("+CGNSSINFO:", 9000, false, true)) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
-                // when we do not have a fix there is a space
-                if (_serial.peek() == ' ') { 
+                char line[128];
+                if (_serial.readLine(line, sizeof(line), 9000) < 0) {
+                    return A76XX_OPERATION_TIMEDOUT;
+                }
+                // when we do not have a fix all fields are empty
+                LineTokenizer fields(line);
+                LineField mode = fields.next();
+                if (mode.empty()) {
                     info.hasfix = false;
                 } else {
                     info.hasfix = true;
-                    info.mode        = _serial.parseInt();   _serial.find(',');
-                    info.GPS_SVs     = _serial.parseInt();   _serial.find(',');
-                    info.GLONASS_SVs = _serial.parseInt();   _serial.find(',');
-                    info.BEIDOU_SVs  = _serial.parseInt();   _serial.find(',');
-                    info.lat         = _serial.parseFloat(); _serial.find(',');
-                    info.NS          = _serial.read();       _serial.find(',');
-                    info.lon         = _serial.parseFloat(); _serial.find(',');
-                    info.EW          = _serial.read();       _serial.find(',');
-                    _serial.readBytes(info.date, 6);         _serial.find(',');
-                    _serial.readBytes(info.UTC_TIME, 9);     _serial.find(',');
-                    info.alt         = _serial.parseFloat(); _serial.find(',');
-                    info.speed       = _serial.parseFloat(); _serial.find(',');
-                    info.course      = _serial.parseFloat(); _serial.find(',');
-                    info.PDOP        = _serial.parseFloat(); _serial.find(',');
-                    info.HDOP        = _serial.parseFloat(); _serial.find(',');
-                    info.VDOP        = _serial.parseFloat();
+                    info.mode        = mode.toInt();
+                    info.GPS_SVs     = fields.next().toInt();
+                    info.GLONASS_SVs = fields.next().toInt();
+                    info.BEIDOU_SVs  = fields.next().toInt();
+                    info.lat         = fields.next().toFloat();
+                    info.NS          = fields.next().toChar();
+                    info.lon         = fields.next().toFloat();
+                    info.EW          = fields.next().toChar();
+                    fields.next().copy(info.date, sizeof(info.date));
+                    fields.next().copy(info.UTC_TIME, sizeof(info.UTC_TIME));
+                    info.alt         = fields.next().toFloat();
+                    info.speed       = fields.next().toFloat();
+                    info.course      = fields.next().toFloat();
+                    info.PDOP        = fields.next().toFloat();
+                    info.HDOP        = fields.next().toFloat();
+                    info.VDOP        = fields.next().toFloat();
                 }
                 // get last OK in any case
                 if (_serial.waitResponse(9000) == Response_t::A76XX_RESPONSE_OK) {
@@ -328,64 +344,39 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t getGPSInfo(GPSInfo_t& info) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGPSINFO");
         switch (_serial.waitResponse("+CGPSINFO: ", 9000, false, true)) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
-                // when we do not have a fix there should be an empty space after the : - not true in my case
-                if (_serial.peek() == ',') {
+                char line[96];
+                if (_serial.readLine(line, sizeof(line), 9000) < 0) {
+                    return A76XX_OPERATION_TIMEDOUT;
+                }
+                // when we do not have a fix all fields are empty
+                LineTokenizer fields(line);
+                LineField lat = fields.next();
+                if (lat.empty()) {
                     info.hasfix = false;
                 } else {
                     info.hasfix = true;
-                    char degreesBuf[4];
-
-                    if(_serial.peek() != ',') {
-                        //get 2 digits of lat degrees
-                        _serial.readBytes(degreesBuf, 2); degreesBuf[2] = '\0';
-                        //get lat minutes and combine them with degrees
-                        info.lat = (_serial.parseFloat() / 60.0f) + strtof(degreesBuf, NULL);
+                    // ddmm.mmmmmm, combine the minutes with the 2 digits of degrees
+                    if (lat.len > 2) {
+                        info.lat = LineField(lat.data, 2).toInt() + LineField(lat.data + 2, lat.len - 2).toFloat() / 60.0f;
                     } else {info.lat = 0.0f;}
-                     _serial.find(',');
+                    info.NS  = fields.next().toChar('N');
 
-                     if(_serial.peek() != ',') {
-                         info.NS = _serial.read();
-                     } else {info.NS = 'N';}
-                    _serial.find(',');
-
-                    if(_serial.peek() != ',') {
-                        //same procedure with lon degrees and minutes, but lon degrees have 3 digits
-                        _serial.readBytes(degreesBuf, 3); degreesBuf[3] = '\0';
-                        info.lon = (_serial.parseFloat() / 60.0f) + strtof(degreesBuf, NULL);
+                    // same procedure with lon, but lon degrees have 3 digits
+                    LineField lon = fields.next();
+                    if (lon.len > 3) {
+                        info.lon = LineField(lon.data, 3).toInt() + LineField(lon.data + 3, lon.len - 3).toFloat() / 60.0f;
                     } else {info.lon = 0.0f;}
-                    _serial.find(',');
-
-                    if(_serial.peek() != ',') {
-                        info.EW = _serial.read();
-                    } else {info.EW = 'E';}
-                    _serial.find(',');
+                    info.EW = fields.next().toChar('E');
 
-                    if(_serial.peek() != ',') {
-                        _serial.readBytes(info.date, 6);
-                    } else {info.date[0] = '\0';}
-                    _serial.find(',');
-
-                    if(_serial.peek() != ',') {
-                        _serial.readBytes(info.UTC_TIME, 9);
-                    } else {info.UTC_TIME[0] = '\0';}
-                    _serial.find(',');
-
-                    if(_serial.peek() != ',') {
-                        info.alt = _serial.parseFloat();
-                    } else {info.alt = 0.0f;}
-                    _serial.find(',');
-
-                    if(_serial.peek() != ',') {
-                        info.speed = _serial.parseFloat();
-                    } else {info.speed = 0.0f;}
-                    _serial.find(',');
-
-                    if(_serial.peek() != '\r') {
-                        info.course = _serial.parseFloat();
-                    } else {info.course = 0.0f;}
+                    fields.next().copy(info.date, sizeof(info.date));
+                    fields.next().copy(info.UTC_TIME, sizeof(info.UTC_TIME));
+                    info.alt    = fields.next().toFloat();
+                    info.speed  = fields.next().toFloat();
+                    info.course = fields.next().toFloat();
                 }
                 // get last OK in any case
                 if (_serial.waitResponse(9000) == Response_t::A76XX_RESPONSE_OK) {
@@ -410,6 +401,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t sendGNSSCommand(const char* cmd) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CGNSSCMD=0,", "\"", cmd, "\"");
         switch (_serial.waitResponse(9000, true, true)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -431,6 +423,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t enableNMEAOutput(bool enabled) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGNSSTST=", enabled == true ? "1" : "0");
         switch (_serial.waitResponse(9000)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -453,6 +446,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t selectOutputPort(bool output_parsed_data, bool output_nmea_data) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGNSSPORTSWITCH=", 
                         output_parsed_data == true ? "1" : "0", ",",
                         output_nmea_data   == true ? "1" : "0");
@@ -475,6 +469,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t getAGPSData() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CAGPS");
         switch (_serial.waitResponse("+AGPS: ", 9000, false, true)) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
@@ -503,6 +498,7 @@ class GNSSCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t getGPSProductInfo(char* info, size_t len) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGNSSPROD");
         switch (_serial.waitResponse("PRODUCT: ", 9000, false, true)) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
@@ -520,4 +516,6 @@ class GNSSCommands {
     }
 };
 
+typedef GNSSCommandsT<> GNSSCommands;
+
 #endif /* A76XX_GNSS_CMDS_H_ */
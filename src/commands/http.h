@@ -17,27 +17,31 @@
     HTTPREADFILE|             |        |
 */
 
-class HTTPCommands {
+template <typename SERIAL = ModemSerial>
+class HTTPCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    HTTPCommands(ModemSerial& serial)
+    HTTPCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     // HTTPINIT
     int8_t init() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+HTTPINIT");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPTERM
     int8_t term() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+HTTPTERM");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPPARA URL
     int8_t configHttpURL(const char* server, uint16_t port, const char* path, bool use_ssl) {
+        ModemSerial::Transaction txn(_serial, true);
         // add the protocol if not present
         if (strstr(server, "https://") == NULL && strstr(server, "http://") == NULL) {
             if (use_ssl == true) {
@@ -53,42 +57,49 @@ class HTTPCommands {
 
     // HTTPPARA CONNECTTO
     int8_t configHttpConnTimeout(int conn_timeout) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPPARA=\"CONNECTTO\",", conn_timeout);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPPARA RECVTO
     int8_t configHttpRecvTimeout(int recv_timeout) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPPARA=\"RECVTO\",", recv_timeout);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPPARA CONTENT
     int8_t configHttpContentType(const char* content_type) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPPARA=\"CONTENT\",\"", content_type, "\"");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPPARA ACCEPT
     int8_t configHttpAccept(const char* accept) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPPARA=\"ACCEPT\",\"", accept, "\"");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPPARA SSLCFG
     int8_t configHttpSSLCfgId(uint8_t sslcfg_id) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPPARA=\"SSLCFG\",", sslcfg_id);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPPARA USERDATA
     int8_t configHttpUserData(const char* header, const char* value) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPPARA=\"USERDATA\",\"", header, ":", value, "\"");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
 
     // HTTPPARA READMODE
     int8_t configHttpReadMode(uint8_t readmode) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPPARA=\"READMODE\",", readmode);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(120000))
     }
@@ -100,15 +111,20 @@ class HTTPCommands {
     // 3 => DELETE
     // 4 =>    PUT
     int8_t action(uint8_t method, uint16_t* status_code, uint32_t* length) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+HTTPACTION=", method);
         Response_t rsp = _serial.waitResponse("+HTTPACTION: ", 120000, false, true);
         switch (rsp) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
-                _serial.parseInt();
-                _serial.find(',');
-                *status_code = _serial.parseInt();
-                _serial.find(',');
-                *length = _serial.parseInt();
+                // <method>,<statuscode>,<datalen>
+                char line[32];
+                if (_serial.readLine(line, sizeof(line)) < 0) {
+                    return A76XX_OPERATION_TIMEDOUT;
+                }
+                LineTokenizer fields(line);
+                fields.skip();
+                *status_code = fields.next().toInt();
+                *length = fields.next().toInt();
                 return A76XX_OPERATION_SUCCEEDED;
             }
             case Response_t::A76XX_RESPONSE_TIMEOUT : {
@@ -122,6 +138,7 @@ class HTTPCommands {
 
     // HTTPHEAD
     int8_t readHeader(char* header, size_t max_len) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+HTTPHEAD");
         Response_t rsp = _serial.waitResponse("+HTTPHEAD: ", 120000, false, true);
         switch (rsp) {
@@ -163,6 +180,7 @@ class HTTPCommands {
     }
 
     int8_t getContentLength(uint32_t* len) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+HTTPREAD?");
         Response_t rsp = _serial.waitResponse("+HTTPREAD: LEN,", 120000, false, true);
         switch (rsp) {
@@ -182,6 +200,7 @@ class HTTPCommands {
     // HTTPREAD - read entire response. When calling, be sure that the provided array
     // can host up to body_length + 1 characters!
     int8_t readResponseBody(char* body, uint32_t body_length) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+HTTPREAD=", 0, ",", body_length);
         Response_t rsp = _serial.waitResponse("+HTTPREAD: ", 120000, false, true);
         switch (rsp) {
@@ -227,6 +246,7 @@ class HTTPCommands {
 
     // HTTPDATA
     int8_t inputData(const char* data, uint32_t length) {
+        ModemSerial::Transaction txn(_serial);
         // use 30 seconds timeout
         _serial.sendCMD("AT+HTTPDATA=", length, ",", 30);
 
@@ -259,4 +279,6 @@ class HTTPCommands {
     }
 };
 
+typedef HTTPCommandsT<> HTTPCommands;
+
 #endif /* A76XX_HTTP_CMDS_H_ */
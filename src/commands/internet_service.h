@@ -12,11 +12,12 @@
     AT+CNTP       |     y       | WRITE/EXEC | setNTPParams, updateSystemTime
 */
 
-class InternetServiceCommands {
+template <typename SERIAL = ModemSerial>
+class InternetServiceCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    InternetServiceCommands(ModemSerial& serial)
+    InternetServiceCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     /*
@@ -25,6 +26,7 @@ class InternetServiceCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setNTPParams(const char* host = "pool.ntp.org", int8_t timezone = 0) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CNTP=\"", host, "\",", timezone);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
@@ -39,6 +41,7 @@ class InternetServiceCommands {
             A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t updateSystemTime(uint32_t timeout) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CNTP");
         switch (_serial.waitResponse("+CNTP: ", timeout, false, true)) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
@@ -55,4 +58,6 @@ class InternetServiceCommands {
 
 };
 
+typedef InternetServiceCommandsT<> InternetServiceCommands;
+
 #endif /* A76XX_INTERNETSERVICE_CMDS_H_ */
@@ -17,7 +17,7 @@
     CMQTTDISC      |      y      |        | disconnect, isConnected
     CMQTTTOPIC     |      y      |        | setPublishTopic
     CMQTTPAYLOAD   |      y      |        | setPublishPayload
-    CMQTTPUB       |      y      |        | publish
+    CMQTTPUB       |      y      |        | publish, publishAsync, publishNoWait
     CMQTTSUBTOPIC  |             |        |
     CMQTTSUB       |      y      |        | subscribe
     CMQTTUNSUBTOPIC|             |        |
@@ -25,15 +25,17 @@
     CMQTTCFG       |             |        |
 */
 
-class MQTTCommands {
+template <typename SERIAL = ModemSerial>
+class MQTTCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    MQTTCommands(ModemSerial& serial)
+    MQTTCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     // CMQTTSTART
     int8_t start() {
+        ModemSerial::Transaction txn(_serial);
         // start MQTT service by activating PDP context
         _serial.sendCMD("AT+CMQTTSTART");
         Response_t rsp = _serial.waitResponse("+CMQTTSTART: ", 12000, false, true);
@@ -47,6 +49,7 @@ class MQTTCommands {
 
     // CMQTTSTOP
     int8_t stop() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTSTOP");
         Response_t rsp = _serial.waitResponse("+CMQTTSTOP: ", 12000, false, true);
 
@@ -59,6 +62,7 @@ class MQTTCommands {
 
     // CMQTTACCQ
     int8_t acquireClient(uint8_t client_index, const char clientID[], uint8_t server_type) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTACCQ=", client_index, ",\"", clientID, "\",", server_type);
         Response_t rsp = _serial.waitResponse("+CMQTTACCQ: ", 9000, true, true);
 
@@ -84,6 +88,7 @@ class MQTTCommands {
 
     // CMQTTREL
     int8_t releaseClient(uint8_t client_index) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTREL=", client_index);
         Response_t rsp = _serial.waitResponse("+CMQTTREL: ", 9000, true, true);
 
@@ -103,12 +108,14 @@ class MQTTCommands {
 
     // CMQTTSSLCFG
     int8_t setSSLContext(uint8_t session_id, uint8_t ssl_ctx_index) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CMQTTSSLCFG=", session_id, ",", ssl_ctx_index);
         return _serial.waitResponse();
     }
 
     // CMQTTWILLTOPIC
     int8_t setWillTopic(uint8_t client_index, const char* will_topic) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTWILLTOPIC=", client_index, ",", strlen(will_topic));
 
         Response_t rsp = _serial.waitResponse(">", "+CMQTTWILLTOPIC: ", 9000);
@@ -138,6 +145,7 @@ class MQTTCommands {
 
     // CMQTTWILLMSG
     int8_t setWillMessage(uint8_t client_index, const char* will_message, uint8_t will_qos) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTWILLMSG=", client_index, ",", strlen(will_message), ",", will_qos);
 
         Response_t rsp = _serial.waitResponse(">", "+CMQTTWILLMSG: ", 9000);
@@ -169,6 +177,7 @@ class MQTTCommands {
     int8_t connect(uint8_t client_index, const char* server, int port,
                    bool clean_session, int keepalive = 60,
                    const char* username = NULL, const char* password = NULL) {
+        ModemSerial::Transaction txn(_serial);
 
         if (username && password) {
             _serial.sendCMD("AT+CMQTTCONNECT=", client_index, ",\"tcp://", server, ":", port, "\",", keepalive, ",", clean_session, ",\"", username, "\",\"", password, "\"");
@@ -197,6 +206,7 @@ class MQTTCommands {
 
     // CMQTTDISC?
     bool isConnected(uint8_t client_index) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CMQTTDISC?");
 
         char match_str[15] = "+CMQTTDISC: x,";
@@ -214,6 +224,7 @@ class MQTTCommands {
 
     // CMQTTDISC
     int8_t disconnect(uint8_t client_index, uint8_t timeout) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTDISC=", client_index, ",", timeout);
         Response_t rsp = _serial.waitResponse("+CMQTTDISC: ", timeout*1000, false, true);
 
@@ -234,6 +245,7 @@ class MQTTCommands {
 
     // CMQTTTOPIC
     int8_t setTopic(uint8_t client_index, const char* topic) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTTOPIC=", client_index, ",", strlen(topic));
 
         Response_t rsp = _serial.waitResponse(">", "+CMQTTTOPIC: ", 9000);
@@ -263,6 +275,7 @@ class MQTTCommands {
 
     // CMQTTPAYLOAD
     int8_t setPayload(uint8_t client_index, const uint8_t* payload, uint32_t length) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTPAYLOAD=", client_index, ",", length);
 
         Response_t rsp = _serial.waitResponse(">", "+CMQTTTPAYLOAD: ", 9000);
@@ -292,29 +305,63 @@ class MQTTCommands {
 
     // CMQTTPUB
     int8_t publish(uint8_t client_index, uint8_t qos, uint8_t pub_timeout, bool retained = false, bool dup = false) {
+        AsyncCommand_t cmd;
+        publishAsync(cmd, client_index, qos, pub_timeout, retained, dup);
+        _serial.run(cmd);
+        return cmd.retcode();
+    }
+
+    /*
+        @brief Non-blocking version of ::publish.
+
+        @detail Once cmd.done() is true, cmd.retcode() holds the value ::publish
+            would return.
+        @param [IN] cmd The command object, which must stay alive until done.
+        @return False if cmd is still pending from a previous call.
+    */
+    bool publishAsync(AsyncCommand_t& cmd, uint8_t client_index, uint8_t qos, uint8_t pub_timeout, bool retained = false, bool dup = false) {
         uint8_t _retained = retained ? 1 : 0;
         uint8_t _dup      = dup      ? 1 : 0;
-        _serial.sendCMD("AT+CMQTTPUB=", client_index, ",", qos, ",", pub_timeout, ",", _retained, ",", _dup);
+        if (cmd.state() == AsyncCommand_t::QUEUED || cmd.state() == AsyncCommand_t::RUNNING) {
+            return false;
+        }
+        cmd.set("AT+CMQTTPUB=", client_index, ",", qos, ",", pub_timeout, ",", _retained, ",", _dup);
 
         // we already have read OK
-        Response_t rsp = _serial.waitResponse("+CMQTTPUB: ", 9000, false, true);
+        cmd.expect("+CMQTTPUB: ", 9000, false, true);
+        cmd.onResponse(parsePublish, true);
+        return _serial.submit(cmd);
+    }
 
-        switch (rsp) {
-            case Response_t::A76XX_RESPONSE_MATCH_1ST : {
-                _serial.find(',');
-                return _serial.parseIntClear();
-            }
-            case Response_t::A76XX_RESPONSE_TIMEOUT : {
-                return A76XX_OPERATION_TIMEDOUT;
-            }
-            default : {
-                return A76XX_GENERIC_ERROR;
-            }
+    /*
+        @brief Start publishing the message set with ::setTopic and ::setPayload,
+            without waiting for its outcome, which the module reports later with
+            the URC "+CMQTTPUB: <client_index>,<err>".
+
+        @detail The module takes the next message as soon as this returns, so
+            several messages can await their outcome. On failure, the module sends
+            a line "+CMQTTPUB: " before ERROR, which is left to the event handlers.
+        @return A76XX_OPERATION_SUCCEEDED once the module has taken the message.
+    */
+    int8_t publishNoWait(uint8_t client_index, uint8_t qos, uint8_t pub_timeout, bool retained = false, bool dup = false) {
+        ModemSerial::Transaction txn(_serial);
+        uint8_t _retained = retained ? 1 : 0;
+        uint8_t _dup      = dup      ? 1 : 0;
+        _serial.sendCMD("AT+CMQTTPUB=", client_index, ",", qos, ",", pub_timeout, ",", _retained, ",", _dup);
+        A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
+    }
+
+    static void parsePublish(AsyncCommand_t& cmd, ModemSerial& serial) {
+        // the error code follows the client index, in the line read by poll
+        if (cmd.response() == Response_t::A76XX_RESPONSE_MATCH_1ST) {
+            const char* err = strchr(cmd.line(), ',');
+            cmd.setRetcode(err != NULL ? strtol(err + 1, NULL, 10) : A76XX_GENERIC_ERROR);
         }
     }
 
     // CMQTTSUB
     int8_t subscribe(uint8_t client_index, const char* topic, uint8_t qos) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMQTTSUB=", client_index, ",", strlen(topic), ",", qos);
         Response_t rsp = _serial.waitResponse(">", "+CMQTTSUB: ", 9000, false, true);
         switch (rsp) {
@@ -343,4 +390,6 @@ class MQTTCommands {
 
 };
 
+typedef MQTTCommandsT<> MQTTCommands;
+
 #endif /* A76XX_MQTT_CMDS_H_ */
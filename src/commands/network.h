@@ -22,11 +22,12 @@
 
 */
 
-class NetworkCommands {
+template <typename SERIAL = ModemSerial>
+class NetworkCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    NetworkCommands(ModemSerial& serial)
+    NetworkCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     /*
@@ -36,6 +37,7 @@ class NetworkCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t getNetworkRegistrationStatus(int8_t& status) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CREG?");
         Response_t rsp = _serial.waitResponse("+CREG: ", 9000, false, true);
         switch (rsp) {
@@ -59,6 +61,7 @@ class NetworkCommands {
         @return The <stat> code, from 0 to 8, or an error code.
     */
     int8_t getNetworkSystemMode(int8_t& mode) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CNSMOD?");
         Response_t rsp = _serial.waitResponse("+CNSMOD: ");
         switch (rsp) {
@@ -82,6 +85,7 @@ class NetworkCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t setTimeZoneAutoUpdate(bool enable) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CTZU=", enable ? "1" : "0");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse())
     }
@@ -92,9 +96,12 @@ class NetworkCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t setTimeZoneURC(bool enable) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CTZR=", enable ? "1" : "0");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 };
 
+typedef NetworkCommandsT<> NetworkCommands;
+
 #endif /* A76XX_NETWORK_CMDS_H_ */
@@ -26,11 +26,12 @@
     CPING   |             |        |
 */
 
-class PacketDomainCommands {
+template <typename SERIAL = ModemSerial>
+class PacketDomainCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    PacketDomainCommands(ModemSerial& serial)
+    PacketDomainCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     /*
@@ -57,6 +58,7 @@ class PacketDomainCommands {
         @brief Helper function
     */
     int8_t getXXXNetworkRegistrationStatus(char select, int8_t& status) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+C", select, "REG?");
         char buff[] = "+CxREG: "; buff[2] = select;
         Response_t rsp = _serial.waitResponse(buff, 9000, false, true);
@@ -83,6 +85,7 @@ class PacketDomainCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setPDPContextActiveStatus(uint8_t cid, bool activate) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CGACT=", activate ? "1" : "0", ",", cid);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
     }
@@ -95,6 +98,7 @@ class PacketDomainCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t getPDPContextActiveStatus(uint8_t cid, int8_t& status) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGACT?");
         char buff[13];
         sprintf(buff, "+CGACT: %d,", cid);
@@ -125,6 +129,7 @@ class PacketDomainCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setPDPContextParameters(uint8_t cid, const char* apn) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGDCONT=", cid,",\"IP\",\"", apn, "\"");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
     }
@@ -142,6 +147,7 @@ class PacketDomainCommands {
                                 uint8_t auth_type = 0,
                                 const char* password = NULL,
                                 const char* username = NULL) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.printCMD("AT+CGAUTH=", cid);
         if (auth_type != 0)    { _serial.printCMD(",", auth_type);}
         if (password  != NULL) { _serial.printCMD(",", password);}
@@ -152,4 +158,6 @@ class PacketDomainCommands {
 
 };
 
+typedef PacketDomainCommandsT<> PacketDomainCommands;
+
 #endif /* A76XX_PACKETDOMAIN_CMDS_H_ */
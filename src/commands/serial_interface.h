@@ -9,10 +9,11 @@
     -------- | ----------- | ------ |------------
     AT&D     |             |        |
     AT&C     |             |        |
-    AT+IPR   |             |        |
-    AT+IPREX |             |        |
+    AT+IPR   |      y      | WRITE  | setBaudRate
+    AT+IPR   |      y      | READ   | getBaudRate
+    AT+IPREX |      y      | WRITE  | setBaudRatePermanent
     AT+ICF   |             |        |
-    AT+IFC   |             |        |
+    AT+IFC   |      y      | WRITE  | setFlowControl
     AT+CSCLK |      y      | WRITE  | UARTSleep
     AT+CMUX  |      y      | WRITE  | enableMUX
     AT+CATR  |      y      | WRITE  | setURCInterface
@@ -21,29 +22,97 @@
 
 */
 
-class SerialInterfaceCommands {
+template <typename SERIAL = ModemSerial>
+class SerialInterfaceCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    SerialInterfaceCommands(ModemSerial& serial)
+    SerialInterfaceCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
+    /*
+        @brief Implementation for IPR - Write Command.
+        @detail Set the baud rate of the UART of the module, until it reboots. The
+            module answers at the current rate, then switches to the new one.
+        @param [IN] baud The new rate, e.g. 921600 or 3686400.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t setBaudRate(uint32_t baud) {
+        ModemSerial::Transaction txn(_serial, true);
+        _serial.sendCMD("AT+IPR=", baud);
+        A76XX_RESPONSE_PROCESS(_serial.waitResponse());
+    }
+
+    /*
+        @brief Implementation for IPR - Read Command.
+        @detail Get the baud rate of the UART of the module.
+        @param [OUT] baud The current rate, 0 for automatic detection.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t getBaudRate(uint32_t& baud) {
+        ModemSerial::Transaction txn(_serial, true);
+        _serial.sendCMD("AT+IPR?");
+        switch (_serial.waitResponse("+IPR: ")) {
+            case Response_t::A76XX_RESPONSE_MATCH_1ST : {
+                baud = _serial.parseInt();
+                A76XX_RESPONSE_PROCESS(_serial.waitResponse())
+            }
+            case Response_t::A76XX_RESPONSE_TIMEOUT : {
+                return A76XX_OPERATION_TIMEDOUT;
+            }
+            default : {
+                return A76XX_GENERIC_ERROR;
+            }
+        }
+    }
+
+    /*
+        @brief Implementation for IPREX - Write Command.
+        @detail Set the baud rate of the UART of the module and save it, so that
+            the module starts at this rate after a reboot.
+        @param [IN] baud The new rate.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t setBaudRatePermanent(uint32_t baud) {
+        ModemSerial::Transaction txn(_serial, true);
+        _serial.sendCMD("AT+IPREX=", baud);
+        A76XX_RESPONSE_PROCESS(_serial.waitResponse());
+    }
+
+    /*
+        @brief Implementation for IFC - Write Command.
+        @detail Set the flow control of the UART of the module.
+        @param [IN] dce_by_dte How the host stops the module sending: 0 for none,
+            2 for the RTS line.
+        @param [IN] dte_by_dce How the module stops the host sending: 0 for none,
+            2 for the CTS line.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t setFlowControl(uint8_t dce_by_dte, uint8_t dte_by_dce) {
+        ModemSerial::Transaction txn(_serial, true);
+        _serial.sendCMD("AT+IFC=", dce_by_dte, ",", dte_by_dce);
+        A76XX_RESPONSE_PROCESS(_serial.waitResponse());
+    }
+
     /*
         @brief Implementation for CSCLK - Write Command.
         @detail Control UART sleep.
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t UARTSleep(uint8_t status) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSCLK=", status);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     /*
         @brief Implementation for CMUX - Write Command.
-        @detail Enable the multiplexer over the UART.
+        @detail Enable the multiplexer over the UART. From then on, all data is
+            exchanged in frames, see CMUX.
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t enableMUX() {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CMUX=0");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
@@ -54,10 +123,13 @@ class SerialInterfaceCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t setURCInterface(uint8_t port) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CATR=", port);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
 };
 
+typedef SerialInterfaceCommandsT<> SerialInterfaceCommands;
+
 #endif /* A76XX_SERIALINTERFACE_CMDS_H_ */
@@ -34,11 +34,12 @@ enum PINStatus_t {
     DUALSIMURC      |             |        |
 */
 
-class SIMCommands {
+template <typename SERIAL = ModemSerial>
+class SIMCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    SIMCommands(ModemSerial& serial)
+    SIMCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     /*
@@ -50,6 +51,7 @@ class SIMCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t getPINStatus(PINStatus_t& status) {
+        ModemSerial::Transaction txn(_serial, true);
         status = PINStatus_t::UKNOWN;
         _serial.sendCMD("AT+CPIN?");
         switch(_serial.waitResponse("+CPIN: ", 9000, false, true)) {
@@ -87,9 +89,12 @@ class SIMCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t enterPIN(const char* pincode) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CPIN=", pincode);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse())
     }
 };
 
+typedef SIMCommandsT<> SIMCommands;
+
 #endif /* A76XX_SIM_CMDS_H_ */
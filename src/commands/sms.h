@@ -44,15 +44,17 @@ struct SMSPosition_t {
     uint16_t length;
 };
 
-class SMSCommands {
+template <typename SERIAL = ModemSerial>
+class SMSCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    SMSCommands(ModemSerial& serial)
+    SMSCommandsT(SERIAL& serial)
         : _serial(serial) {}
     
     // CPMS
     int8_t setStorage() {
+        ModemSerial::Transaction txn(_serial, true);
         // reset SMS storage by issuing command without parameters
         // -> default storage (SIM Card) is set
         _serial.sendCMD("AT+CPMS");
@@ -87,6 +89,7 @@ class SMSCommands {
     // CMGF
     // Set the message format to be either PDU or text mode
     int8_t setMessageFormat(SMSMsgFormat_t msgFormat) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CMGF=", (uint16_t) msgFormat);
         Response_t rsp = _serial.waitResponse(9000);
         A76XX_RESPONSE_PROCESS(rsp)
@@ -96,6 +99,7 @@ class SMSCommands {
     // set text mode parameters.
     // DCS must be compatible with current AT+CSCS setting! (see characterSet cmd)
     int8_t setTextModeParam(uint8_t fo = 17, uint8_t vp = 167, uint8_t pid = 0, uint8_t dcs = 0) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSMP=", fo, ',', vp, ',', pid, ',', dcs);
         Response_t rsp = _serial.waitResponse("+CMS ERROR: ", 9000);
         A76XX_RESPONSE_PROCESS(rsp)
@@ -105,6 +109,7 @@ class SMSCommands {
     // CNMI
     // set new message notification settings to default values
     int8_t setNotification() {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CNMI");
         Response_t rsp = _serial.waitResponse(9000);
 
@@ -115,6 +120,7 @@ class SMSCommands {
     // write into given array of SMSPosition_t
     // return value is not an error code, but number of found messages
     uint8_t list(SMSPosition_t* positions, uint8_t positionsLen, SMSStatus_t statusFilter) {
+        ModemSerial::Transaction txn(_serial);
         if((positionsLen == 0) || (positions == NULL))
             return 0;
         
@@ -129,11 +135,16 @@ class SMSCommands {
         while(1) {
             rsp = _serial.waitResponse("+CMGL: ", 9000);
             if(rsp == Response_t::A76XX_RESPONSE_MATCH_1ST) {
-                // found message
-                positions[foundMsg].index = _serial.parseInt(); _serial.find(',');
-                positions[foundMsg].status = (SMSStatus_t) _serial.parseInt(); _serial.find(',');
-                _serial.find(','); // ignore <alpha>
-                positions[foundMsg].length = _serial.parseInt(); _serial.find('\n');
+                // found message: <index>,<stat>,[<alpha>],<length>
+                char line[48];
+                if(_serial.readLine(line, sizeof(line), 9000) < 0) {
+                    return foundMsg;
+                }
+                LineTokenizer fields(line);
+                positions[foundMsg].index = fields.next().toInt();
+                positions[foundMsg].status = (SMSStatus_t) fields.next().toInt();
+                fields.skip(); // ignore <alpha>
+                positions[foundMsg].length = fields.next().toInt();
                 _serial.find('\n'); // ignore message PDU
 
                 if(++foundMsg == positionsLen) {
@@ -153,6 +164,7 @@ class SMSCommands {
     // reads the message at given index in PDU mode
     // and converts the hexadecimal format into binary representation
     int8_t read(uint8_t index, uint8_t* buffer, uint16_t bufLen, uint16_t* msgLen, SMSStatus_t* msgStatus = NULL) {
+        ModemSerial::Transaction txn(_serial);
         if((buffer == NULL) || (bufLen == 0) || (msgLen == NULL)) {
             return A76XX_OUT_OF_MEMORY;
         }
@@ -170,13 +182,19 @@ class SMSCommands {
         switch(rsp) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST:
             {
+                // <stat>,[<alpha>],<length>
+                char line[48];
+                if(_serial.readLine(line, sizeof(line), 9000) < 0) {
+                    return A76XX_OPERATION_TIMEDOUT;
+                }
+                LineTokenizer fields(line);
+                SMSStatus_t status = (SMSStatus_t) fields.next().toInt();
                 if(msgStatus) {
-                    *msgStatus = (SMSStatus_t) _serial.parseInt();
+                    *msgStatus = status;
                 }
-                _serial.find(',');
-                _serial.find(','); // skip <alpha>
+                fields.skip(); // skip <alpha>
                 
-                uint16_t pduLen = _serial.parseInt(); _serial.find('\n');
+                uint16_t pduLen = fields.next().toInt();
                 
                 // pduLen is in bytes
                 // pduLen doesn't take SMSC info at PDU beginning into account.
@@ -225,6 +243,7 @@ class SMSCommands {
     // CMGS
     // Takes a PDU in binary format, hex-encodes it and attempts to send it in PDU mode.
     int8_t send(uint8_t* pdu, uint8_t length) {
+        ModemSerial::Transaction txn(_serial);
         if(pdu == NULL || length == 0) return A76XX_GENERIC_ERROR;
         int8_t retcode;
 
@@ -235,11 +254,17 @@ class SMSCommands {
         _serial.sendCMD("AT+CMGS=", length - 1); // don't count SMSC length byte in PDU length
         _serial.find('>');
 
-        char highByte, lowByte;
+        // hex-encode the PDU in chunks, each written with a single call
+        char hexBuf[64];
+        uint8_t hexLen = 0;
 
         for(int i=0; i<length; i++) {
-            byteTohexPair(pdu[i], &highByte, &lowByte);
-            _serial.printCMD(highByte, lowByte);
+            byteTohexPair(pdu[i], &hexBuf[hexLen], &hexBuf[hexLen+1]);
+            hexLen += 2;
+            if(hexLen == sizeof(hexBuf) || i == length - 1) {
+                _serial.write(hexBuf, hexLen);
+                hexLen = 0;
+            }
         }
         _serial.sendCMD((char) 0x1A);
         
@@ -257,6 +282,7 @@ class SMSCommands {
     // CMGD
     // Delete a message
     int8_t remove(uint8_t index, uint8_t delflag = 0) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CMGD=", index, ',', delflag);
         Response_t rsp = _serial.waitResponse("+CMS ERROR: ", 9000);
 
@@ -264,5 +290,7 @@ class SMSCommands {
     }
 };
 
+typedef SMSCommandsT<> SMSCommands;
+
 
 #endif /*A76XX_SMS_CMDS_H_*/
\ No newline at end of file
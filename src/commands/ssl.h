@@ -24,69 +24,80 @@
     CCERTMOVE |             |        |
 */
 
-class SSLCommands {
+template <typename SERIAL = ModemSerial>
+class SSLCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    SSLCommands(ModemSerial& serial)
+    SSLCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     // CSSLCFG sslversion
     int8_t configSSLSSLversion(uint8_t ssl_ctx_index, uint8_t ssl_version) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"sslversion\",", ssl_ctx_index, ",", ssl_version);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG authmode
     int8_t configSSLAuthmode(uint8_t ssl_ctx_index, uint8_t authmode) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"authmode\",", ssl_ctx_index, ",", authmode);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG ignorelocaltime
     int8_t configSSLIgnorelocaltime(uint8_t ssl_ctx_index, uint8_t ignorelocaltime) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"ignorelocaltime\",", ssl_ctx_index, ",", ignorelocaltime);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG negotiatetime
     int8_t configSSLNegotiatetime(uint8_t ssl_ctx_index, uint16_t negotiatetime) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"negotiatetime\",", ssl_ctx_index, ",", negotiatetime);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG cacert
     int8_t configSSLCacert(uint8_t ssl_ctx_index, const char* ca_file) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"cacert\",", ssl_ctx_index, ",\"", ca_file, "\"");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG clientcert
     int8_t configSSLClientcert(uint8_t ssl_ctx_index, const char* clientcert_file) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"clientcert\",", ssl_ctx_index, ",", clientcert_file);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG clientkey
     int8_t configSSLClientkey(uint8_t ssl_ctx_index, const char* clientkey_file) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"clientkey\",", ssl_ctx_index, ",", clientkey_file);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG password
     int8_t configSSLPassword(uint8_t ssl_ctx_index, const char* password_file) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"password\",", ssl_ctx_index, ",", password_file);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CSSLCFG enableSNI
     int8_t configSSLContext(uint8_t ssl_ctx_index, uint8_t enableSNI_flag) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CSSLCFG=\"enableSNI\",", ssl_ctx_index, ",", enableSNI_flag);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CCERTDOWN
     int8_t certDownload(const char* cert, const char* certname) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CCERTDOWN=\"", certname, "\",", strlen(cert));
         Response_t rsp = _serial.waitResponse(">", 120000);
 
@@ -112,6 +123,7 @@ class SSLCommands {
     // CCERTLIST
     // check a file named `certname` already exists in the list of certificates
     bool certExists(const char* certname) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CCERTLIST");
         Response_t rsp = _serial.waitResponse(certname, 120000);
         switch (rsp) {
@@ -127,12 +139,14 @@ class SSLCommands {
 
     // CCERTDELE
     int8_t certDelete(const char* certname) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CCERTDELE=\"", certname, "\"");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
 
     // CCHSSLCFG
     int8_t setSSLContext(uint8_t session_id, uint8_t ssl_ctx_index) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CCHSSLCFG=", session_id, ",", ssl_ctx_index);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse());
     }
@@ -158,4 +172,6 @@ class SSLCommands {
     }
 };
 
+typedef SSLCommandsT<> SSLCommands;
+
 #endif /* A76XX_SSL_CMDS_H_ */
@@ -22,11 +22,12 @@
     SIMEI   |     -       |        |
 */
 
-class StatusControlCommands {
+template <typename SERIAL = ModemSerial>
+class StatusControlCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    StatusControlCommands(ModemSerial& serial)
+    StatusControlCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
     /*
@@ -37,6 +38,7 @@ class StatusControlCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setPhoneFunctionality(uint8_t fun, bool reset = false) {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CFUN=", fun, reset ? ",1" : "");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
     }
@@ -47,6 +49,7 @@ class StatusControlCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t powerOff() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CPOF");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
     }
@@ -57,6 +60,7 @@ class StatusControlCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t reset() {
+        ModemSerial::Transaction txn(_serial);
         _serial.sendCMD("AT+CRESET");
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
     }
@@ -70,6 +74,7 @@ class StatusControlCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t getDateTime(char* dateTime) {
+        ModemSerial::Transaction txn(_serial, true);
         if (strlen(dateTime) < 20) {
             return A76XX_GENERIC_ERROR;
         }
@@ -100,9 +105,12 @@ class StatusControlCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR.
     */
     int8_t setErrorResultCodes(uint8_t n) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CMEE=", n);
         A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
     }
 };
 
+typedef StatusControlCommandsT<> StatusControlCommands;
+
 #endif /* A76XX_STATUSCONTROL_CMDS_H_ */
@@ -7,12 +7,12 @@
 
     Command  | Implemented | Method | Function(s)
     -------- | ----------- | ------ |-----------------------
-    ATD      |             |        |
+    ATD      |     y       | EXEC   | dial, dialData
     ATA      |             |        |
-    ATH      |             |        |
+    ATH      |     y       | EXEC   | hangUp
     ATS0     |             |        |
-    +++      |             |        |
-    ATO      |             |        |
+    +++      |     y       | EXEC   | escapeDataMode
+    ATO      |     y       | EXEC   | resumeDataMode
     ATI      |             |        |
     ATE      |     y       | WRITE  | commandEcho
     AT&V     |             |        |
@@ -37,13 +37,118 @@ typedef enum {
     A76XX_CHARSET_GSM = 3
 } characterSet_t;
 
-class V25TERCommands {
+template <typename SERIAL = ModemSerial>
+class V25TERCommandsT {
   public:
-    ModemSerial& _serial;
+    SERIAL& _serial;
 
-    V25TERCommands(ModemSerial& serial)
+    V25TERCommandsT(SERIAL& serial)
         : _serial(serial) {}
 
+    /*
+        @brief Implementation for ATD - EXEC Command.
+        @detail Originate a call. A data call, e.g. to "*99#" to start PPP on the
+            PDP context defined with AT+CGDCONT, switches the module to data mode
+            on CONNECT; a voice call, with a trailing ';', is answered with OK.
+        @param [IN] number The number to dial.
+        @param [IN] timeout Time to wait for the module to connect.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t dial(const char* number, uint32_t timeout = 30000) {
+        ModemSerial::Transaction txn(_serial);
+        _serial.sendCMD("ATD", number);
+        switch(_serial.waitResponse("CONNECT", "NO CARRIER", timeout)) {
+            case Response_t::A76XX_RESPONSE_MATCH_1ST : {
+                // the rest of the line may carry the connection speed
+                _serial.find('\n');
+                return A76XX_OPERATION_SUCCEEDED;
+            }
+            case Response_t::A76XX_RESPONSE_OK : {
+                return A76XX_OPERATION_SUCCEEDED;
+            }
+            case Response_t::A76XX_RESPONSE_TIMEOUT : {
+                return A76XX_OPERATION_TIMEDOUT;
+            }
+            default : {
+                return A76XX_GENERIC_ERROR;
+            }
+        }
+    }
+
+    /*
+        @brief Implementation for ATD - EXEC Command, for a data call only.
+        @detail As ::dial, but only CONNECT counts as success: an OK means the
+            module set up a voice call and stays in command mode.
+        @param [IN] number The number to dial.
+        @param [IN] timeout Time to wait for the module to connect.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t dialData(const char* number, uint32_t timeout = 30000) {
+        ModemSerial::Transaction txn(_serial);
+        _serial.sendCMD("ATD", number);
+        switch(_serial.waitResponse("CONNECT", "NO CARRIER", timeout)) {
+            case Response_t::A76XX_RESPONSE_MATCH_1ST : {
+                _serial.find('\n');
+                return A76XX_OPERATION_SUCCEEDED;
+            }
+            case Response_t::A76XX_RESPONSE_TIMEOUT : {
+                return A76XX_OPERATION_TIMEDOUT;
+            }
+            default : {
+                return A76XX_GENERIC_ERROR;
+            }
+        }
+    }
+
+    /*
+        @brief Implementation for +++ - EXEC Command.
+        @detail Switch from data mode to command mode, keeping the call. The
+            sequence is only recognized if nothing is sent for the guard time
+            before and after it. Data received meanwhile is discarded.
+        @param [IN] guard_ms The guard time, 1000 ms unless changed with ATS12.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t escapeDataMode(uint32_t guard_ms = 1000) {
+        ModemSerial::Transaction txn(_serial);
+        delay(guard_ms);
+        _serial.write("+++");
+        A76XX_RESPONSE_PROCESS(_serial.waitResponse(guard_ms + 1000))
+    }
+
+    /*
+        @brief Implementation for ATO - EXEC Command.
+        @detail Switch back to data mode after ::escapeDataMode.
+        @param [IN] timeout Time to wait for the module to connect.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t resumeDataMode(uint32_t timeout = 9000) {
+        ModemSerial::Transaction txn(_serial);
+        _serial.sendCMD("ATO");
+        switch(_serial.waitResponse("CONNECT", "NO CARRIER", timeout, false, true)) {
+            case Response_t::A76XX_RESPONSE_MATCH_1ST : {
+                _serial.find('\n');
+                return A76XX_OPERATION_SUCCEEDED;
+            }
+            case Response_t::A76XX_RESPONSE_TIMEOUT : {
+                return A76XX_OPERATION_TIMEDOUT;
+            }
+            default : {
+                return A76XX_GENERIC_ERROR;
+            }
+        }
+    }
+
+    /*
+        @brief Implementation for ATH - EXEC Command.
+        @detail Disconnect the current call, from command mode.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t hangUp() {
+        ModemSerial::Transaction txn(_serial, true);
+        _serial.sendCMD("ATH");
+        A76XX_RESPONSE_PROCESS(_serial.waitResponse(9000))
+    }
+
     /*
         @brief Implementation for ATE - WRITE Command.
         @detail Enable/Disable command echo.
@@ -51,6 +156,7 @@ class V25TERCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t commandEcho(bool enable) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("ATE", enable ? "1" : "0");
         switch(_serial.waitResponse(120000)) {
             case Response_t::A76XX_RESPONSE_OK : {
@@ -72,6 +178,7 @@ class V25TERCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t modelIdentification(char* buf, size_t len) {
+        ModemSerial::Transaction txn(_serial, true);
         // clear stream before sending command, then get rid of the first line
         _serial.clear();
         _serial.sendCMD("AT+CGMM");
@@ -107,6 +214,7 @@ class V25TERCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t revisionIdentification(char* buf, size_t len) {
+        ModemSerial::Transaction txn(_serial, true);
         _serial.sendCMD("AT+CGMR");
         switch (_serial.waitResponse("+CGMR: ", 9000, false, false)) {
             case Response_t::A76XX_RESPONSE_MATCH_1ST : {
@@ -147,6 +255,7 @@ class V25TERCommands {
         @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
     */
     int8_t characterSet(characterSet_t charset = A76XX_CHARSET_IRA) {
+        ModemSerial::Transaction txn(_serial, true);
         const char* charSetStr[] = {
             "IRA",
             "UCS2",
@@ -160,4 +269,6 @@ class V25TERCommands {
 
 };
 
+typedef V25TERCommandsT<> V25TERCommands;
+
 #endif /* A76XX_V25TER_CMDS_H_ */
@@ -0,0 +1,14 @@
+#include "A76XX.h"
+
+Deadline::Deadline(uint32_t budget)
+    : _start(TimeoutCalc::now())
+    , _budget(budget)
+    , _set(true) {}
+
+uint32_t Deadline::remaining() const {
+    if (!_set) {
+        return UINT32_MAX;
+    }
+    uint32_t elapsed = TimeoutCalc::now() - _start;
+    return elapsed < _budget ? _budget - elapsed : 0;
+}
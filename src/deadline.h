@@ -0,0 +1,70 @@
+#ifndef A76XX_DEADLINE_H_
+#define A76XX_DEADLINE_H_
+
+#include "A76XX.h"
+
+/*
+    @brief A time budget for a whole operation, e.g. publishing an MQTT message,
+        which takes several commands, each with its own timeout.
+
+    @details Give it to a ModemSerial::Transaction: every wait of the task holding
+        the transaction, for a response, a line or an asynchronous command, is then
+        cut short so as not to go past the deadline, and times out as usual. The
+        time left is counted from the construction of the object.
+
+        Example:
+
+            {
+                ModemSerial::Transaction txn(serial, Deadline(5000));
+                ...
+            }
+*/
+class Deadline {
+  public:
+    /*
+        @brief No deadline.
+    */
+    Deadline()
+        : _start(0)
+        , _budget(0)
+        , _set(false) {}
+
+    /*
+        @param [IN] budget The time available from now, in milliseconds.
+    */
+    explicit Deadline(uint32_t budget);
+
+    /*
+        @brief Whether there is a deadline.
+    */
+    bool isSet() const {
+        return _set;
+    }
+
+    /*
+        @brief Whether the deadline has passed. Never true without a deadline.
+    */
+    bool expired() const {
+        return _set && remaining() == 0;
+    }
+
+    /*
+        @brief The time left in milliseconds, UINT32_MAX without a deadline.
+    */
+    uint32_t remaining() const;
+
+    /*
+        @brief The smaller of a timeout and the time left.
+    */
+    uint32_t bound(uint32_t timeout) const {
+        uint32_t left = remaining();
+        return timeout < left ? timeout : left;
+    }
+
+  private:
+    uint32_t                            _start;
+    uint32_t                           _budget;
+    bool                                  _set;
+};
+
+#endif /* A76XX_DEADLINE_H_ */
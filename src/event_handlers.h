@@ -1,8 +1,88 @@
 #ifndef A76XX_EVENTHANDLER_H_
 #define A76XX_EVENTHANDLER_H_
 
-// forward declaration
+#include <stdlib.h>
+
+// forward declarations
 class ModemSerial;
+class EventHandlerRegistry;
+
+/*
+    @brief A URC captured from the serial stream, for deferred processing.
+
+    @details The frame holds the rest of the URC line following the match string,
+        without the trailing carriage return, line feed characters, and the data
+        that follows the line, if the handler announced any with
+        EventHandler_t::bodyLength, e.g. the topic of an MQTT message after the line
+        "+CMQTTRXTOPIC: 0,10". The data lives in the URC arena of ModemSerial and is
+        only valid during the call to EventHandler_t::processFrame.
+*/
+class URCFrame_t {
+  public:
+    // the rest of the URC line, null terminated
+    const char*        line;
+    size_t         line_len;
+    // the data following the line
+    const uint8_t*     body;
+    size_t         body_len;
+    // whether part of the line or of the body did not fit in the arena and was dropped
+    bool          truncated;
+
+    URCFrame_t(const char* _line, size_t _line_len,
+               const uint8_t* _body, size_t _body_len, bool _truncated)
+        : line(_line)
+        , line_len(_line_len)
+        , body(_body)
+        , body_len(_body_len)
+        , truncated(_truncated)
+        , _pos(0) {}
+
+    /*
+        @brief Whether the line starts with the given string.
+    */
+    bool startsWith(const char* prefix) const {
+        return strncmp(line, prefix, strlen(prefix)) == 0;
+    }
+
+    /*
+        @brief Split the line into fields.
+    */
+    LineTokenizer fields() const {
+        return LineTokenizer(line, line_len);
+    }
+
+    /*
+        @brief Move past the next occurrence of a character in the line.
+
+        @return False, and move to the end of the line, if the character is not found.
+    */
+    bool find(char terminator) {
+        while (_pos < line_len) {
+            if (line[_pos++] == terminator) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+        @brief Parse the next integer in the line, skipping any character before it.
+
+        @return The integer, or 0 if there is none.
+    */
+    long parseInt() {
+        while (_pos < line_len && !(line[_pos] >= '0' && line[_pos] <= '9') && line[_pos] != '-') {
+            _pos++;
+        }
+        char* end;
+        long val = strtol(line + _pos, &end, 10);
+        _pos = end - line;
+        return val;
+    }
+
+  private:
+    size_t _pos;
+};
 
 /*
     @brief Base class for URC event handlers.
@@ -15,38 +95,294 @@ class ModemSerial;
         as they occur, to avoid them being lost in the output of 
         other AT commands that might be issued to the module by the user.
 
-        An EventHandler_t object is composed of a match string, a corresponding
-        element of the enum A76XXURC_t, i.e. an URC code, and a processing function.
+        An EventHandler_t object is composed of a match string and a processing
+        function. When communicating with the module, the output of the serial
+        connection is monitored for the match strings of all registered handlers.
+        URCs are emitted on their own lines, so match strings are only looked for
+        at the start of a line, e.g. "+CMTI: ", never in the middle of a response
+        or of data such as an MQTT payload.
 
-        When communicating with the module, the output of the serial connection
-        is monitored. When the match string of any of the active event handler is 
-        found in the data stream the processing function is executed. This can be 
-        useful to further information about some URCs that also contain additional
-        characters, e.g. the payload of a MQTT message. Then the URC code of the 
-        event is pushed to a queue for later processing. This queue can be accessed
-        by calling A76XX::listen and events can be processed by the user's application.
+        Deferred handlers are processed in two stages. When the match string is
+        found, the rest of the line, and the data following it if ::bodyLength
+        says so, are copied into a frame, as they arrive, without blocking and
+        without disturbing the command in flight. Frames are then passed to
+        ::processFrame once the current command has completed, i.e. at the end of
+        its ModemSerial::Transaction, or when calling A76XX::listen, or by the RX
+        task of ModemSerialESP. Handlers are then free to issue commands themselves.
+
+        Other handlers are executed straight away, in the middle of the response
+        being parsed, by calling ::process, which must read the rest of the URC
+        from the serial object itself.
 */
 class EventHandler_t {
+  friend class EventHandlerRegistry;
+
   public:
     /*
         The URC string produced by the module that we attempt to match.
     */
     const char* match_string;
+
+    /*
+        Whether the URC is captured and processed later by ::processFrame, rather
+        than straight away by ::process.
+    */
+    const bool deferred;
     
     /*
         Construct from a match string.
     */
-    EventHandler_t(const char* _match_string)
-        : match_string(_match_string) {}
+    EventHandler_t(const char* _match_string, bool _deferred = false)
+        : match_string(_match_string)
+        , deferred(_deferred)
+        , _registry(NULL)
+        , _next(NULL) {}
     
     /*
         Function to be executed as soon as the match string is found in the 
         stream of characters from the serial connection. Can be a no-op if no
-        immediate action is required.
+        immediate action is required. Only used if the handler is not deferred.
     */
-    virtual void process(ModemSerial* serial) = 0;
+    virtual void process(ModemSerial* serial) {}
+
+    /*
+        Number of bytes of data following the URC line, which must be captured in the
+        same frame. Called by deferred handlers once the line has been received.
+    */
+    virtual size_t bodyLength(URCFrame_t& frame) { return 0; }
+
+    /*
+        Whether the data announced by ::bodyLength is passed to ::bodyChunk as it is
+        received, instead of being captured in the frame, so that its length is not
+        limited by the URC arena. The frame then only holds the line. Called once
+        the line has been received, when ::bodyLength is not zero.
+    */
+    virtual bool streamsBody(URCFrame_t& frame) { return false; }
+
+    /*
+        Function executed on the data following a URC line, in consecutive chunks as
+        they are received, if ::streamsBody says so. It runs in the middle of the
+        command in flight, so it must neither block nor issue commands.
+    */
+    virtual void bodyChunk(const uint8_t* data, size_t len) {}
+
+    /*
+        Function executed on a captured URC, once the command in flight, if any,
+        has completed. Only used if the handler is deferred.
+    */
+    virtual void processFrame(URCFrame_t& frame) {}
 
     virtual ~EventHandler_t() {}
+
+  private:
+    // the registry the handler belongs to, if any, and the next handler in its bucket
+    EventHandlerRegistry*   _registry;
+    EventHandler_t*             _next;
+};
+
+/*
+    @brief The set of registered event handlers, indexed by the first characters
+        of their match string.
+
+    @details Handlers are kept in A76XX_EVENT_HANDLER_BUCKETS linked lists, selected
+        by the first character of the match string or, if that is a '+' or a '$' as
+        for most URCs and NMEA sentences, by the second one. The links are stored
+        in the handlers themselves, so there is no limit on their number and adding
+        one takes constant time.
+
+        The registry is fed the bytes received from the module. At the start of a
+        line, the first bytes select a bucket, then the handlers of the bucket
+        sharing the bytes received so far are followed, one byte at a time, until
+        a match string is complete or none is left, in which case the rest of the
+        line is ignored. The cost per byte does not depend on the number of handlers.
+        Within a bucket, handlers are sorted by the length of their match string,
+        so that when one is a prefix of another, the shorter one is found.
+*/
+class EventHandlerRegistry {
+  public:
+    EventHandlerRegistry()
+        : _unsorted(0) {
+        for (uint16_t i = 0; i < A76XX_EVENT_HANDLER_BUCKETS; i++) {
+            _buckets[i] = NULL;
+        }
+        lineStart();
+    }
+
+    /*
+        @brief Add a handler.
+
+        @return False if the handler is already registered, here or elsewhere, or
+            if its match string is empty or just "+" or "$": lines are told apart
+            by the character after these.
+    */
+    bool add(EventHandler_t* handler) {
+        const char* match_string = handler->match_string;
+        if (handler->_registry != NULL || match_string[0] == '\0'
+                || ((match_string[0] == '+' || match_string[0] == '$') && match_string[1] == '\0')) {
+            return false;
+        }
+        uint16_t b = bucket(handler->match_string);
+        handler->_next = _buckets[b];
+        handler->_registry = this;
+        _buckets[b] = handler;
+        // sorted when the bucket is next looked up
+        _unsorted |= 1UL << b;
+        return true;
+    }
+
+    /*
+        @brief Remove a handler.
+
+        @return False if the handler is not registered here.
+    */
+    bool remove(EventHandler_t* handler) {
+        if (handler->_registry != this) {
+            return false;
+        }
+        EventHandler_t** link = &_buckets[bucket(handler->match_string)];
+        while (*link != handler) {
+            link = &(*link)->_next;
+        }
+        *link = handler->_next;
+        handler->_next = NULL;
+        handler->_registry = NULL;
+        if (_candidate == handler) {
+            _candidate = NULL;
+            _active = false;
+        }
+        return true;
+    }
+
+    bool contains(EventHandler_t* handler) {
+        return handler->_registry == this;
+    }
+
+    /*
+        @brief Start matching from the beginning of a line with the next byte.
+    */
+    void lineStart() {
+        _pos = 0;
+        _active = true;
+        _candidate = NULL;
+    }
+
+    /*
+        @brief Advance the match by one byte received from the module.
+
+        @param [IN] c The byte.
+        @return The handler whose match string the current line starts with, when
+            its last character is received, or NULL.
+    */
+    EventHandler_t* feed(uint8_t c) {
+        if (c == '\n') {
+            lineStart();
+            return NULL;
+        }
+        if (!_active) {
+            return NULL;
+        }
+
+        if (_candidate == NULL) {
+            // select the bucket with the first byte, or the second after '+' or '$'
+            if (_pos == 0) {
+                _first = c;
+                if (c == '+' || c == '$') {
+                    _pos = 1;
+                    return NULL;
+                }
+            }
+            _candidate = lookup(c);
+        } else {
+            while (_candidate != NULL && (uint8_t) _candidate->match_string[_pos] != c) {
+                _candidate = nextCandidate(_candidate);
+            }
+        }
+
+        if (_candidate == NULL) {
+            _active = false;
+            return NULL;
+        }
+        _pos++;
+        if (_candidate->match_string[_pos] == '\0') {
+            _active = false;
+            return _candidate;
+        }
+        return NULL;
+    }
+
+  private:
+    static_assert(A76XX_EVENT_HANDLER_BUCKETS >= 1 &&
+                  (A76XX_EVENT_HANDLER_BUCKETS & (A76XX_EVENT_HANDLER_BUCKETS - 1)) == 0,
+                  "A76XX_EVENT_HANDLER_BUCKETS must be a power of two");
+    // one bit of _unsorted per bucket
+    static_assert(A76XX_EVENT_HANDLER_BUCKETS <= 32,
+                  "A76XX_EVENT_HANDLER_BUCKETS must be at most 32");
+
+    EventHandler_t*     _buckets[A76XX_EVENT_HANDLER_BUCKETS];
+    uint32_t                                        _unsorted;
+
+    // state of the match on the current line
+    size_t                                               _pos;
+    uint8_t                                            _first;
+    bool                                              _active;
+    EventHandler_t*                                _candidate;
+
+    static uint16_t bucket(const char* match_string) {
+        uint8_t key = match_string[0];
+        if (key == '+' || key == '$') {
+            key = match_string[1];
+        }
+        return key & (A76XX_EVENT_HANDLER_BUCKETS - 1);
+    }
+
+    /*
+        @brief The first handler matching the first byte(s) of the line, the last
+            of which is `c`.
+    */
+    EventHandler_t* lookup(uint8_t c) {
+        uint16_t b = c & (A76XX_EVENT_HANDLER_BUCKETS - 1);
+        if (_unsorted & (1UL << b)) {
+            sortBucket(b);
+        }
+        for (EventHandler_t* h = _buckets[b]; h != NULL; h = h->_next) {
+            if ((uint8_t) h->match_string[0] == _first && (_pos == 0 || (uint8_t) h->match_string[1] == c)) {
+                return h;
+            }
+        }
+        return NULL;
+    }
+
+    /*
+        @brief The next handler in the bucket whose match string starts with the
+            same _pos characters as the given one, i.e. with the line so far.
+    */
+    EventHandler_t* nextCandidate(EventHandler_t* h) {
+        for (EventHandler_t* n = h->_next; n != NULL; n = n->_next) {
+            if (strncmp(n->match_string, h->match_string, _pos) == 0) {
+                return n;
+            }
+        }
+        return NULL;
+    }
+
+    // stable insertion sort by length of the match string
+    void sortBucket(uint16_t b) {
+        EventHandler_t* sorted = NULL;
+        EventHandler_t* h = _buckets[b];
+        while (h != NULL) {
+            EventHandler_t* next = h->_next;
+            size_t len = strlen(h->match_string);
+            EventHandler_t** link = &sorted;
+            while (*link != NULL && strlen((*link)->match_string) <= len) {
+                link = &(*link)->_next;
+            }
+            h->_next = *link;
+            *link = h;
+            h = next;
+        }
+        _buckets[b] = sorted;
+        _unsorted &= ~(1UL << b);
+    }
 };
 
 #endif /* A76XX_EVENTHANDLER_H_ */
@@ -0,0 +1,205 @@
+#include "A76XX.h"
+
+#if A76XX_ENABLE_METRICS
+
+#include <stdarg.h>
+
+CommandMetrics_t* ModemMetrics::command(const char* cmd) {
+    // the verb ends before the parameters, or the end of the line
+    size_t len = strcspn(cmd, "=?\r\n");
+    if (len > A76XX_METRICS_VERB_LEN - 1) {
+        len = A76XX_METRICS_VERB_LEN - 1;
+    }
+    for (uint8_t i = 0; i < A76XX_METRICS_COMMANDS - 1; i++) {
+        CommandMetrics_t& entry = commands[i];
+        if (entry.verb[0] == '\0') {
+            memcpy(entry.verb, cmd, len);
+            entry.verb[len] = '\0';
+            return &entry;
+        }
+        if (strncmp(entry.verb, cmd, len) == 0 && entry.verb[len] == '\0') {
+            return &entry;
+        }
+    }
+    CommandMetrics_t& other = commands[A76XX_METRICS_COMMANDS - 1];
+    other.verb[0] = '*';
+    return &other;
+}
+
+void ModemMetrics::countEvent(const EventHandler_t* handler) {
+    for (uint8_t i = 0; i < A76XX_METRICS_HANDLERS - 1; i++) {
+        HandlerMetrics_t& entry = handlers[i];
+        if (entry.handler == NULL) {
+            entry.handler = handler;
+            entry.match_string = handler->match_string;
+        }
+        if (entry.handler == handler) {
+            entry.count++;
+            return;
+        }
+    }
+    HandlerMetrics_t& other = handlers[A76XX_METRICS_HANDLERS - 1];
+    other.match_string = "*";
+    other.count++;
+}
+
+void ModemMetrics::record(uint32_t* histogram, uint32_t ms) {
+    uint8_t bucket = 0;
+    while (ms > 0 && bucket < A76XX_METRICS_BUCKETS - 1) {
+        ms >>= 1;
+        bucket++;
+    }
+    histogram[bucket]++;
+}
+
+void ModemMetrics::learn(WaitLatency_t& latency, uint32_t ms) {
+    if (latency.samples == 0) {
+        latency.srtt_ms = ms;
+        latency.rttvar_ms = ms / 2;
+    } else {
+        uint32_t dev = ms > latency.srtt_ms ? ms - latency.srtt_ms : latency.srtt_ms - ms;
+        latency.rttvar_ms = (3 * latency.rttvar_ms + dev) / 4;
+        latency.srtt_ms = (7 * latency.srtt_ms + ms) / 8;
+    }
+    if (latency.samples < UINT16_MAX) {
+        latency.samples++;
+    }
+    latency.backoff = 0;
+}
+
+uint32_t ModemMetrics::adaptiveTimeout(const WaitLatency_t& latency) {
+    if (latency.samples < A76XX_ADAPTIVE_MIN_SAMPLES) {
+        return 0;
+    }
+    uint32_t timeout = latency.srtt_ms + 4 * latency.rttvar_ms;
+    if (timeout < A76XX_ADAPTIVE_TIMEOUT_MIN) {
+        timeout = A76XX_ADAPTIVE_TIMEOUT_MIN;
+    }
+    return timeout << latency.backoff;
+}
+
+// append formatted text, keeping track of the length even if it does not fit
+static void appendf(char* buf, size_t size, size_t& len, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int ret = vsnprintf(len < size ? buf + len : NULL, len < size ? size - len : 0, fmt, args);
+    va_end(args);
+    if (ret > 0) {
+        len += ret;
+    }
+}
+
+static void appendHistogram(char* buf, size_t size, size_t& len, const char* name, const uint32_t* histogram) {
+    appendf(buf, size, len, " %s=", name);
+    for (uint8_t i = 0; i < A76XX_METRICS_BUCKETS; i++) {
+        appendf(buf, size, len, i == 0 ? "%lu" : ",%lu", (unsigned long) histogram[i]);
+    }
+}
+
+size_t ModemMetrics::print(char* buf, size_t size) const {
+    size_t len = 0;
+    if (size > 0) {
+        buf[0] = '\0';
+    }
+    appendf(buf, size, len, "tx=%lu rx=%lu rx_ovf=%lu urc_drop=%lu urc_trunc=%lu\n",
+            (unsigned long) tx_bytes, (unsigned long) rx_bytes, (unsigned long) rx_overflows,
+            (unsigned long) urcs_dropped, (unsigned long) urcs_truncated);
+    for (uint8_t i = 0; i < A76XX_METRICS_COMMANDS; i++) {
+        const CommandMetrics_t& entry = commands[i];
+        if (entry.count == 0) {
+            continue;
+        }
+        appendf(buf, size, len, "%s n=%lu to=%lu err=%lu max=%lu", entry.verb,
+                (unsigned long) entry.count, (unsigned long) entry.timeouts,
+                (unsigned long) entry.errors, (unsigned long) entry.max_final_ms);
+        appendHistogram(buf, size, len, "fb", entry.first_byte);
+        appendHistogram(buf, size, len, "fr", entry.final_result);
+        appendf(buf, size, len, "\n");
+    }
+    for (uint8_t i = 0; i < A76XX_METRICS_HANDLERS; i++) {
+        const HandlerMetrics_t& entry = handlers[i];
+        if (entry.count == 0) {
+            continue;
+        }
+        // match strings often end with a space or a line feed
+        size_t match_len = strcspn(entry.match_string, " \r\n");
+        appendf(buf, size, len, "%.*s urcs=%lu\n", (int) match_len, entry.match_string,
+                (unsigned long) entry.count);
+    }
+    return len < size ? len : (size > 0 ? size - 1 : 0);
+}
+
+void ModemSerial::metricsCommand(const char* cmd) {
+    if (cmd[0] != 'A' || cmd[1] != 'T') {
+        return;
+    }
+    _metrics_cmd = _metrics.command(cmd);
+    _metrics_cmd->count++;
+    _metrics_sent_ms = TimeoutCalc::now();
+    _metrics_first_byte = true;
+    _adapt_cmd = _metrics_cmd;
+    _adapt_wait = 0;
+    _adapt_latency = NULL;
+}
+
+void ModemSerial::metricsFirstByte() {
+    _metrics_first_byte = false;
+    if (_metrics_cmd != NULL) {
+        ModemMetrics::record(_metrics_cmd->first_byte, TimeoutCalc::now() - _metrics_sent_ms);
+    }
+}
+
+void ModemSerial::metricsResult(Response_t rsp) {
+    if (_metrics_cmd == NULL) {
+        return;
+    }
+    if (rsp == Response_t::A76XX_RESPONSE_TIMEOUT) {
+        _metrics_cmd->timeouts++;
+    } else {
+        uint32_t elapsed = TimeoutCalc::now() - _metrics_sent_ms;
+        ModemMetrics::record(_metrics_cmd->final_result, elapsed);
+        if (elapsed > _metrics_cmd->max_final_ms) {
+            _metrics_cmd->max_final_ms = elapsed;
+        }
+        if (rsp == Response_t::A76XX_RESPONSE_ERROR) {
+            _metrics_cmd->errors++;
+        }
+    }
+    _metrics_cmd = NULL;
+    _metrics_first_byte = false;
+}
+
+uint32_t ModemSerial::metricsWaitStart(uint32_t timeout, const char* const* match_strings) {
+    // listening for URCs, e.g. from another task, is not a wait of the command
+    bool response = false;
+    for (uint8_t i = 0; i < 4; i++) {
+        response |= match_strings[i] != NULL;
+    }
+    if (!response || _txn_depth == 0 || _adapt_cmd == NULL || _adapt_wait >= A76XX_ADAPTIVE_WAITS) {
+        return timeout;
+    }
+    _adapt_latency = &_adapt_cmd->waits[_adapt_wait++];
+    _adapt_start_ms = TimeoutCalc::now();
+    if (_adaptive) {
+        uint32_t adapted = ModemMetrics::adaptiveTimeout(*_adapt_latency);
+        if (adapted > 0 && adapted < timeout) {
+            return adapted;
+        }
+    }
+    return timeout;
+}
+
+void ModemSerial::metricsWaitEnd(bool matched) {
+    WaitLatency_t* latency = _adapt_latency;
+    if (latency == NULL) {
+        return;
+    }
+    _adapt_latency = NULL;
+    if (matched) {
+        ModemMetrics::learn(*latency, TimeoutCalc::now() - _adapt_start_ms);
+    } else if (latency->backoff < A76XX_ADAPTIVE_MAX_BACKOFF) {
+        latency->backoff++;
+    }
+}
+
+#endif /* A76XX_ENABLE_METRICS */
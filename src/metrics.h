@@ -0,0 +1,125 @@
+#ifndef A76XX_METRICS_H_
+#define A76XX_METRICS_H_
+
+#include "A76XX.h"
+
+#if A76XX_ENABLE_METRICS
+
+/*
+    @brief Latency of one of the waits following a command, e.g. for the prompt,
+        then for the final result, see ModemSerial::setAdaptiveTimeouts.
+*/
+struct WaitLatency_t {
+    // smoothed latency and mean deviation, as for TCP retransmissions
+    uint32_t                              srtt_ms;
+    uint32_t                            rttvar_ms;
+    uint16_t                              samples;
+    // doublings of the timeout after consecutive timeouts
+    uint8_t                               backoff;
+};
+
+/*
+    @brief Latencies and outcomes of the commands sharing a verb, e.g. "AT+CMQTTPUB".
+
+    @details Latencies are counted in A76XX_METRICS_BUCKETS buckets of powers of two
+        milliseconds: bucket 0 counts latencies under 1 ms, bucket i those from
+        2^(i-1) to 2^i ms, and the last bucket all longer ones.
+*/
+struct CommandMetrics_t {
+    char             verb[A76XX_METRICS_VERB_LEN];
+    uint32_t                                count;
+    uint32_t                             timeouts;
+    uint32_t                               errors;
+    // from sending the command to the first byte received
+    uint32_t        first_byte[A76XX_METRICS_BUCKETS];
+    // from sending the command to OK or ERROR
+    uint32_t      final_result[A76XX_METRICS_BUCKETS];
+    uint32_t                         max_final_ms;
+    WaitLatency_t       waits[A76XX_ADAPTIVE_WAITS];
+};
+
+/*
+    @brief Number of URCs processed by an event handler.
+*/
+struct HandlerMetrics_t {
+    const char*                      match_string;
+    const EventHandler_t*                 handler;
+    uint32_t                                count;
+};
+
+/*
+    @brief Counters of the traffic on a serial object, see ModemSerial::metrics.
+
+    @details Commands are told apart by their verb, the text sent up to the first
+        '=' or '?'. The first A76XX_METRICS_COMMANDS - 1 verbs seen have their own
+        entry, the others share the last one, whose verb is "*". Likewise for event
+        handlers, beyond A76XX_METRICS_HANDLERS - 1.
+
+        Counting takes a few operations per command, URC and chunk of data
+        received, and nothing when A76XX_ENABLE_METRICS is 0, the default.
+*/
+class ModemMetrics {
+  public:
+    uint32_t                                               tx_bytes;
+    uint32_t                                               rx_bytes;
+    // URCs dropped, or truncated, because the URC arena was full
+    uint32_t                                          urcs_dropped;
+    uint32_t                                        urcs_truncated;
+    // bytes lost by the receive buffer of the backend, set by ModemSerial::metrics
+    uint32_t                                          rx_overflows;
+    CommandMetrics_t                commands[A76XX_METRICS_COMMANDS];
+    HandlerMetrics_t                handlers[A76XX_METRICS_HANDLERS];
+
+    ModemMetrics() {
+        reset();
+    }
+
+    void reset() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    /*
+        @brief The entry of a verb, created if needed.
+
+        @param [IN] cmd The command as sent, e.g. "AT+CSQ" or "AT+CMQTTPUB=0,1,60".
+    */
+    CommandMetrics_t* command(const char* cmd);
+
+    /*
+        @brief Count a URC processed by a handler.
+    */
+    void countEvent(const EventHandler_t* handler);
+
+    /*
+        @brief Add a latency to a histogram.
+    */
+    static void record(uint32_t* histogram, uint32_t ms);
+
+    /*
+        @brief Learn the latency of a wait.
+    */
+    static void learn(WaitLatency_t& latency, uint32_t ms);
+
+    /*
+        @brief The timeout warranted by the latencies learnt for a wait, 0 if too
+            few have been seen.
+    */
+    static uint32_t adaptiveTimeout(const WaitLatency_t& latency);
+
+    /*
+        @brief Write the counters as text, e.g. to publish them.
+
+        @detail The first line holds the traffic counters, then each verb has a line
+            "<verb> n=<count> to=<timeouts> err=<errors> max=<ms> fb=<buckets> fr=<buckets>",
+            with the buckets of the first byte and final result histograms separated
+            by commas, and each handler a line "<match string> urcs=<count>".
+        @param [OUT] buf The destination buffer, null terminated.
+        @param [IN] size The size of the buffer.
+        @return The length of the text, which is truncated if it does not fit.
+    */
+    size_t print(char* buf, size_t size) const;
+};
+
+#endif /* A76XX_ENABLE_METRICS */
+
+#endif /* A76XX_METRICS_H_ */
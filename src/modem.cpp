@@ -171,9 +171,12 @@ bool A76XX::restart(uint32_t timeout) {
 bool A76XX::waitATUnresponsive(uint32_t timeout) {
     TimeoutCalc tc(timeout);
     while (!tc.expired()) {
-        serial.sendCMD("AT");
-        if (serial.waitResponse(1000) == Response_t::A76XX_RESPONSE_TIMEOUT) {
-            return true;
+        {
+            ModemSerial::Transaction txn(serial, true);
+            serial.sendCMD("AT");
+            if (serial.waitResponse(1000) == Response_t::A76XX_RESPONSE_TIMEOUT) {
+                return true;
+            }
         }
         delay(100);
     }
@@ -183,15 +186,125 @@ bool A76XX::waitATUnresponsive(uint32_t timeout) {
 bool A76XX::waitATResponsive(uint32_t timeout) {
     TimeoutCalc tc(timeout);
     while (!tc.expired()) {
+        {
+            ModemSerial::Transaction txn(serial, true);
+            serial.sendCMD("AT");
+            if (serial.waitResponse(1000) == Response_t::A76XX_RESPONSE_OK) {
+                return true;
+            }
+        }
+        delay(100);
+    }
+    return false;
+}
+
+uint32_t A76XX::negotiateBaudRate(uint32_t max_baud, bool flow_control, bool persist) {
+    // rates supported by AT+IPR, from the highest
+    static const uint32_t rates[] = {3686400, 3200000, 3000000, 921600, 460800, 230400, 115200};
+
+    // nobody else may send while the rates of the two sides differ
+    ModemSerial::Transaction txn(serial);
+
+    uint32_t baud = serial.getBaudRate();
+    if (baud == 0) {
+        _last_error_code = serialInterface.getBaudRate(baud);
+        if (_last_error_code != A76XX_OPERATION_SUCCEEDED) return 0;
+        // the module detects the rate, the host must know it
+        if (baud == 0) {
+            _last_error_code = A76XX_GENERIC_ERROR;
+            return 0;
+        }
+    }
+
+    if (flow_control) {
+        _last_error_code = serialInterface.setFlowControl(2, 2);
+        if (_last_error_code == A76XX_OPERATION_SUCCEEDED && !serial.setHardwareFlowControl(true)) {
+            serialInterface.setFlowControl(0, 0);
+        } else if (_last_error_code == A76XX_OPERATION_SUCCEEDED && !probeAT()) {
+            // the lines are not wired, the module cannot be stopped in this state
+            serial.setHardwareFlowControl(false);
+            serial.sendCMD("AT+IFC=0,0");
+            serial.flush();
+            if (!probeAT()) {
+                _last_error_code = A76XX_OPERATION_TIMEDOUT;
+                return 0;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        if (rates[i] > max_baud) continue;
+        if (rates[i] <= baud) break;
+
+        // try the rate on the host first, not to lose the module for nothing
+        if (!serial.setBaudRate(rates[i])) continue;
+        if (!serial.setBaudRate(baud)) {
+            _last_error_code = A76XX_GENERIC_ERROR;
+            return 0;
+        }
+
+        if (switchBaudRate(baud, rates[i])) {
+            baud = rates[i];
+            break;
+        }
+        if (!probeAT()) {
+            // the module is at neither rate
+            baud = detectBaudRate();
+            if (baud == 0) {
+                _last_error_code = A76XX_OPERATION_TIMEDOUT;
+                return 0;
+            }
+        }
+    }
+
+    _last_error_code = A76XX_OPERATION_SUCCEEDED;
+    if (persist) {
+        _last_error_code = serialInterface.setBaudRatePermanent(baud);
+    }
+    return baud;
+}
+
+uint32_t A76XX::detectBaudRate() {
+    // the most likely rates first
+    static const uint32_t rates[] = {115200, 3686400, 921600, 460800, 230400, 3200000,
+                                     3000000, 57600, 38400, 19200, 9600};
+
+    ModemSerial::Transaction txn(serial);
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        if (serial.setBaudRate(rates[i]) && probeAT()) {
+            return rates[i];
+        }
+    }
+    return 0;
+}
+
+bool A76XX::probeAT() {
+    ModemSerial::Transaction txn(serial, true);
+    for (uint8_t i = 0; i < A76XX_BAUD_PROBE_ATTEMPTS; i++) {
         serial.sendCMD("AT");
-        if (serial.waitResponse(1000) == Response_t::A76XX_RESPONSE_OK) {
+        if (serial.waitResponse(A76XX_BAUD_PROBE_TIMEOUT) == Response_t::A76XX_RESPONSE_OK) {
             return true;
         }
-        delay(100);
     }
     return false;
 }
 
+bool A76XX::switchBaudRate(uint32_t from, uint32_t to) {
+    // the module answers at the current rate, then switches
+    if (serialInterface.setBaudRate(to) != A76XX_OPERATION_SUCCEEDED) {
+        return false;
+    }
+    if (serial.setBaudRate(to) && probeAT()) {
+        return true;
+    }
+    // the module is likely at the new rate but the line cannot carry it: ask it
+    // to go back, without waiting for an answer that cannot be read
+    serial.sendCMD("AT+IPR=", from);
+    serial.flush();
+    serial.setBaudRate(from);
+    return false;
+}
+
 bool A76XX::sleep() {
     int8_t retcode = serialInterface.UARTSleep(2);
     A76XX_CLIENT_RETCODE_ASSERT_BOOL(retcode);
@@ -199,6 +312,7 @@ bool A76XX::sleep() {
 }
 
 bool A76XX::wakeUp() {
+    ModemSerial::Transaction txn(serial, true);
     serial.sendCMD("AT");
     return serial.waitResponse() == Response_t::A76XX_RESPONSE_OK;
 }
@@ -179,6 +179,39 @@ class A76XX {
     */
     bool waitATResponsive(uint32_t timeout = 30000);
 
+    /*
+        @brief Raise the baud rate of the link to the highest one supported by both
+            the module and the host, optionally with RTS/CTS flow control.
+
+        @detail Each rate above the current one, from the highest, is first tried
+            on the host, then set with AT+IPR and checked with AT. If the module
+            does not answer at the new rate, it is asked to go back to the previous
+            one and the next rate is tried. If the link is lost nonetheless, the rate
+            of the module is looked for with ::detectBaudRate. The serial backend must
+            be able to change its rate, see ModemSerial::setBaudRate.
+
+        @param [IN] max_baud Do not go above this rate. The module supports up to 3686400.
+        @param [IN] flow_control Whether to enable RTS/CTS flow control on both sides,
+            which is needed above 115200 to avoid losing data. It is left disabled
+            if the host cannot enable it, or if the module stops answering.
+        @param [IN] persist Whether to save the rate with AT+IPREX, so that the module
+            starts at this rate after a reboot.
+        @return The rate of the link, or 0 if communication with the module has been lost.
+    */
+    uint32_t negotiateBaudRate(uint32_t max_baud = 3686400,
+                               bool flow_control = true,
+                               bool persist = false);
+
+    /*
+        @brief Find the baud rate of the module, by trying each rate on the host
+            until the module answers to AT, e.g. after a reboot with a rate saved
+            with AT+IPREX.
+
+        @return The rate found, which the host is left at, or 0 if the module does
+            not answer at any rate.
+    */
+    uint32_t detectBaudRate();
+
     /*
         @brief Set the device to sleep.
 
@@ -267,6 +300,13 @@ class A76XX {
         @param [IN] timeout Wait up to this time in ms before returning.
     */
     void listen(uint32_t timeout = 100);
+
+  private:
+    // send AT up to A76XX_BAUD_PROBE_ATTEMPTS times, true on the first OK
+    bool probeAT();
+
+    // switch both sides to a new rate and check it, going back to `from` on failure
+    bool switchBaudRate(uint32_t from, uint32_t to);
 };
 
 #endif /* A76XXMODEM_H_ */
@@ -3,13 +3,630 @@
 
 #include "A76XX.h"
 
+// forward declarations
+class AsyncCommand_t;
+
+template <typename SERIAL>
+int readLineFrom(SERIAL& serial, char* buf, size_t size, uint32_t timeout);
+
 class ModemSerial {
+  friend class AsyncCommand_t;
+
   protected:
-    EventHandler_t*              _event_handlers[A76XX_MAX_EVENT_HANDLERS];
-    uint8_t                                            _num_event_handlers;
+    EventHandlerRegistry                                         _handlers;
+    MultiMatcher                                                  _matcher;
+    const char*                                            _compiled_for[5];
+    bool                                                  _compiled_valid;
+    AsyncCommand_t*                                             _cmd_head;
+    AsyncCommand_t*                                             _cmd_tail;
+    ChannelLock                                                   _channel;
+    uint16_t                                                    _txn_depth;
+
+    // URC arena: frames ready to be processed lie between _urc_head and
+    // _urc_tail, the frame being captured between _urc_tail and _urc_fill
+    uint8_t                               _urc_arena[A76XX_URC_ARENA_SIZE];
+    size_t                                                       _urc_head;
+    size_t                                                       _urc_tail;
+    size_t                                                       _urc_fill;
+    EventHandler_t*                                           _urc_handler;
+    size_t                                                   _urc_line_len;
+    size_t                                                   _urc_body_len;
+    size_t                                                  _urc_body_left;
+    bool                                                    _urc_capturing;
+    bool                                                      _urc_in_body;
+    // whether the body is passed to the handler rather than captured
+    bool                                                    _urc_streaming;
+    bool                                                    _urc_truncated;
+    bool                                                      _urc_dropped;
+    bool                                                  _urc_dispatching;
+    SerialCapture*                                                _capture;
+    // the deadline of the transaction in progress, if any
+    const Deadline*                                              _deadline;
+
+#if A76XX_ENABLE_METRICS
+    ModemMetrics                                                  _metrics;
+    // the entry of the command waiting for its final result, if any
+    CommandMetrics_t*                                         _metrics_cmd;
+    uint32_t                                              _metrics_sent_ms;
+    bool                                            _metrics_first_byte;
+    // the entry of the last command sent in this transaction, the index of its
+    // next wait and the latency of the wait in progress, if any
+    CommandMetrics_t*                                          _adapt_cmd;
+    uint8_t                                                   _adapt_wait;
+    WaitLatency_t*                                         _adapt_latency;
+    uint32_t                                             _adapt_start_ms;
+    bool                                                        _adaptive;
+
+    // count a command being sent, e.g. "AT+CSQ", other data is ignored
+    void metricsCommand(const char* cmd);
+    // count the OK, ERROR or timeout ending the command in flight
+    void metricsResult(Response_t rsp);
+    void metricsFirstByte();
+    // learn the latency of the waits following a command, see ::setAdaptiveTimeouts
+    uint32_t metricsWaitStart(uint32_t timeout, const char* const* match_strings);
+    void metricsWaitEnd(bool matched);
+
+    void metricsEndTransaction() {
+        _adapt_cmd = NULL;
+        _adapt_latency = NULL;
+    }
+
+    void metricsEvent(EventHandler_t* handler) {
+        _metrics.countEvent(handler);
+    }
+
+    void metricsRx(size_t len) {
+        _metrics.rx_bytes += len;
+        if (_metrics_first_byte) {
+            metricsFirstByte();
+        }
+    }
+
+    void metricsTx(size_t len) {
+        _metrics.tx_bytes += len;
+    }
+#else
+    void metricsCommand(const char*) {}
+    void metricsResult(Response_t) {}
+    void metricsEvent(EventHandler_t*) {}
+    void metricsRx(size_t) {}
+    void metricsTx(size_t) {}
+    uint32_t metricsWaitStart(uint32_t timeout, const char* const*) {
+        return timeout;
+    }
+    void metricsWaitEnd(bool) {}
+    void metricsEndTransaction() {}
+#endif
+
+    // data received, called by the backends as they stage it
+    void traceRx(const uint8_t* data, size_t len) {
+        metricsRx(len);
+        if (_capture != NULL) {
+            _capture->record(false, data, len);
+        }
+    }
+
+    // data sent, called by the backends
+    void traceTx(const uint8_t* data, size_t len) {
+        metricsTx(len);
+        if (_capture != NULL) {
+            _capture->record(true, data, len);
+        }
+    }
+
+    // only strings can start a command
+    template <typename T>
+    void metricsCommand(T) {}
+
+    template <typename HEAD, typename... TAIL>
+    void metricsCommandItems(HEAD head, TAIL...) {
+        metricsCommand(head);
+    }
+
+    /*
+        @brief Returned by the backends when waitResponse times out.
+    */
+    Response_t timeoutResponse() {
+        metricsWaitEnd(false);
+        metricsResult(Response_t::A76XX_RESPONSE_TIMEOUT);
+        return Response_t::A76XX_RESPONSE_TIMEOUT;
+    }
+
+    // stored in the arena before the line of each frame
+    struct URCFrameHeader {
+        EventHandler_t*   handler;
+        uint16_t         line_len;
+        uint16_t         body_len;
+        bool            truncated;
+    };
+
+    /*
+        @brief The timeout of a wait for the strings given, called by the backends
+            as waitResponse starts: adapted to the latency of the command if enabled,
+            then bounded by the deadline of the transaction.
+    */
+    uint32_t waitTimeout(uint32_t timeout, const char* const* match_strings) {
+        return boundTimeout(metricsWaitStart(timeout, match_strings));
+    }
+
+    /*
+        @brief Compile the strings waited for by waitResponse into the matcher.
+
+        @param [IN] match_strings The three user strings, then the OK and ERROR
+            strings, in order of precedence. NULL entries are skipped.
+    */
+    void compileMatcher(const char* const match_strings[5]) {
+        _matcher.clear();
+        for (uint8_t i = 0; i < 5; i++) {
+            // a string that does not fit the automaton is still matched, only slower
+            if (!_matcher.add(match_strings[i], i)) {
+                _matcher.addFallback(match_strings[i], i);
+            }
+            _compiled_for[i] = match_strings[i];
+        }
+        _compiled_valid = true;
+        _matcher.compile();
+    }
+
+    /*
+        @brief Advance the matcher with a byte received from the module.
+
+        @detail The byte is fed to the matcher of the response strings and to the
+            registry of event handlers, which only matches URCs at the start of a
+            line. If the byte completes the match string of a deferred event handler,
+            the following bytes are captured into a frame of the URC arena, until the
+            frame is complete, and matching then continues. Other handlers are
+            executed straight away. These are free to call waitResponse themselves,
+            hence the matcher is compiled again afterwards.
+        @param [IN] c The byte received.
+        @param [IN] match_strings The same array passed to ::compileMatcher.
+        @param [OUT] rsp The response matched, only set when returning true.
+        @return True if one of the match strings has been found.
+    */
+    bool matchByte(uint8_t c, const char* const match_strings[5], Response_t& rsp) {
+        // the bytes of a URC being captured are not matched
+        if (_urc_capturing) {
+            captureByte(c);
+            return false;
+        }
+
+        // responses are matched anywhere, URCs at the start of a line only
+        EventHandler_t* handler = _handlers.feed(c);
+        uint8_t id = _matcher.feed(c);
+        if (id != A76XX_MATCHER_NO_MATCH) {
+            static const Response_t responses[5] = {
+                Response_t::A76XX_RESPONSE_MATCH_1ST,
+                Response_t::A76XX_RESPONSE_MATCH_2ND,
+                Response_t::A76XX_RESPONSE_MATCH_3RD,
+                Response_t::A76XX_RESPONSE_OK,
+                Response_t::A76XX_RESPONSE_ERROR
+            };
+            _matcher.reset();
+            rsp = responses[id];
+            metricsWaitEnd(true);
+            if (rsp == Response_t::A76XX_RESPONSE_OK || rsp == Response_t::A76XX_RESPONSE_ERROR) {
+                metricsResult(rsp);
+            }
+            return true;
+        }
+        if (handler == NULL) {
+            return false;
+        }
+        if (handler->deferred) {
+            beginCapture(handler);
+            return false;
+        }
+        handler->process(this);
+        metricsEvent(handler);
+        onEvent(handler);
+        // the handler has read the URC up to the end of its line
+        _handlers.lineStart();
+        compileMatcher(match_strings);
+        return false;
+    }
+
+    /*
+        @brief Move the frames not processed yet to the start of the arena.
+
+        @detail Not done while frames are being processed, as handlers hold
+            pointers into the arena.
+    */
+    void compactArena() {
+        if (_urc_dispatching || _urc_head == 0) {
+            return;
+        }
+        memmove(_urc_arena, _urc_arena + _urc_head, _urc_fill - _urc_head);
+        _urc_tail -= _urc_head;
+        _urc_fill -= _urc_head;
+        _urc_head = 0;
+    }
+
+    /*
+        @brief Append a byte to the frame being captured.
+
+        @param [IN] c The byte.
+        @param [IN] reserve Bytes that must remain free after this one.
+        @return False if the arena is full, in which case the byte is dropped.
+    */
+    bool storeByte(uint8_t c, size_t reserve = 0) {
+        if (_urc_dropped) {
+            return false;
+        }
+        if (_urc_fill + 1 + reserve > sizeof(_urc_arena)) {
+            compactArena();
+            if (_urc_fill + 1 + reserve > sizeof(_urc_arena)) {
+                _urc_truncated = true;
+                return false;
+            }
+        }
+        _urc_arena[_urc_fill++] = c;
+        return true;
+    }
+
+    /*
+        @brief Start capturing a frame, the match string of a deferred handler
+            having just been found.
+    */
+    void beginCapture(EventHandler_t* handler) {
+        _urc_capturing = true;
+        _urc_handler = handler;
+        _urc_line_len = 0;
+        _urc_body_len = 0;
+        _urc_body_left = 0;
+        _urc_in_body = false;
+        _urc_streaming = false;
+        _urc_truncated = false;
+        _urc_dropped = false;
+
+        // room for the header and the terminator of the line
+        if (_urc_tail + sizeof(URCFrameHeader) + 1 > sizeof(_urc_arena)) {
+            compactArena();
+        }
+        if (_urc_tail + sizeof(URCFrameHeader) + 1 > sizeof(_urc_arena)) {
+            _urc_dropped = true;
+#if A76XX_ENABLE_METRICS
+            _metrics.urcs_dropped++;
+#endif
+        } else {
+            _urc_fill = _urc_tail + sizeof(URCFrameHeader);
+        }
+
+        // the match string may already include the end of the line
+        size_t len = strlen(handler->match_string);
+        if (len > 0 && handler->match_string[len - 1] == '\n') {
+            endLine();
+        }
+    }
+
+    /*
+        @brief Add a byte from the module to the frame being captured.
+    */
+    void captureByte(uint8_t c) {
+        if (_urc_streaming) {
+            streamByte(c);
+            return;
+        }
+        if (_urc_in_body) {
+            // leave room for the URCs that follow, e.g. the end of an MQTT message
+            if (storeByte(c, sizeof(_urc_arena) / 4)) {
+                _urc_body_len++;
+            }
+            if (--_urc_body_left == 0) {
+                commitFrame();
+            }
+            return;
+        }
+        if (c == '\n') {
+            endLine();
+        } else if (c != '\r') {
+            // always leave room for the terminator
+            if (storeByte(c, 1)) {
+                _urc_line_len++;
+            }
+        }
+    }
+
+    /*
+        @brief Terminate the line of the frame being captured and ask its handler
+            for the length of the data following it.
+    */
+    void endLine() {
+        size_t body_len = 0;
+        if (!_urc_dropped) {
+            _urc_arena[_urc_fill++] = '\0';
+            if (_urc_handler != NULL) {
+                URCFrame_t frame((const char*) _urc_arena + _urc_tail + sizeof(URCFrameHeader),
+                                 _urc_line_len, NULL, 0, _urc_truncated);
+                body_len = _urc_handler->bodyLength(frame);
+            }
+        }
+        if (body_len == 0) {
+            commitFrame();
+        } else {
+            _urc_in_body = true;
+            _urc_body_left = body_len;
+            URCFrame_t frame((const char*) _urc_arena + _urc_tail + sizeof(URCFrameHeader),
+                             _urc_line_len, NULL, 0, _urc_truncated);
+            _urc_streaming = _urc_handler->streamsBody(frame);
+        }
+    }
+
+    /*
+        @brief Add a byte of a streamed body.
+
+        @detail Bytes are gathered after the line of the frame, in the free space of
+            the arena, and passed to the handler when that is full or the body is
+            complete. A byte that finds no room at all is passed on its own.
+    */
+    void streamByte(uint8_t c) {
+        // running out of room here loses nothing
+        bool truncated = _urc_truncated;
+        if (!storeByte(c)) {
+            flushBody();
+            if (!storeByte(c)) {
+                _urc_handler->bodyChunk(&c, 1);
+            }
+        }
+        _urc_truncated = truncated;
+        if (--_urc_body_left == 0) {
+            flushBody();
+            _urc_streaming = false;
+            commitFrame();
+        }
+    }
+
+    // pass the bytes gathered to the handler, the arena may have been compacted since
+    void flushBody() {
+        size_t start = _urc_tail + sizeof(URCFrameHeader) + _urc_line_len + 1;
+        if (_urc_fill > start) {
+            _urc_handler->bodyChunk(_urc_arena + start, _urc_fill - start);
+            _urc_fill = start;
+        }
+    }
+
+    /*
+        @brief Make the frame being captured available to ::processEvents.
+    */
+    void commitFrame() {
+        if (!_urc_dropped && _urc_handler != NULL) {
+            URCFrameHeader header = {_urc_handler, (uint16_t) _urc_line_len,
+                                     (uint16_t) _urc_body_len, _urc_truncated};
+            memcpy(_urc_arena + _urc_tail, &header, sizeof(header));
+            _urc_tail = _urc_fill;
+#if A76XX_ENABLE_METRICS
+            if (_urc_truncated) {
+                _metrics.urcs_truncated++;
+            }
+#endif
+        } else {
+            _urc_fill = _urc_tail;
+        }
+        _urc_capturing = false;
+        _urc_handler = NULL;
+        _matcher.reset();
+        _handlers.lineStart();
+    }
+
+    /*
+        @brief Called after an event handler has processed its URC, from ::processEvents
+            for deferred handlers.
+
+        @detail Backends can override this to signal the event to other tasks.
+        @param [IN] handler The event handler.
+    */
+    virtual void onEvent(EventHandler_t*) {}
+
+    /*
+        @brief Consume the data available from the module, without blocking.
+
+        @detail The matcher is only compiled again if the match strings have changed
+            since the last call, so that a match can span several calls.
+        @param [IN] match_strings As for ::compileMatcher.
+        @param [OUT] rsp The response matched, only set when returning true.
+        @return True if one of the match strings has been found. The data following
+            the match has not been consumed yet.
+    */
+    bool pollResponse(const char* const match_strings[5], Response_t& rsp) {
+        if (!_compiled_valid || memcmp(_compiled_for, match_strings, sizeof(_compiled_for)) != 0) {
+            compileMatcher(match_strings);
+        }
+        int c;
+        while ((c = read()) >= 0) {
+            if (matchByte(c, match_strings, rsp)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+        @brief Consume the rest of the line of the response of a command, without
+            blocking, see AsyncCommand_t::onResponse.
+
+        @return True once the line is complete.
+    */
+    bool pollLine(AsyncCommand_t& cmd);
+
+    /*
+        @brief Remove the command at the head of the queue and report its response.
+    */
+    void completeCommand(Response_t rsp);
+
+    /*
+        @brief Bounded buffer used to coalesce the items of a command.
+
+        @detail Items are formatted in place. When the buffer is full, its content is
+            written to the module and the buffer is reused, so commands of any length
+            can be sent. Items longer than the buffer are written directly. Without a
+            ModemSerial to write to, items that do not fit set the overflow flag.
+    */
+    class CommandBuffer {
+      public:
+        CommandBuffer(char* buf, size_t size, ModemSerial* serial)
+            : _serial(serial), _buf(buf), _size(size), _len(0), _overflow(false) {}
+
+        void append(const char* data, size_t len) {
+            if (_len + len > _size) {
+                if (_serial == NULL) {
+                    _overflow = true;
+                    return;
+                }
+                writePending();
+                if (len > _size) {
+                    _serial->write(data, len);
+                    return;
+                }
+            }
+            memcpy(_buf + _len, data, len);
+            _len += len;
+        }
+
+        void append(const char* str)        { append(str, strlen(str)); }
+        void append(char chr)               { append(&chr, 1); }
+        void append(uint16_t val)           { appendNumber("%u", val); }
+        void append(int val)                { appendNumber("%i", val); }
+        void append(long unsigned int val)  { appendNumber("%lu", val); }
+        void append(unsigned int val)       { appendNumber("%u", val); }
+
+        /*
+            @brief Write what is left in the buffer, then wait for transmission.
+        */
+        void send() {
+            writePending();
+            _serial->flush();
+        }
+
+        size_t length()  { return _len; }
+        bool overflow()  { return _overflow; }
+
+      private:
+        ModemSerial*   _serial;
+        char*             _buf;
+        size_t           _size;
+        size_t            _len;
+        bool         _overflow;
+
+        template <typename T>
+        void appendNumber(const char* fmt, T val) {
+            // fits a 64 bit long, with its sign
+            char num[21];
+            int len = snprintf(num, sizeof(num), fmt, val);
+            if (len < 0) {
+                return;
+            }
+            append(num, len < (int) sizeof(num) ? len : sizeof(num) - 1);
+        }
+
+        void writePending() {
+            if (_len > 0) {
+                _serial->write(_buf, _len);
+                _len = 0;
+            }
+        }
+    };
+
+    template <typename HEAD, typename... TAIL>
+    static void appendCMD(CommandBuffer& cmd, HEAD head, TAIL... tail) {
+        cmd.append(head);
+        appendCMD(cmd, tail...); //recursively calls this function until base case: no arguments
+    }
+
+    // base case: do nothing
+    static void appendCMD(CommandBuffer&) {}
 
   public:
-    ModemSerial() : _num_event_handlers(0) {}
+    /*
+        @brief Exclusive use of the serial channel for the lifetime of the object.
+
+        @detail Command wrappers open a transaction before sending a command and
+            keep it until the final result code has been read, so that commands
+            issued by different tasks or threads are not interleaved. Clients open
+            one around sequences of commands that must not be split, e.g. setting
+            the topic and the payload of an MQTT message, then publishing it.
+            Transactions can be nested. Data can be processed between two
+            transactions without holding up the other tasks. A transaction can be
+            given a Deadline, which bounds all the waits within it.
+
+            Example:
+
+                {
+                    ModemSerial::Transaction txn(serial);
+                    serial.sendCMD("AT+CSQ");
+                    serial.waitResponse("+CSQ: ");
+                    ...
+                }
+    */
+    class Transaction {
+      public:
+        /*
+            @param [IN] serial The serial object.
+            @param [IN] short_command Whether the transaction completes quickly, e.g. a
+                query answered with a final result code within a second, in which
+                case it is served before waiting transactions that are not short.
+        */
+        Transaction(ModemSerial& serial, bool short_command = false)
+            : _serial(serial) {
+            _serial.beginTransaction(short_command);
+            _outer = _serial._deadline;
+        }
+
+        /*
+            @brief A transaction that must complete before a deadline.
+
+            @detail The waits within the transaction are bounded by the deadline,
+                or by that of an enclosing transaction, if earlier.
+            @param [IN] serial The serial object.
+            @param [IN] deadline The deadline, copied.
+            @param [IN] short_command Whether the transaction completes quickly.
+        */
+        Transaction(ModemSerial& serial, const Deadline& deadline, bool short_command = false)
+            : _serial(serial)
+            , _deadline(deadline) {
+            _serial.beginTransaction(short_command);
+            _outer = _serial._deadline;
+            if (_deadline.isSet() && (_outer == NULL || _deadline.remaining() < _outer->remaining())) {
+                _serial._deadline = &_deadline;
+            }
+        }
+
+        ~Transaction() {
+            _serial._deadline = _outer;
+            _serial.endTransaction();
+        }
+
+      private:
+        ModemSerial&                    _serial;
+        Deadline                      _deadline;
+        const Deadline*                  _outer;
+
+        Transaction(const Transaction&);
+        Transaction& operator=(const Transaction&);
+    };
+
+    ModemSerial()
+        : _compiled_valid(false)
+        , _cmd_head(NULL)
+        , _cmd_tail(NULL)
+        , _txn_depth(0)
+        , _urc_head(0)
+        , _urc_tail(0)
+        , _urc_fill(0)
+        , _urc_handler(NULL)
+        , _urc_capturing(false)
+        , _urc_dispatching(false)
+        , _capture(NULL)
+        , _deadline(NULL)
+#if A76XX_ENABLE_METRICS
+        , _metrics_cmd(NULL)
+        , _metrics_sent_ms(0)
+        , _metrics_first_byte(false)
+        , _adapt_cmd(NULL)
+        , _adapt_wait(0)
+        , _adapt_latency(NULL)
+        , _adapt_start_ms(0)
+        , _adaptive(false)
+#endif
+        {}
 
     /*
         @brief Wait for modem to respond.
@@ -108,50 +725,52 @@ class ModemSerial {
         @param [IN] timeout Wait up to this time in ms before returning.
     */
     void listen(uint32_t timeout = 100) {
+        Transaction txn(*this);
         waitResponse(timeout, false, false);
     }
 
     /* 
         @brief Register a new event handler.
 
+        @detail Safe to call from any task: waits for the command in progress, if any.
+            Registering takes constant time and there is no limit on the number of
+            handlers. A handler can be registered with one serial object at a time.
         @param [IN] Pointer to a subclass of EventHandler_t.
+        @return False if the handler is already registered, or if its match string
+            is empty or just "+" or "$".
     */
-    void registerEventHandler(EventHandler_t* handler) {
-        _event_handlers[_num_event_handlers++] = handler;
+    bool registerEventHandler(EventHandler_t* handler) {
+        Transaction txn(*this);
+        return _handlers.add(handler);
     }
 
     /* 
         @brief Deregister an exisiting event handler.
 
+        @detail Safe to call from any task: waits for the command in progress, if any.
         @param [IN] Pointer to a subclass of EventHandler_t.
     */
     void deRegisterEventHandler(EventHandler_t* handler) {
-        // Search for the element of _event_handlers that points to the
-        // same address of the input, and then shift the elements left
-        // by one to `delete` the handler that needs to be de-registered.
-        // This can be replaced by a linked list for efficient removal, 
-        // but registration/deregistration is only done occasionally and 
-        // _num_event_handlers will typically be small
-        for (uint8_t i = 0; i < _num_event_handlers; i++) {
-            if (_event_handlers[i] == handler) {
-                for (uint8_t j = i; j < _num_event_handlers; j++) {
-                    _event_handlers[j] = _event_handlers[j+1];
-                }
-                _num_event_handlers--;
-                return;
-            }
+        Transaction txn(*this);
+        // the URC being captured is consumed, then dropped
+        if (_urc_handler == handler) {
+            _urc_handler = NULL;
         }
+        _handlers.remove(handler);
     }
 
     /*
         @brief Send data to the command to the module, with a trailing carriage return,
             line feed characters.
 
+        @detail All items are formatted into a buffer of A76XX_CMD_BUFFER_LEN bytes on
+            the stack and written to the module with a single call. Longer commands
+            are written in several pieces.
         @param [IN] args Items (string, numbers, ...) to be sent.
-        @param [IN] finish Whether to send a terminating "\r\n" to the module.
     */
     template <typename... ARGS>
     void sendCMD(ARGS... args) {
+        metricsCommandItems(args...);
         printCMD(args..., "\r\n");
     }
 
@@ -162,24 +781,149 @@ class ModemSerial {
             line feed characters.
 
         @param [IN] args Items (string, numbers, ...) to be sent.
-        @param [IN] finish Whether to send a terminating "\r\n" to the module.
     */
-    template <typename HEAD, typename... TAIL>
-    void printCMD(HEAD head, TAIL... tail) {
-        printItem(head);
-        printCMD(tail...); //recursively calls this function until base case: no arguments
+    template <typename... ARGS>
+    void printCMD(ARGS... args) {
+        char buf[A76XX_CMD_BUFFER_LEN];
+        CommandBuffer cmd(buf, sizeof(buf), this);
+        appendCMD(cmd, args...);
+        cmd.send();
     }
 
-    // single argument case
-    virtual void printItem(uint16_t val) = 0;
-    virtual void printItem(const char* str) = 0;
-    virtual void printItem(char chr) = 0;
-    virtual void printItem(int val) = 0;
-    virtual void printItem(long unsigned int val) = 0;
-    virtual void printItem(unsigned int val) = 0;
+    /*
+        @brief Take exclusive use of the serial channel, see ::Transaction.
 
-    // base case: do nothing
-    void printCMD(void) {}
+        @detail Blocks while another task holds the channel. Waiting tasks are served
+            in order, short commands first.
+        @param [IN] short_command Whether the transaction completes quickly.
+    */
+    void beginTransaction(bool short_command = false) {
+        _channel.acquire(short_command);
+        _txn_depth++;
+    }
+
+    /*
+        @brief Take exclusive use of the serial channel only if it is free.
+
+        @return True if the transaction has begun: call ::endTransaction.
+    */
+    bool tryBeginTransaction() {
+        if (!_channel.tryAcquire()) {
+            return false;
+        }
+        _txn_depth++;
+        return true;
+    }
+
+    /*
+        @brief End a transaction started with ::beginTransaction or ::tryBeginTransaction.
+
+        @detail At the end of the outermost transaction, the URCs captured in the
+            meantime are processed, see ::processEvents.
+    */
+    void endTransaction() {
+        if (_txn_depth == 1) {
+            processEvents();
+            metricsEndTransaction();
+        }
+        _txn_depth--;
+        _channel.release();
+    }
+
+    /*
+        @brief Pass the URCs captured so far to their deferred event handlers.
+
+        @detail Called at the end of each transaction, so only needed after calling
+            waitResponse outside of one. Handlers can issue commands themselves:
+            the URCs captured meanwhile are processed in the same call.
+    */
+    void processEvents() {
+        if (_urc_dispatching) {
+            return;
+        }
+        _urc_dispatching = true;
+        while (_urc_head < _urc_tail) {
+            URCFrameHeader header;
+            memcpy(&header, _urc_arena + _urc_head, sizeof(header));
+            const char* line = (const char*) _urc_arena + _urc_head + sizeof(header);
+            URCFrame_t frame(line, header.line_len,
+                             (const uint8_t*) line + header.line_len + 1, header.body_len,
+                             header.truncated);
+            _urc_head += sizeof(header) + header.line_len + 1 + header.body_len;
+
+            // skip frames of handlers deregistered in the meantime
+            if (_handlers.contains(header.handler)) {
+                header.handler->processFrame(frame);
+                metricsEvent(header.handler);
+                onEvent(header.handler);
+            }
+        }
+        _urc_dispatching = false;
+        compactArena();
+    }
+
+    /*
+        @brief Whether the URCs received now would only be processed later, because
+            the calling task is within a transaction or an event handler.
+
+        @detail Waiting there for the outcome reported by a deferred handler would
+            time out.
+    */
+    bool eventsDeferred() {
+        if (_txn_depth > 0) {
+            return _channel.held();
+        }
+        // processEvents called outside of a transaction
+        return _urc_dispatching;
+    }
+
+    /*
+        @brief Queue a command prepared with AsyncCommand_t::set, without blocking.
+
+        @detail Commands are sent one at a time, in order, by ::poll or ::run. Do not
+            issue blocking commands while asynchronous commands are pending, as
+            their responses would be mixed up.
+        @param [IN] cmd The command. It must stay alive until it is done.
+        @return False if the command is already pending.
+    */
+    bool submit(AsyncCommand_t& cmd);
+
+    /*
+        @brief Advance the queue of asynchronous commands, without blocking.
+
+        @detail Consumes the data available from the module. Event handlers are
+            executed as their match strings are found, the command in flight is
+            completed on a match or timeout, and the next one is sent. Call this
+            frequently, e.g. in the main loop, always from the same task: the
+            channel is held from when a command is sent until it is done, and
+            commands are only sent when no other task holds it.
+    */
+    void poll();
+
+    /*
+        @brief Block until a submitted command is done.
+
+        @detail Commands queued before `cmd` are completed first.
+        @param [IN] cmd The command.
+        @return The response to the command.
+    */
+    Response_t run(AsyncCommand_t& cmd);
+
+    /*
+        @brief Read the rest of the current line, e.g. the fields of a response
+            following the string matched by waitResponse.
+
+        @detail Bytes are read up to the line feed ending the line, with a single
+            deadline for the whole line. The carriage return, line feed characters
+            are not stored. The part of a line that does not fit in the buffer is
+            consumed and dropped. Use LineTokenizer to split the line into fields.
+        @param [OUT] buf The destination buffer, null terminated.
+        @param [IN] size The size of the buffer.
+        @param [IN] timeout Time out in milliseconds for the whole line.
+        @return The length of the line stored in the buffer, or -1 if the end of
+            the line was not received within the timeout.
+    */
+    virtual int readLine(char* buf, size_t size, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT);
 
     /*
         @brief Parse an integer number and then consume all data available in the 
@@ -206,6 +950,116 @@ class ModemSerial {
         waitResponse(timeout);
     }
 
+    /*
+        @brief The smaller of a timeout and the time left before the deadline of
+            the transaction held by the calling task, if any, see ::Transaction.
+    */
+    uint32_t boundTimeout(uint32_t timeout) {
+        if (_deadline == NULL || _txn_depth == 0 || !_channel.held()) {
+            return timeout;
+        }
+        return _deadline->bound(timeout);
+    }
+
+    /*
+        @brief Block until data is available from the module.
+
+        @param [IN] timeout Time out in milliseconds.
+        @return False if no data arrived within the timeout.
+    */
+    virtual bool waitAvailable(uint32_t timeout) = 0;
+
+    /*
+        @brief Record the data sent and received from now on, or stop with NULL.
+
+        @detail Set it while no other task uses the serial object.
+        @param [IN] capture The capture, which must outlive its use.
+    */
+    void setCapture(SerialCapture* capture) {
+        _capture = capture;
+    }
+
+    /*
+        @brief Number of received bytes lost because the receive buffer was full,
+            0 for backends without a buffer of their own.
+    */
+    virtual size_t rxOverflows() {
+        return 0;
+    }
+
+#if A76XX_ENABLE_METRICS
+    /*
+        @brief The traffic counters and command latencies recorded so far.
+
+        @detail Counters are updated without locking, so those read while another
+            task uses the serial object may be slightly off.
+    */
+    const ModemMetrics& metrics() {
+        _metrics.rx_overflows = rxOverflows();
+        return _metrics;
+    }
+
+    /*
+        @brief Reset the counters, e.g. after publishing them.
+    */
+    void resetMetrics() {
+        Transaction txn(*this, true);
+        _metrics.reset();
+        _metrics_cmd = NULL;
+        _metrics_first_byte = false;
+        _adapt_cmd = NULL;
+        _adapt_latency = NULL;
+    }
+
+    /*
+        @brief Shorten the timeouts of commands to what their observed latency
+            warrants, so that a module that stopped answering is noticed in
+            seconds rather than minutes.
+
+        @detail The waits following each command, e.g. for the prompt, then for the
+            final result or a URC, are told apart by their order, up to
+            A76XX_ADAPTIVE_WAITS per command. The latency of each is smoothed as
+            for TCP retransmissions. Once A76XX_ADAPTIVE_MIN_SAMPLES have been
+            seen, its timeout becomes the smoothed latency plus four times its
+            mean deviation, at least A76XX_ADAPTIVE_TIMEOUT_MIN milliseconds and at
+            most the timeout given by the caller, doubled after each consecutive
+            timeout. Latencies are learnt whether this is enabled or not. Only
+            waits within a transaction are adapted.
+        @param [IN] enable Whether to adapt timeouts. Disabled by default.
+    */
+    void setAdaptiveTimeouts(bool enable) {
+        _adaptive = enable;
+    }
+#endif
+
+    /*
+        @brief Change the baud rate of the host side of the link.
+
+        @detail Data waiting to be sent is sent first. Data received and not read
+            yet is dropped, as it may have been garbled by the change.
+        @param [IN] baud The new baud rate.
+        @return False if the backend cannot change the rate, or does not support it.
+    */
+    virtual bool setBaudRate(uint32_t) {
+        return false;
+    }
+
+    /*
+        @brief The baud rate of the host side of the link, 0 if unknown.
+    */
+    virtual uint32_t getBaudRate() {
+        return 0;
+    }
+
+    /*
+        @brief Enable or disable RTS/CTS flow control on the host side of the link.
+
+        @return False if the backend cannot change the flow control.
+    */
+    virtual bool setHardwareFlowControl(bool) {
+        return false;
+    }
+
     // The following functions are simply forwarding the calls to underlying stream 
     // object. If you need others, send a pull request!
     virtual int available() = 0;
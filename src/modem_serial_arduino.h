@@ -6,30 +6,13 @@
 #include "modem_serial.h"
 #include "Arduino.h"
 
-/*
-    @brief Check if the last characters in the character buffer match with a given string.
-
-    @param [IN] buf The character buffer.
-    @param [IN] str The string to be matched.
-    @return True in case of a match.
-*/
-template<size_t N>
-bool endsWith(CircularBuffer<char, N>& buf, const char* str) {
-    if (strlen(str) > buf.size()) { return false; }
-    const char* m = str + strlen(str) - 1; // pointer to last character in str
-    int i = 1;
-    while (i <= buf.size() && i <= strlen(str) ) {
-        if (buf[buf.size() - i] != *m) {
-            return false;
-        }
-        m--;
-        i++;
-    }
-    return true;
-}
-
 class TimeoutCalc {
 public:
+    // milliseconds since an arbitrary origin
+    static uint32_t now() {
+        return millis();
+    }
+
     TimeoutCalc(uint32_t timeoutMs) {
         _start = millis();
         _duration = timeoutMs;
@@ -37,15 +20,88 @@ public:
     bool expired(void) {
         return(!(millis() - _start < _duration));
     }
+    uint32_t remaining(void) {
+        uint32_t elapsed = millis() - _start;
+        return elapsed < _duration ? _duration - elapsed : 0;
+    }
 
 private:
     uint32_t _start;
     uint32_t _duration;
 };
 
-class ModemSerialArduino : public ModemSerial {
+class ModemSerialArduino final : public ModemSerial {
+  public:
+    // change the baud rate, or flow control, of the underlying serial object
+    typedef bool (*BaudRateCallback_t)(uint32_t baud);
+    typedef bool (*FlowControlCallback_t)(bool enable);
+
   private:
     Stream& _stream;
+    BaudRateCallback_t _set_baud;
+    FlowControlCallback_t _set_flow;
+    uint32_t _baud;
+    // bytes read one by one, traced together once the stream runs dry
+    uint8_t _rx_trace[A76XX_SERIAL_RX_CHUNK];
+    size_t _rx_trace_len;
+
+    void flushTraceRx() {
+        if (_rx_trace_len > 0) {
+            traceRx(_rx_trace, _rx_trace_len);
+            _rx_trace_len = 0;
+        }
+    }
+
+    int timedPeek(TimeoutCalc& tc) {
+        while (_stream.available() <= 0) {
+            flushTraceRx();
+            if (tc.expired()) return -1;
+        }
+        return _stream.peek();
+    }
+
+    /*
+        @brief Read the characters of a number into numberBuf.
+
+        @detail Ignores all invalid characters before the first valid one, then
+            stops, without consuming it, at the first invalid character, or on timeout.
+        @param [OUT] numberBuf Null terminated string with the valid characters.
+        @param [IN] len Size of numberBuf.
+        @param [IN] decimal Whether a decimal point is a valid character.
+        @return The number of valid characters found.
+    */
+    size_t readNumber(char* numberBuf, size_t len, bool decimal) {
+        TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+        size_t numberLen = 0;
+        bool seenDot = false;
+        int c;
+
+        //look for first occurrence of a valid char
+        while(1) {
+            c = timedPeek(tc);
+            if(c < 0) {
+                numberBuf[0] = '\0';
+                return 0;
+            }
+            if((c >= '0' && c <= '9') || c == '-' || (decimal && c == '.')) break;
+            read();
+        }
+
+        //minus is only valid as first char, the dot only once
+        while(numberLen < len - 1) {
+            c = timedPeek(tc);
+            if(c < 0) break;
+            bool valid = (c >= '0' && c <= '9')
+                      || (c == '-' && numberLen == 0)
+                      || (decimal && c == '.' && !seenDot);
+            if(!valid) break;
+            if(c == '.') seenDot = true;
+            numberBuf[numberLen++] = c;
+            read();
+        }
+        numberBuf[numberLen] = '\0';
+        return numberLen;
+    }
 
   public:
 
@@ -62,7 +118,34 @@ class ModemSerialArduino : public ModemSerial {
             not established.
     */
     ModemSerialArduino(Stream& stream)
-        : _stream(stream) {_stream.setTimeout(A76XX_SERIAL_TIMEOUT_DEFAULT);}
+        : _stream(stream)
+        , _set_baud(NULL)
+        , _set_flow(NULL)
+        , _baud(0)
+        , _rx_trace_len(0) {_stream.setTimeout(A76XX_SERIAL_TIMEOUT_DEFAULT);}
+
+    /*
+        @brief Set how to change the baud rate of the underlying serial object,
+            which Stream does not provide, e.g. with Serial1.updateBaudRate on ESP32.
+
+        @param [IN] set_baud Function changing the baud rate, returning false on failure.
+        @param [IN] baud The current baud rate, or 0 if unknown.
+    */
+    void setBaudRateCallback(BaudRateCallback_t set_baud, uint32_t baud = 0) {
+        _set_baud = set_baud;
+        _baud = baud;
+    }
+
+    /*
+        @brief Set how to enable or disable RTS/CTS flow control on the underlying
+            serial object, e.g. with Serial1.setHwFlowCtrlMode on ESP32.
+    */
+    void setFlowControlCallback(FlowControlCallback_t set_flow) {
+        _set_flow = set_flow;
+    }
+
+    // the overloads with fewer match strings, hidden by the override below
+    using ModemSerial::waitResponse;
 
     /*
         @brief Wait for modem to respond.
@@ -88,90 +171,95 @@ class ModemSerialArduino : public ModemSerial {
                             uint32_t timeout = 1000,
                             bool match_OK = true,
                             bool match_ERROR = true) {
-        // store data here
-        CircularBuffer<char, 64> data;
+        const char* cmp_str[5] = {
+            match_1,
+            match_2,
+            match_3,
+            match_OK ? RESPONSE_OK : NULL,
+            match_ERROR ? RESPONSE_ERROR : NULL
+        };
+        compileMatcher(cmp_str);
+        timeout = waitTimeout(timeout, cmp_str);
+        Response_t rsp;
 
         // start timer
         auto tstart = millis();
 
         while (millis() - tstart < timeout) {
             if (available() > 0) {
-                data.push(static_cast<char>(read()));
-
-                // parse modem output for any URCs that we need to process
-                for (uint8_t i = 0; i < _num_event_handlers; i++) {
-                    if (endsWith(data, _event_handlers[i]->match_string)) {
-                        _event_handlers[i]->process(this);
-                    }
+                // final responses and URCs are all found by the same automaton
+                if (matchByte(static_cast<uint8_t>(read()), cmp_str, rsp)) {
+                    return rsp;
                 }
-
-                if (match_1 != NULL && endsWith(data, match_1) == true)
-                    return Response_t::A76XX_RESPONSE_MATCH_1ST;
-
-                if (match_2 != NULL && endsWith(data, match_2) == true)
-                    return Response_t::A76XX_RESPONSE_MATCH_2ND;
-
-                if (match_3 != NULL && endsWith(data, match_3) == true)
-                    return Response_t::A76XX_RESPONSE_MATCH_3RD;
-
-                if (match_ERROR && endsWith(data, RESPONSE_ERROR) == true)
-                    return Response_t::A76XX_RESPONSE_ERROR;
-
-                if (match_OK && endsWith(data, RESPONSE_OK) == true)
-                    return Response_t::A76XX_RESPONSE_OK;
             }
         }
 
-        return Response_t::A76XX_RESPONSE_TIMEOUT;
+        return timeoutResponse();
     }
 
-    // The following functions are simply forwarding the calls to underlying stream
-    // object. If you need others, send a pull request!
-
-    void printItem(const char* str) override {
-        _stream.print(str);
-        flush();
+    bool waitAvailable(uint32_t timeout) override {
+        TimeoutCalc tc(timeout);
+        while (_stream.available() <= 0) {
+            flushTraceRx();
+            if (tc.expired()) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    void printItem(uint16_t val) override {
-        _stream.print(val);
-        flush();
+    int readLine(char* buf, size_t size, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT) override {
+        return readLineFrom(*this, buf, size, timeout);
     }
 
-    void printItem(char chr) override {
-        _stream.print(chr);
-        flush();
-    }
+    // The following functions mostly forward the calls to the underlying stream
+    // object, those consuming data go through read so that it is traced.
 
-    void printItem(int val) override {
-        _stream.print(val);
-        flush();
+    int available() override {
+        int avail = _stream.available();
+        if (avail <= 0) {
+            flushTraceRx();
+        }
+        return avail;
     }
 
-    void printItem(long unsigned int val) override {
-        _stream.print(val);
-        flush();
+    long parseInt() override {
+        //returns on timeout (and evaluates all valid chars up until then)
+        //or on first invalid char after valid ones, which is left unread.
+        char numberBuf[20];
+        if(readNumber(numberBuf, sizeof(numberBuf), false) == 0) return 0L;
+        return strtol(numberBuf, NULL, 10);
     }
 
-    void printItem(unsigned int val) override {
-        _stream.print(val);
-        flush();
+    float parseFloat() override {
+        //returns on timeout (and evaluates all valid chars up until then)
+        //or on first invalid char after valid ones, which is left unread.
+        char numberBuf[20];
+        if(readNumber(numberBuf, sizeof(numberBuf), true) == 0) return 0.0f;
+        return strtof(numberBuf, NULL);
     }
 
-    int available() override {
-        return _stream.available();
+    void flush() override {
+        _stream.flush();
     }
 
-    long parseInt() override {
-        return _stream.parseInt();
+    bool setBaudRate(uint32_t baud) override {
+        if(_set_baud == NULL) return false;
+        _stream.flush();
+        if(!_set_baud(baud)) return false;
+        _baud = baud;
+        // drop whatever was received around the change
+        flushTraceRx();
+        while(_stream.available() > 0) _stream.read();
+        return true;
     }
 
-    float parseFloat() override {
-        return _stream.parseFloat();
+    uint32_t getBaudRate() override {
+        return _baud;
     }
 
-    void flush() override {
-        _stream.flush();
+    bool setHardwareFlowControl(bool enable) override {
+        return _set_flow != NULL && _set_flow(enable);
     }
 
     int peek() override {
@@ -179,27 +267,56 @@ class ModemSerialArduino : public ModemSerial {
     }
 
     int read() override {
-        return _stream.read();
+        int val = _stream.read();
+        if (val >= 0) {
+            _rx_trace[_rx_trace_len++] = val;
+            if (_rx_trace_len == sizeof(_rx_trace)) {
+                flushTraceRx();
+            }
+        }
+        return val;
     }
 
     bool find(char terminator) override {
-        return _stream.find(terminator);
+        while (waitAvailable(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+            if (read() == (uint8_t) terminator) {
+                return true;
+            }
+        }
+        //timeout
+        return false;
     }
 
     size_t write(const char* data) override {
-        return _stream.write(data);
+        return write(data, strlen(data));
     }
 
     size_t write(const char* data, size_t size) override {
-        return _stream.write(data, size);
+        // what was received before goes first in the capture
+        flushTraceRx();
+        size_t written = _stream.write(data, size);
+        traceTx((const uint8_t*) data, written);
+        return written;
     }
 
+    // as Stream::readBytesUntil, but the terminator is traced too
     size_t readBytesUntil(char terminator, char* buf, int len) override {
-        return _stream.readBytesUntil(terminator, buf, len);
+        size_t readLen = 0;
+        while (readLen < (size_t) len && waitAvailable(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+            int val = read();
+            if (val == (uint8_t) terminator) {
+                break;
+            }
+            buf[readLen++] = val;
+        }
+        return readLen;
     }
 
     size_t readBytes(void* buf, int len) override {
-        return _stream.readBytes((uint8_t *) buf, len);
+        flushTraceRx();
+        size_t readLen = _stream.readBytes((uint8_t *) buf, len);
+        traceRx((const uint8_t*) buf, readLen);
+        return readLen;
     }
 };
 
@@ -1,7 +1,7 @@
 #ifndef A76XX_MODEMUART_ESP_H_
 #define A76XX_MODEMUART_ESP_H_
 
-#ifndef ARDUINO
+#if !defined(ARDUINO) && defined(ESP_PLATFORM)
 
 #include "modem_serial.h"
 #include "utils/byteringbuf.h"
@@ -9,6 +9,11 @@
 extern "C"{
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
 }
 
 inline void delay(unsigned long ms) {
@@ -17,6 +22,11 @@ inline void delay(unsigned long ms) {
 
 class TimeoutCalc {
 public:
+    // milliseconds since an arbitrary origin
+    static uint32_t now() {
+        return pdTICKS_TO_MS(xTaskGetTickCount());
+    }
+
     TimeoutCalc(uint32_t timeoutMs) {
         _start = xTaskGetTickCount();
         _duration = pdMS_TO_TICKS(timeoutMs);
@@ -24,16 +34,222 @@ public:
     bool expired(void) {
         return(!(xTaskGetTickCount() - _start < _duration));
     }
+    uint32_t remaining(void) {
+        TickType_t elapsed = xTaskGetTickCount() - _start;
+        return elapsed < _duration ? pdTICKS_TO_MS(_duration - elapsed) : 0;
+    }
 
 private:
     TickType_t _start;
     TickType_t _duration;
 };
 
-class ModemSerialESP : public ModemSerial {
+class ModemSerialESP final : public ModemSerial {
   private:
     uart_port_t _uart;
-    ByteRingBuf _buf;
+    ByteRingBuf<A76XX_SERIAL_RX_BUFFER_SIZE> _buf;
+    static_assert(A76XX_SERIAL_RX_BUFFER_SIZE >= A76XX_RX_TASK_STREAM_SIZE + 2 * A76XX_SERIAL_RX_CHUNK,
+                  "A76XX_SERIAL_RX_BUFFER_SIZE cannot hold the data handed back by the RX task");
+
+    // optional RX task, see ::startRxTask
+    TaskHandle_t                _rx_task;
+    SemaphoreHandle_t             _mutex;
+    StreamBufferHandle_t      _rx_stream;
+    QueueHandle_t           _event_queue;
+    volatile bool             _app_owned;
+    volatile TickType_t        _last_use;
+
+    /*
+        @brief Marks the stream as owned by the application for the duration of a call.
+
+        @detail Without an RX task, or when called from the RX task itself, e.g. by an
+            event handler, this does nothing.
+    */
+    class AppGuard {
+      public:
+        AppGuard(ModemSerialESP& serial)
+            : _serial(serial), _active(!serial.inRxContext()) {
+            if (_active) {
+                // set before waiting, so that the RX task stops parsing URCs
+                _serial._app_owned = true;
+                xSemaphoreTakeRecursive(_serial._mutex, portMAX_DELAY);
+                _serial._app_owned = true;
+            }
+        }
+        ~AppGuard() {
+            if (_active) {
+                _serial._last_use = xTaskGetTickCount();
+                xSemaphoreGiveRecursive(_serial._mutex);
+            }
+        }
+
+      private:
+        ModemSerialESP& _serial;
+        bool            _active;
+    };
+
+    // whether data must be read from the UART directly, rather than from the RX task
+    bool inRxContext() {
+        return _rx_task == NULL || xTaskGetCurrentTaskHandle() == _rx_task;
+    }
+
+    // read what the driver has buffered, waiting for at least one byte
+    size_t readChunk(uint8_t* chunk, TickType_t wait) {
+        size_t len = 0;
+        if(uart_get_buffered_data_len(_uart, &len) != ESP_OK || len == 0) {
+            len = 1;
+        }
+        if(len > A76XX_SERIAL_RX_CHUNK) len = A76XX_SERIAL_RX_CHUNK;
+        int readLen = uart_read_bytes(_uart, chunk, len, wait);
+        if(readLen <= 0) return 0;
+        traceRx(chunk, readLen);
+        return readLen;
+    }
+
+    static void rxTask(void* arg) {
+        static_cast<ModemSerialESP*>(arg)->rxLoop();
+    }
+
+    /*
+        @brief Body of the RX task.
+
+        @detail When the application is not using the stream, data from the UART is
+            consumed here, and URCs are captured and passed to their event handlers as
+            they complete. While the application is using it, i.e. it holds a
+            transaction or has been calling ModemSerial methods within the last
+            A76XX_RX_TASK_RELEASE_MS milliseconds, data is passed to it through a
+            stream buffer, which wakes the application task up as soon as bytes arrive.
+    */
+    void rxLoop() {
+        static const char* const no_match[5] = {NULL, NULL, NULL, NULL, NULL};
+        const TickType_t release = pdMS_TO_TICKS(A76XX_RX_TASK_RELEASE_MS);
+        uint8_t chunk[A76XX_SERIAL_RX_CHUNK];
+        size_t len = 0;
+        Response_t rsp;
+
+        while(1) {
+            if(len == 0) {
+                len = readChunk(chunk, _app_owned ? release : portMAX_DELAY);
+            }
+
+            // a task in the middle of a transaction keeps the stream, even if it
+            // has been idle between two of its commands
+            if(xSemaphoreTakeRecursive(_mutex, 0) == pdTRUE) {
+                if(tryBeginTransaction()) {
+                    if(_app_owned && xTaskGetTickCount() - _last_use >= release) {
+                        // the application is done: take back what it has not consumed
+                        uint8_t left[A76XX_SERIAL_RX_CHUNK];
+                        size_t leftLen;
+                        while((leftLen = xStreamBufferReceive(_rx_stream, left, sizeof(left), 0)) > 0) {
+                            _buf.write(left, leftLen);
+                        }
+                        _app_owned = false;
+                    }
+                    if(!_app_owned) {
+                        if(len > 0) {
+                            _buf.write(chunk, len);
+                            len = 0;
+                        }
+                        pollResponse(no_match, rsp);
+                        endTransaction();
+                        xSemaphoreGiveRecursive(_mutex);
+                        continue;
+                    }
+                    endTransaction();
+                }
+                xSemaphoreGiveRecursive(_mutex);
+            }
+
+            if(len > 0) {
+                size_t sent = xStreamBufferSend(_rx_stream, chunk, len, release);
+                if(sent < len) {
+                    memmove(chunk, chunk + sent, len - sent);
+                }
+                len -= sent;
+            }
+        }
+    }
+
+    /*
+        @brief Stage data from the UART driver in the ringbuffer.
+
+        @detail All read functions consume data from the ringbuffer. When it runs
+            empty, everything the driver has buffered so far (up to
+            A76XX_SERIAL_RX_CHUNK bytes) is moved to it with a single call to
+            uart_read_bytes, instead of one call per byte.
+        @param [IN] wait Ticks to wait for at least one byte if nothing is buffered.
+        @return False if no data is available within the given time.
+    */
+    bool fill(TickType_t wait) {
+        if(_buf.getUsed() > 0) return true;
+
+        uint8_t chunk[A76XX_SERIAL_RX_CHUNK];
+        size_t readLen;
+        if(inRxContext()) {
+            readLen = readChunk(chunk, wait);
+        } else {
+            //the RX task reads the UART, we get woken up when it passes data on
+            readLen = xStreamBufferReceive(_rx_stream, chunk, sizeof(chunk), wait);
+        }
+        if(readLen == 0) return false;
+        _buf.write(chunk, readLen);
+        return true;
+    }
+
+    int timedPeek(TimeoutCalc& tc) {
+        uint8_t val;
+        if(!fill(pdMS_TO_TICKS(tc.remaining())) || !_buf.peek(&val)) return -1;
+        return val;
+    }
+
+    /*
+        @brief Read the characters of a number into numberBuf.
+
+        @detail Ignores all invalid characters before the first valid one, then
+            stops, without consuming it, at the first invalid character, or on timeout.
+        @param [OUT] numberBuf Null terminated string with the valid characters.
+        @param [IN] len Size of numberBuf.
+        @param [IN] decimal Whether a decimal point is a valid character.
+        @return The number of valid characters found.
+    */
+    size_t readNumber(char* numberBuf, size_t len, bool decimal) {
+        TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+        size_t numberLen = 0;
+        bool seenDot = false;
+        int c;
+
+        //look for first occurrence of a valid char
+        while(1) {
+            c = timedPeek(tc);
+            if(c < 0) {
+                numberBuf[0] = '\0';
+                return 0;
+            }
+            if((c >= '0' && c <= '9') || c == '-' || (decimal && c == '.')) break;
+            _buf.consume(1);
+        }
+
+        //minus is only valid as first char, the dot only once
+        while(numberLen < len - 1) {
+            c = timedPeek(tc);
+            if(c < 0) break;
+            bool valid = (c >= '0' && c <= '9')
+                      || (c == '-' && numberLen == 0)
+                      || (decimal && c == '.' && !seenDot);
+            if(!valid) break;
+            if(c == '.') seenDot = true;
+            numberBuf[numberLen++] = c;
+            _buf.consume(1);
+        }
+        numberBuf[numberLen] = '\0';
+        return numberLen;
+    }
+
+    void onEvent(EventHandler_t* handler) override {
+        if(_event_queue != NULL) {
+            xQueueSend(_event_queue, &handler, 0);
+        }
+    }
 
   public:
     // The following functions are simply forwarding the calls to underlying stream
@@ -52,7 +268,95 @@ class ModemSerialESP : public ModemSerial {
             not established.
     */
     ModemSerialESP(uart_port_t uart)
-        : _uart(uart), _buf(200) {}
+        : _uart(uart)
+        , _rx_task(NULL)
+        , _mutex(NULL)
+        , _rx_stream(NULL)
+        , _event_queue(NULL)
+        , _app_owned(false)
+        , _last_use(0) {}
+
+    /*
+        @brief Start a task that reads from the UART continuously.
+
+        @details URCs are then processed as soon as they arrive, even while the
+            application is not calling any method of this object, e.g. MQTT messages
+            are pushed to the queue of the MQTT client. Use ::waitEvent to block until
+            an event handler has processed a URC, instead of calling A76XX::listen in
+            a loop. Calls from the application are served by the task, which wakes
+            the caller up as soon as data arrives.
+
+            Event handlers run in the RX task: protect access to the data they store,
+            e.g. client message queues, with ::lock and ::unlock. The task is never
+            stopped, so this object must not be destroyed after the call.
+
+        @param [IN] priority Priority of the task.
+        @param [IN] core Core to pin the task to, or tskNO_AFFINITY.
+        @param [IN] stack_size Stack size of the task, in bytes.
+        @return False if the task or its resources could not be created.
+    */
+    bool startRxTask(UBaseType_t priority = A76XX_RX_TASK_PRIORITY,
+                     BaseType_t core = tskNO_AFFINITY,
+                     uint32_t stack_size = A76XX_RX_TASK_STACK_SIZE) {
+        if(_rx_task != NULL) return true;
+
+        _mutex = xSemaphoreCreateRecursiveMutex();
+        _rx_stream = xStreamBufferCreate(A76XX_RX_TASK_STREAM_SIZE, 1);
+        if(_event_queue == NULL) {
+            _event_queue = xQueueCreate(A76XX_EVENT_QUEUE_SIZE, sizeof(EventHandler_t*));
+        }
+        if(_mutex == NULL || _rx_stream == NULL || _event_queue == NULL) {
+            return false;
+        }
+        // the application is the owner until it has been idle for a while
+        _app_owned = true;
+        _last_use = xTaskGetTickCount();
+        return xTaskCreatePinnedToCore(rxTask, "A76XX_RX", stack_size, this,
+                                       priority, &_rx_task, core) == pdPASS;
+    }
+
+    /*
+        @brief Block until an event handler has processed a URC.
+
+        @details Events are signalled whether handlers run in the RX task or in a call
+            from the application, e.g. waitResponse. Up to A76XX_EVENT_QUEUE_SIZE events
+            are stored; further events are dropped until the application catches up.
+
+        @param [IN] timeout Time out in milliseconds.
+        @return The handler, or NULL on timeout.
+    */
+    EventHandler_t* waitEvent(uint32_t timeout) {
+        if(_event_queue == NULL) {
+            _event_queue = xQueueCreate(A76XX_EVENT_QUEUE_SIZE, sizeof(EventHandler_t*));
+            if(_event_queue == NULL) return NULL;
+        }
+        EventHandler_t* handler = NULL;
+        if(xQueueReceive(_event_queue, &handler, pdMS_TO_TICKS(timeout)) != pdTRUE) {
+            return NULL;
+        }
+        return handler;
+    }
+
+    /*
+        @brief Take exclusive use of the stream, e.g. to read data stored by event
+            handlers running in the RX task. Does nothing without the RX task.
+    */
+    void lock() {
+        if(!inRxContext()) {
+            _app_owned = true;
+            xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+        }
+    }
+
+    void unlock() {
+        if(!inRxContext()) {
+            _last_use = xTaskGetTickCount();
+            xSemaphoreGiveRecursive(_mutex);
+        }
+    }
+
+    // the overloads with fewer match strings, hidden by the override below
+    using ModemSerial::waitResponse;
 
     Response_t waitResponse(const char* match_1,
                             const char* match_2,
@@ -60,11 +364,7 @@ class ModemSerialESP : public ModemSerial {
                             uint32_t timeout = 1000,
                             bool match_OK = true,
                             bool match_ERROR = true) override {
-
-        TickType_t startTime = xTaskGetTickCount();
-        TickType_t timeoutTicks = pdMS_TO_TICKS(timeout);
-
-        //_buf.clear();
+        AppGuard guard(*this);
         const char* cmp_str[5] = {
                 match_1,
                 match_2,
@@ -72,284 +372,132 @@ class ModemSerialESP : public ModemSerial {
                 match_OK ? RESPONSE_OK : NULL,
                 match_ERROR ? RESPONSE_ERROR : NULL
         };
-        Response_t resp[5] = {
-                A76XX_RESPONSE_MATCH_1ST,
-                A76XX_RESPONSE_MATCH_2ND,
-                A76XX_RESPONSE_MATCH_3RD,
-                A76XX_RESPONSE_OK,
-                A76XX_RESPONSE_ERROR
-        };
-        uint8_t cmp_idx;
+        compileMatcher(cmp_str);
+        TimeoutCalc tc(waitTimeout(timeout, cmp_str));
 
-        while(1) {
-            //calculate remaining time
-            TickType_t elapsedTime = xTaskGetTickCount() - startTime;
-            if(elapsedTime > timeoutTicks) { //timeout
-                _buf.clear();
-                return A76XX_RESPONSE_TIMEOUT;
-            }
-            TickType_t remainingTime = timeoutTicks - elapsedTime;
-
-            //wait and fetch a char from uart, with timeout
-            uint8_t val;
-            if(uart_read_bytes(_uart, &val, 1, remainingTime) > 0) {
-                _buf.write(&val, 1);
-            } else { //timeout
-                _buf.clear();
-                return A76XX_RESPONSE_TIMEOUT;
-            }
+        Response_t rsp;
+        uint8_t val;
 
-            for(cmp_idx = 0; cmp_idx<5; cmp_idx++) {
-                if(!cmp_str[cmp_idx]) continue;
-                if(_buf.endsWith(cmp_str[cmp_idx])) {
-                    //found match!
-                    _buf.clear();
-                    return resp[cmp_idx];
+        while(1) {
+            if(!_buf.pop(&val)) {
+                //stage whatever the driver has, waiting for the remaining time
+                if(tc.expired() || !fill(pdMS_TO_TICKS(tc.remaining()))) {
+                    return timeoutResponse();
                 }
+                continue;
             }
-            //do the same with URCs
-            for (uint8_t i=0; i<_num_event_handlers; i++) {
-                if (_buf.endsWith(_event_handlers[i]->match_string)) {
-                    //found match with registered URCs. Send event, then continue
-                    _event_handlers[i]->process(this);
-                    _buf.clear();
-                    break;
-                }
+
+            //final responses and URCs are all found by the same automaton
+            if(matchByte(val, cmp_str, rsp)) {
+                return rsp;
             }
         }
         return A76XX_RESPONSE_TIMEOUT; //execution won't reach here
     }
 
-    void printItem(const char* str) override {
-        uart_write_bytes(_uart, str, strlen(str));
-        flush();
-    }
-
-    void printItem(uint16_t val) override {
-        char buf[6];
-        int len = snprintf(buf, 6, "%u", val);
-        uart_write_bytes(_uart, buf, len);
-        flush();
-    }
-
-    void printItem(char chr) override {
-        uart_write_bytes(_uart, &chr, 1);
-        flush();
-    }
-
-    void printItem(int val) override {
-        char buf[10];
-        int len = snprintf(buf, 10, "%i", val);
-        uart_write_bytes(_uart, buf, len);
-        flush();
-    }
-
-    void printItem(long unsigned int val) override {
-        char buf[10];
-        int len = snprintf(buf, 10, "%lu", val);
-        uart_write_bytes(_uart, buf, len);
-        flush();
+    bool waitAvailable(uint32_t timeout) override {
+        AppGuard guard(*this);
+        return fill(pdMS_TO_TICKS(timeout));
     }
 
-    void printItem(unsigned int val) override {
-        char buf[10];
-        int len = snprintf(buf, 10, "%u", val);
-        uart_write_bytes(_uart, buf, len);
-        flush();
+    int readLine(char* buf, size_t size, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT) override {
+        AppGuard guard(*this);
+        return readLineFrom(*this, buf, size, timeout);
     }
 
     int available() override {
-        int availBytes;
-        if(uart_get_buffered_data_len(_uart, (size_t *) &availBytes) != ESP_OK) {
+        size_t availBytes = 0;
+        if(!inRxContext()) {
+            availBytes = xStreamBufferBytesAvailable(_rx_stream);
+        } else if(uart_get_buffered_data_len(_uart, &availBytes) != ESP_OK) {
             availBytes = 0;
         }
         return availBytes + _buf.getUsed();
     }
 
+    /*
+        @brief Number of received bytes lost because the receive buffer was full.
+    */
+    size_t rxOverflows() override {
+        return _buf.overflows();
+    }
+
     long parseInt() override {
-        //ignores all invalid characters before first valid one
+        AppGuard guard(*this);
         //returns on timeout (and evaluates all valid chars up until then)
-        //or on first invalid char after valid ones.
-
-        TickType_t startTime = xTaskGetTickCount();
-        TickType_t timeoutTicks = pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT);
-
-        _buf.clear(); //discard all values as ringbuffer is used as intermediate buffer
-        bool validNumber = false;
-        char validChars[] = "0123456789-";
+        //or on first invalid char after valid ones, which is left unread.
         char numberBuf[20];
-        uint8_t val, numberLen;
-
-        while(1) {
-            //calculate remaining time
-            TickType_t elapsedTime = xTaskGetTickCount() - startTime;
-            if(elapsedTime > timeoutTicks) { //timeout
-                _buf.clear();
-                return 0L;
-            }
-            TickType_t remainingTime = timeoutTicks - elapsedTime;
-
-            if(validNumber) {
-                if(uart_read_bytes(_uart, &val, 1, remainingTime) != 1) { //timeout
-                    numberLen = _buf.read((uint8_t*) numberBuf, 20);
-                    if(numberLen == 20) {
-                        _buf.clear();
-                        return 0L;
-                    } else {numberBuf[numberLen] = '\0';}
-
-                    break; //go to evaluation
-                }
-                //check if char is valid
-                if(strchr(validChars, val)) {
-                    //store in ringbuffer
-                    _buf.write(&val, 1);
-                } else { //invalid digit after valid one(s)
-                    //transfer valid chars from ringbuffer to numberBuf
-                    numberLen = _buf.read((uint8_t*) numberBuf, 20);
-                    if(numberLen == 20) {
-                        _buf.clear();
-                        _buf.write(&val, 1);
-                        return 0L;
-                    } else {numberBuf[numberLen] = '\0';}
-                    //store invalid digit in ringbuffer
-                    _buf.write(&val, 1);
-                    //proceed to evaluation
-                    break;
-                }
-            } else { // !validNumber
-                //look for first occurrence of a valid char
-                if(uart_read_bytes(_uart, &val, 1, remainingTime) != 1) { //timeout
-                    return 0L;
-                }
-                //check if char is valid
-                if(strchr(validChars, val)) {
-                    //store in ringbuffer
-                    _buf.write(&val, 1);
-                    //from now on, minus (-) is not a valid character
-                    validChars[10] = '\0';
-                    validNumber = true;
-                }
-            }
-        }
-        //turn valid characters into 'long' variable
+        if(readNumber(numberBuf, sizeof(numberBuf), false) == 0) return 0L;
         return strtol(numberBuf, NULL, 10);
     }
 
     float parseFloat() override {
-        //ignores all invalid characters before first valid one
+        AppGuard guard(*this);
         //returns on timeout (and evaluates all valid chars up until then)
-        //or on first invalid char after valid ones.
-
-        TickType_t startTime = xTaskGetTickCount();
-        TickType_t timeoutTicks = pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT);
-
-        _buf.clear(); //discard all values as ringbuffer is used as intermediate buffer
-        bool validNumber = false;
-        char validChars[] = "0123456789.-";
+        //or on first invalid char after valid ones, which is left unread.
         char numberBuf[20];
-        uint8_t val, numberLen;
-
-        while(1) {
-            //calculate remaining time
-            TickType_t elapsedTime = xTaskGetTickCount() - startTime;
-            if(elapsedTime > timeoutTicks) { //timeout
-                _buf.clear();
-                return 0.0f;
-            }
-            TickType_t remainingTime = timeoutTicks - elapsedTime;
-
-            if(validNumber) {
-                if(uart_read_bytes(_uart, &val, 1, remainingTime) != 1) { //timeout
-                    numberLen = _buf.read((uint8_t*) numberBuf, 20);
-                    if(numberLen == 20) {
-                        _buf.clear();
-                        return 0.0f;
-                    } else {numberBuf[numberLen] = '\0';}
-
-                    break; //go to evaluation
-                }
-                //check if char is valid
-                if(strchr(validChars, val)) {
-                    //store in ringbuffer
-                    _buf.write(&val, 1);
-                    if(val == '.') { // all remaining chars can only be digits
-                        validChars[10] = '\0';
-                    }
-                } else { //invalid digit after valid one(s)
-                    //transfer valid chars from ringbuffer to numberBuf
-                    numberLen = _buf.read((uint8_t*) numberBuf, 20);
-                    if(numberLen == 20) {
-                        _buf.clear();
-                        _buf.write(&val, 1);
-                        return 0.0f;
-                    } else {numberBuf[numberLen] = '\0';}
-                    //store invalid digit in ringbuffer
-                    _buf.write(&val, 1);
-                    //proceed to evaluation
-                    break;
-                }
-            } else {
-                //look for first occurrence of a valid char
-                if(uart_read_bytes(_uart, &val, 1, remainingTime) != 1) { //timeout
-                    return 0.0f;
-                }
-                //check if char is valid
-                if(strchr(validChars, val)) {
-                    //store in ringbuffer
-                    _buf.write(&val, 1);
-                    if(val == '.') { //first character was a dot, remaining ones can only be digits
-                        validChars[10] = '\0';
-                    } else {
-                        validChars[11] = '\0'; //remaining ones can be digits or dot
-                    }
-                    validNumber = true;
-                }
-            }
-        }
-        //turn valid characters into 'float' variable
+        if(readNumber(numberBuf, sizeof(numberBuf), true) == 0) return 0.0f;
         return strtof(numberBuf, NULL);
     }
 
     void flush() override {
+        AppGuard guard(*this);
+        uart_wait_tx_done(_uart, pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT));
+    }
+
+    bool setBaudRate(uint32_t baud) override {
+        AppGuard guard(*this);
         uart_wait_tx_done(_uart, pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT));
+        if(uart_set_baudrate(_uart, baud) != ESP_OK) return false;
+        // drop whatever was received around the change
+        uart_flush_input(_uart);
+        if(!inRxContext()) {
+            uint8_t chunk[A76XX_SERIAL_RX_CHUNK];
+            while(xStreamBufferReceive(_rx_stream, chunk, sizeof(chunk), 0) > 0) {}
+        }
+        _buf.clear();
+        return true;
+    }
+
+    uint32_t getBaudRate() override {
+        uint32_t baud = 0;
+        if(uart_get_baudrate(_uart, &baud) != ESP_OK) return 0;
+        return baud;
+    }
+
+    /*
+        @brief Enable or disable RTS/CTS flow control on the UART. The RTS and CTS
+            pins must have been set with uart_set_pin.
+    */
+    bool setHardwareFlowControl(bool enable) override {
+        AppGuard guard(*this);
+        return uart_set_hw_flow_ctrl(_uart,
+                                     enable ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE,
+                                     122) == ESP_OK;
     }
 
     int peek() override {
+        AppGuard guard(*this);
         uint8_t val;
-        //first, peek into ringbuffer if it contains data
-        if(_buf.peek(&val)) return val;
-        //if it doesn't, transfer one byte from UART input buffer to ringbuffer
-        if(uart_read_bytes(_uart, &val, 1, 0) != 1) return -1;
-        _buf.write(&val, 1);
+        if(!fill(0) || !_buf.peek(&val)) return -1;
         return val;
     }
 
     int read() override {
+        AppGuard guard(*this);
         uint8_t val;
-        if(_buf.getUsed() > 0) {
-            if(_buf.read(&val, 1) == 1) {
-                return val;
-            }
-        }
-
-        if(uart_read_bytes(_uart, (void*) &val, 1, 0) == 1) {
-            return val;
-        }
-        return -1;
+        if(!fill(0) || !_buf.pop(&val)) return -1;
+        return val;
     }
 
     bool find(char terminator) override {
-        //first, go fishing in the ringbuffer
-        char val;
-        while(_buf.pop((uint8_t*) &val)) {
-            if(val == terminator) {
-                return true;
-            }
-        }
-        //when ringbuffer empty, go to UART input buffer
-        while(uart_read_bytes(_uart, &val, 1, pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT)) == 1) {
-            if(val == terminator) {
-                return true;
+        AppGuard guard(*this);
+        uint8_t val;
+        while(fill(pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT))) {
+            while(_buf.pop(&val)) {
+                if(val == (uint8_t) terminator) {
+                    return true;
+                }
             }
         }
         //timeout
@@ -357,38 +505,37 @@ class ModemSerialESP : public ModemSerial {
     }
 
     size_t write(const char* data) override {
-        return uart_write_bytes(_uart, data, strlen(data));
+        return write(data, strlen(data));
     }
 
     size_t write(const char* data, size_t size) override {
-        return uart_write_bytes(_uart, data, size);
+        AppGuard guard(*this);
+        int written = uart_write_bytes(_uart, data, size);
+        if(written <= 0) return 0;
+        traceTx((const uint8_t*) data, written);
+        return written;
     }
 
     size_t readBytesUntil(char terminator, char* buf, int len) override {
-        //first, fetch from ringbuffer
-        char val;
+        AppGuard guard(*this);
+        uint8_t val;
         size_t writeLen = 0;
-        while(_buf.pop((uint8_t*) &val)) {
-            if(val == terminator) {
-                return writeLen;
-            }
-            //save value to buffer
-            buf[writeLen++] = val;
-            if(writeLen == len) return len;
-        }
-        //now, fetch from UART input buffer
-        while(uart_read_bytes(_uart, &val, 1, pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT)) == 1) {
-            if(val == terminator) {
-                return writeLen;
+        while(fill(pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT))) {
+            while(_buf.pop(&val)) {
+                if(val == (uint8_t) terminator) {
+                    return writeLen;
+                }
+                //save value to buffer
+                buf[writeLen++] = val;
+                if(writeLen == (size_t) len) return len;
             }
-            buf[writeLen++] = val;
-            if(writeLen == len) return len;
         }
         //timeout
         return 0;
     }
 
     size_t readBytes(void* buf, int len) override {
+        AppGuard guard(*this);
         //first, use data left in ringbuffer
         size_t ringDataLen = _buf.getUsed();
         size_t readLen = 0;
@@ -396,15 +543,26 @@ class ModemSerialESP : public ModemSerial {
             readLen = _buf.read((uint8_t*) buf, len);
             if(readLen == len) return readLen;
         }
-        //read remaining data directly from UART
-        size_t readLen2 = uart_read_bytes(_uart, (uint8_t*)buf+readLen, len-readLen, pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT));
-        if(readLen2 > 0) readLen += readLen2;
+        //read remaining data directly from UART, in a single call
+        if(inRxContext()) {
+            int readLen2 = uart_read_bytes(_uart, (uint8_t*)buf+readLen, len-readLen, pdMS_TO_TICKS(A76XX_SERIAL_TIMEOUT_DEFAULT));
+            if(readLen2 > 0) {
+                traceRx((const uint8_t*) buf + readLen, readLen2);
+                readLen += readLen2;
+            }
+            return readLen;
+        }
+        //or from the RX task, which has traced it already
+        TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+        while(readLen < (size_t) len && !tc.expired()) {
+            readLen += xStreamBufferReceive(_rx_stream, (uint8_t*)buf+readLen, len-readLen, pdMS_TO_TICKS(tc.remaining()));
+        }
         return readLen;
     }
 };
 
 
 
-#endif /* !defined(ARDUINO) */
+#endif /* !defined(ARDUINO) && defined(ESP_PLATFORM) */
 
 #endif /* A76XX_MODEMUART_ESP_H_ */
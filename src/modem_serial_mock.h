@@ -0,0 +1,511 @@
+#ifndef A76XX_MODEMUART_MOCK_H_
+#define A76XX_MODEMUART_MOCK_H_
+
+#if !defined(ARDUINO) && !defined(ESP_PLATFORM)
+
+#include "modem_serial.h"
+#include "modem_serial_posix.h"
+
+#include <stdlib.h>
+
+#ifndef A76XX_MOCK_MAX_STEPS
+    /* Maximum number of steps in the transcript of a ModemSerialMock */
+    #define A76XX_MOCK_MAX_STEPS 64
+#endif
+
+/*
+    @brief A ModemSerial that replays a transcript instead of talking to a module.
+
+    @details The transcript is a sequence of steps. A TX step is a string that the
+        library is expected to write, e.g. "AT+CSQ\r\n". An RX step is a string the
+        module sends, e.g. "\r\n+CSQ: 23,99\r\n\r\nOK\r\n", or a URC. RX steps are
+        delivered in order, but only once all TX steps before them have been
+        written, after an optional delay and with an optional delay between bytes.
+        Changes of the baud rate or the flow control of the host side are steps
+        as well, ordered with the TX steps.
+
+        Waiting for data is done with delay, so with A76XX_VIRTUAL_CLOCK defined no
+        real time passes and a transcript can be replayed thousands of times per
+        second. The strings are not copied and must outlive the mock.
+
+        Example:
+
+            ModemSerialMock mock;
+            mock.tx("AT+CSQ\r\n");
+            mock.rx("\r\n+CSQ: 23,99\r\n\r\nOK\r\n", 20);
+            A76XX modem(mock);
+            ...
+            if (!mock.done()) printf("%s\n", mock.error());
+*/
+class ModemSerialMock final : public ModemSerial {
+  private:
+    enum Setting : uint8_t {
+        SETTING_NONE,
+        SETTING_BAUD_RATE,
+        SETTING_FLOW_CONTROL
+    };
+
+    struct Step {
+        bool        is_tx;
+        const char* data;
+        size_t      len;
+        uint32_t    delay_ms;
+        uint32_t    byte_delay_ms;
+        Setting     setting;       // for a TX step, a change of the host side instead of data
+        uint32_t    value;
+        bool        accepted;      // whether the host side supports the change
+    };
+
+    Step     _steps[A76XX_MOCK_MAX_STEPS];
+    uint16_t _num_steps;
+
+    uint16_t _tx_step;     // next TX step to be matched
+    size_t   _tx_pos;      // bytes of _tx_step matched so far
+    uint16_t _rx_step;     // next RX step to be delivered
+    size_t   _rx_pos;      // bytes of _rx_step delivered so far
+    bool     _rx_armed;    // whether _rx_next is valid for _rx_step
+    uint32_t _rx_next;     // time at which the next RX byte becomes available
+    uint32_t _baud;        // rate of the host side, 0 until set by a step
+    bool     _failed;
+    char     _error[96];
+
+    bool addStep(bool is_tx, const char* data, size_t len, uint32_t delay_ms, uint32_t byte_delay_ms,
+                 Setting setting = SETTING_NONE, uint32_t value = 0, bool accepted = false) {
+        if (_num_steps == A76XX_MOCK_MAX_STEPS) {
+            return false;
+        }
+        _steps[_num_steps++] = {is_tx, data, len, delay_ms, byte_delay_ms, setting, value, accepted};
+        if (!is_tx) {
+            arm();
+        }
+        return true;
+    }
+
+    // skip steps of the other kind
+    uint16_t nextStep(uint16_t i, bool is_tx) {
+        while (i < _num_steps && _steps[i].is_tx != is_tx) {
+            i++;
+        }
+        return i;
+    }
+
+    /*
+        @brief Start the clock of the current RX step once it is allowed to be sent,
+            i.e. when all TX steps before it have been matched.
+    */
+    void arm() {
+        _rx_step = nextStep(_rx_step, false);
+        if (_rx_armed || _failed || _rx_step == _num_steps) {
+            return;
+        }
+        if (nextStep(_tx_step, true) < _rx_step) {
+            return;
+        }
+        _rx_armed = true;
+        _rx_next = millis() + _steps[_rx_step].delay_ms;
+    }
+
+    void fail(const char* fmt, uint16_t step, int chr) {
+        if (!_failed) {
+            snprintf(_error, sizeof(_error), fmt, step, chr);
+            _failed = true;
+            _rx_armed = false;
+        }
+    }
+
+    /*
+        @brief Wait for the next scripted byte.
+
+        @param [IN] wait Milliseconds to wait if the byte is not available yet.
+        @return False if no byte is available within the given time, in which case
+            the whole wait time has elapsed.
+    */
+    bool fill(uint32_t wait) {
+        if (!_rx_armed) {
+            delay(wait);
+            return false;
+        }
+        uint32_t now = millis();
+        if ((int32_t) (_rx_next - now) <= 0) {
+            return true;
+        }
+        if (_rx_next - now > wait) {
+            delay(wait);
+            return false;
+        }
+        delay(_rx_next - now);
+        return true;
+    }
+
+    /*
+        @brief Match a change of the host side with the next TX step.
+
+        @return What the step says the host side does, false if it is not the next step.
+    */
+    bool applySetting(Setting setting, uint32_t value, const char* fmt) {
+        _tx_step = nextStep(_tx_step, true);
+        if (_tx_step == _num_steps || _tx_pos != 0
+                || _steps[_tx_step].setting != setting || _steps[_tx_step].value != value) {
+            fail(fmt, _tx_step, (int) value);
+            return false;
+        }
+        bool accepted = _steps[_tx_step].accepted;
+        _tx_step++;
+        arm();
+        return accepted;
+    }
+
+    // only call after fill returned true
+    uint8_t peekByte() {
+        return _steps[_rx_step].data[_rx_pos];
+    }
+
+    // only call after fill returned true
+    uint8_t popByte() {
+        const Step& step = _steps[_rx_step];
+        traceRx((const uint8_t*) step.data + _rx_pos, 1);
+        uint8_t val = step.data[_rx_pos++];
+        if (_rx_pos == step.len) {
+            _rx_step++;
+            _rx_pos = 0;
+            _rx_armed = false;
+            arm();
+        } else {
+            _rx_next = millis() + step.byte_delay_ms;
+        }
+        return val;
+    }
+
+    int timedPeek(TimeoutCalc& tc) {
+        if (!fill(tc.remaining())) return -1;
+        return peekByte();
+    }
+
+    /*
+        @brief Read the characters of a number into numberBuf.
+
+        @detail Ignores all invalid characters before the first valid one, then
+            stops, without consuming it, at the first invalid character, or on timeout.
+        @param [OUT] numberBuf Null terminated string with the valid characters.
+        @param [IN] len Size of numberBuf.
+        @param [IN] decimal Whether a decimal point is a valid character.
+        @return The number of valid characters found.
+    */
+    size_t readNumber(char* numberBuf, size_t len, bool decimal) {
+        TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+        size_t numberLen = 0;
+        bool seenDot = false;
+        int c;
+
+        //look for first occurrence of a valid char
+        while (1) {
+            c = timedPeek(tc);
+            if (c < 0) {
+                numberBuf[0] = '\0';
+                return 0;
+            }
+            if ((c >= '0' && c <= '9') || c == '-' || (decimal && c == '.')) break;
+            popByte();
+        }
+
+        //minus is only valid as first char, the dot only once
+        while (numberLen < len - 1) {
+            c = timedPeek(tc);
+            if (c < 0) break;
+            bool valid = (c >= '0' && c <= '9')
+                      || (c == '-' && numberLen == 0)
+                      || (decimal && c == '.' && !seenDot);
+            if (!valid) break;
+            if (c == '.') seenDot = true;
+            numberBuf[numberLen++] = c;
+            popByte();
+        }
+        numberBuf[numberLen] = '\0';
+        return numberLen;
+    }
+
+  public:
+    ModemSerialMock()
+        : _num_steps(0) {
+        rewind();
+    }
+
+    /*
+        @brief Append a TX step: the library must write exactly these bytes next.
+
+        @return False if the transcript is full: increase A76XX_MOCK_MAX_STEPS.
+    */
+    bool tx(const char* data) {
+        return addStep(true, data, strlen(data), 0, 0);
+    }
+
+    /*
+        @brief Append an RX step: bytes sent by the module, e.g. a response or a URC.
+
+        @param [IN] data The bytes to send.
+        @param [IN] delay_ms Delay before the first byte, counted from the time
+            the previous step has completed.
+        @param [IN] byte_delay_ms Delay between consecutive bytes.
+        @return False if the transcript is full: increase A76XX_MOCK_MAX_STEPS.
+    */
+    bool rx(const char* data, uint32_t delay_ms = 0, uint32_t byte_delay_ms = 0) {
+        return addStep(false, data, strlen(data), delay_ms, byte_delay_ms);
+    }
+
+    /*
+        @brief Append a step in which the library changes the baud rate of the host
+            side of the link, with ModemSerial::setBaudRate.
+
+        @param [IN] baud The rate to be set.
+        @param [IN] accepted Whether the host side supports the rate, which is
+            returned by setBaudRate and then by getBaudRate.
+        @return False if the transcript is full: increase A76XX_MOCK_MAX_STEPS.
+    */
+    bool baudRate(uint32_t baud, bool accepted = true) {
+        return addStep(true, "", 0, 0, 0, SETTING_BAUD_RATE, baud, accepted);
+    }
+
+    /*
+        @brief Append a step in which the library enables or disables RTS/CTS flow
+            control on the host side, with ModemSerial::setHardwareFlowControl.
+
+        @param [IN] enable Whether flow control is to be enabled.
+        @param [IN] accepted Whether the host side supports it.
+        @return False if the transcript is full: increase A76XX_MOCK_MAX_STEPS.
+    */
+    bool hardwareFlowControl(bool enable, bool accepted = true) {
+        return addStep(true, "", 0, 0, 0, SETTING_FLOW_CONTROL, enable, accepted);
+    }
+
+    /*
+        @brief Append the steps of a capture recorded with SerialCapture, e.g. to
+            reproduce a problem seen in the field, or to benchmark the parsers
+            with real traffic.
+
+        @detail Each record received becomes an RX step, delayed by the time
+            elapsed since the previous record, so that with A76XX_VIRTUAL_CLOCK
+            the replay is deterministic. Each record sent becomes a TX step, so
+            that the application must issue the same commands as in the capture,
+            unless `expect_tx` is false, in which case the data received is
+            replayed regardless of what is written. The capture is not copied
+            and must outlive the mock. Long captures need a larger
+            A76XX_MOCK_MAX_STEPS.
+        @param [IN] capture The capture, as written by SerialCapture::dump.
+        @param [IN] len The length of the capture.
+        @param [IN] expect_tx Whether the data sent must match the capture.
+        @return False if the capture is not valid, or does not fit in the transcript.
+    */
+    bool replay(const uint8_t* capture, size_t len, bool expect_tx = true) {
+        CaptureReader reader(capture, len);
+        if (!reader.valid()) {
+            return false;
+        }
+        CaptureRecord_t rec;
+        bool first = true;
+        uint32_t last_ms = 0;
+        while (reader.next(rec)) {
+            uint32_t delay_ms = first ? 0 : rec.time_ms - last_ms;
+            first = false;
+            last_ms = rec.time_ms;
+            if (rec.tx && !expect_tx) {
+                continue;
+            }
+            if (!addStep(rec.tx, (const char*) rec.data, rec.len, rec.tx ? 0 : delay_ms, 0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+        @brief Remove all steps.
+    */
+    void clearSteps() {
+        _num_steps = 0;
+        rewind();
+    }
+
+    /*
+        @brief Start replaying the transcript again from the first step.
+    */
+    void rewind() {
+        _tx_step = 0;
+        _tx_pos = 0;
+        _rx_step = 0;
+        _rx_pos = 0;
+        _rx_armed = false;
+        _baud = 0;
+        _failed = false;
+        _error[0] = '\0';
+        arm();
+    }
+
+    /*
+        @brief Whether the whole transcript has been replayed without errors.
+    */
+    bool done() {
+        if (_failed) {
+            return false;
+        }
+        if (nextStep(_tx_step, true) < _num_steps || nextStep(_rx_step, false) < _num_steps) {
+            snprintf(_error, sizeof(_error), "transcript not completed: next TX step %u, next RX step %u",
+                     nextStep(_tx_step, true), nextStep(_rx_step, false));
+            return false;
+        }
+        return true;
+    }
+
+    /*
+        @brief Describe the first error found, e.g. an unexpected byte written.
+    */
+    const char* error() {
+        return _error;
+    }
+
+    // the overloads with fewer match strings, hidden by the override below
+    using ModemSerial::waitResponse;
+
+    Response_t waitResponse(const char* match_1,
+                            const char* match_2,
+                            const char* match_3,
+                            uint32_t timeout = 1000,
+                            bool match_OK = true,
+                            bool match_ERROR = true) override {
+
+        const char* cmp_str[5] = {
+                match_1,
+                match_2,
+                match_3,
+                match_OK ? RESPONSE_OK : NULL,
+                match_ERROR ? RESPONSE_ERROR : NULL
+        };
+        compileMatcher(cmp_str);
+        TimeoutCalc tc(waitTimeout(timeout, cmp_str));
+
+        Response_t rsp;
+        while (!tc.expired()) {
+            if (!fill(tc.remaining())) {
+                break;
+            }
+            if (matchByte(popByte(), cmp_str, rsp)) {
+                return rsp;
+            }
+        }
+        return timeoutResponse();
+    }
+
+    bool waitAvailable(uint32_t timeout) override {
+        return fill(timeout);
+    }
+
+    int readLine(char* buf, size_t size, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT) override {
+        return readLineFrom(*this, buf, size, timeout);
+    }
+
+    int available() override {
+        if (!_rx_armed || (int32_t) (_rx_next - millis()) > 0) {
+            return 0;
+        }
+        return _steps[_rx_step].len - _rx_pos;
+    }
+
+    long parseInt() override {
+        char numberBuf[20];
+        if (readNumber(numberBuf, sizeof(numberBuf), false) == 0) return 0L;
+        return strtol(numberBuf, NULL, 10);
+    }
+
+    float parseFloat() override {
+        char numberBuf[20];
+        if (readNumber(numberBuf, sizeof(numberBuf), true) == 0) return 0.0f;
+        return strtof(numberBuf, NULL);
+    }
+
+    void flush() override {}
+
+    bool setBaudRate(uint32_t baud) override {
+        if (!applySetting(SETTING_BAUD_RATE, baud, "unexpected baud rate in step %u: %d")) {
+            return false;
+        }
+        _baud = baud;
+        return true;
+    }
+
+    uint32_t getBaudRate() override {
+        return _baud;
+    }
+
+    bool setHardwareFlowControl(bool enable) override {
+        return applySetting(SETTING_FLOW_CONTROL, enable, "unexpected flow control in step %u: %d");
+    }
+
+    int peek() override {
+        if (!fill(0)) return -1;
+        return peekByte();
+    }
+
+    int read() override {
+        if (!fill(0)) return -1;
+        return popByte();
+    }
+
+    bool find(char terminator) override {
+        while (fill(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+            if (popByte() == (uint8_t) terminator) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t write(const char* data) override {
+        return write(data, strlen(data));
+    }
+
+    size_t write(const char* data, size_t size) override {
+        traceTx((const uint8_t*) data, size);
+        for (size_t i = 0; i < size; i++) {
+            _tx_step = nextStep(_tx_step, true);
+            if (_tx_step == _num_steps) {
+                fail("unexpected TX after the last step (%u): 0x%02x", _tx_step, (uint8_t) data[i]);
+                return size;
+            }
+            const Step& step = _steps[_tx_step];
+            if (step.setting != SETTING_NONE || step.data[_tx_pos] != data[i]) {
+                fail("unexpected TX in step %u: 0x%02x", _tx_step, (uint8_t) data[i]);
+                return size;
+            }
+            if (++_tx_pos == step.len) {
+                _tx_step++;
+                _tx_pos = 0;
+                arm();
+            }
+        }
+        return size;
+    }
+
+    size_t readBytesUntil(char terminator, char* buf, int len) override {
+        size_t writeLen = 0;
+        while (fill(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+            uint8_t val = popByte();
+            if (val == (uint8_t) terminator) {
+                return writeLen;
+            }
+            buf[writeLen++] = val;
+            if (writeLen == (size_t) len) return len;
+        }
+        return 0;
+    }
+
+    size_t readBytes(void* buf, int len) override {
+        size_t readLen = 0;
+        while (readLen < (size_t) len && fill(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+            ((uint8_t*) buf)[readLen++] = popByte();
+        }
+        return readLen;
+    }
+};
+
+#endif /* !defined(ARDUINO) && !defined(ESP_PLATFORM) */
+
+#endif /* A76XX_MODEMUART_MOCK_H_ */
@@ -0,0 +1,480 @@
+#ifndef A76XX_MODEMUART_POSIX_H_
+#define A76XX_MODEMUART_POSIX_H_
+
+#if !defined(ARDUINO) && !defined(ESP_PLATFORM)
+
+#include "modem_serial.h"
+#include "utils/byteringbuf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#ifdef A76XX_VIRTUAL_CLOCK
+
+/*
+    With A76XX_VIRTUAL_CLOCK defined, time only moves forward when delay is called,
+    e.g. by ModemSerialMock while waiting for scripted data. Timeouts then expire
+    instantly and tests run as fast as the CPU allows.
+*/
+inline uint32_t& virtualMillis() {
+    static uint32_t ms = 0;
+    return ms;
+}
+
+inline uint32_t millis() {
+    return virtualMillis();
+}
+
+inline void delay(unsigned long ms) {
+    virtualMillis() += ms;
+}
+
+#else
+
+inline uint32_t millis() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000UL + ts.tv_nsec / 1000000UL);
+}
+
+inline void delay(unsigned long ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000L;
+    while(nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+#endif /* A76XX_VIRTUAL_CLOCK */
+
+class TimeoutCalc {
+public:
+    // milliseconds since an arbitrary origin
+    static uint32_t now() {
+        return millis();
+    }
+
+    TimeoutCalc(uint32_t timeoutMs) {
+        _start = millis();
+        _duration = timeoutMs;
+    }
+    bool expired(void) {
+        return(!(millis() - _start < _duration));
+    }
+    uint32_t remaining(void) {
+        uint32_t elapsed = millis() - _start;
+        return elapsed < _duration ? _duration - elapsed : 0;
+    }
+
+private:
+    uint32_t _start;
+    uint32_t _duration;
+};
+
+class ModemSerialPosix final : public ModemSerial {
+  private:
+    int _fd;
+    bool _owns_fd;
+    ByteRingBuf<A76XX_SERIAL_RX_BUFFER_SIZE> _buf;
+
+    /*
+        @brief Map a baud rate to the corresponding termios constant.
+
+        @return The speed_t constant, or B0 if the rate is not supported.
+    */
+    static speed_t baudToSpeed(uint32_t baud) {
+        switch(baud) {
+            case 9600:    return B9600;
+            case 19200:   return B19200;
+            case 38400:   return B38400;
+            case 57600:   return B57600;
+            case 115200:  return B115200;
+            case 230400:  return B230400;
+#ifdef B460800
+            case 460800:  return B460800;
+#endif
+#ifdef B921600
+            case 921600:  return B921600;
+#endif
+#ifdef B1000000
+            case 1000000: return B1000000;
+#endif
+#ifdef B1500000
+            case 1500000: return B1500000;
+#endif
+#ifdef B2000000
+            case 2000000: return B2000000;
+#endif
+#ifdef B3000000
+            case 3000000: return B3000000;
+#endif
+#ifdef B3686400
+            case 3686400: return B3686400;
+#endif
+#ifdef B4000000
+            case 4000000: return B4000000;
+#endif
+            default:      return B0;
+        }
+    }
+
+    /*
+        @brief Stage data from the file descriptor in the ringbuffer.
+
+        @detail All read functions consume data from the ringbuffer. When it runs
+            empty, up to A76XX_SERIAL_RX_CHUNK bytes are moved to it with a single
+            read, so that the number of system calls stays low at high baud rates.
+        @param [IN] wait Milliseconds to wait for at least one byte if nothing is buffered.
+        @return False if no data is available within the given time.
+    */
+    bool fill(uint32_t wait) {
+        if(_buf.getUsed() > 0) return true;
+        if(_fd < 0) return false;
+
+        struct pollfd pfd = {_fd, POLLIN, 0};
+        TimeoutCalc tc(wait);
+        while(1) {
+            int ret = ::poll(&pfd, 1, (int) tc.remaining());
+            if(ret < 0 && errno == EINTR) continue;
+            if(ret <= 0) return false;
+
+            uint8_t chunk[A76XX_SERIAL_RX_CHUNK];
+            ssize_t readLen = ::read(_fd, chunk, sizeof(chunk));
+            if(readLen > 0) {
+                _buf.write(chunk, readLen);
+                traceRx(chunk, readLen);
+                return true;
+            }
+            //a terminal with VMIN = VTIME = 0 returns 0 when no data is available
+            if(readLen < 0 && errno != EAGAIN && errno != EINTR) return false;
+            if(tc.expired()) return false;
+        }
+    }
+
+    int timedPeek(TimeoutCalc& tc) {
+        uint8_t val;
+        if(!fill(tc.remaining()) || !_buf.peek(&val)) return -1;
+        return val;
+    }
+
+    /*
+        @brief Read the characters of a number into numberBuf.
+
+        @detail Ignores all invalid characters before the first valid one, then
+            stops, without consuming it, at the first invalid character, or on timeout.
+        @param [OUT] numberBuf Null terminated string with the valid characters.
+        @param [IN] len Size of numberBuf.
+        @param [IN] decimal Whether a decimal point is a valid character.
+        @return The number of valid characters found.
+    */
+    size_t readNumber(char* numberBuf, size_t len, bool decimal) {
+        TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+        size_t numberLen = 0;
+        bool seenDot = false;
+        int c;
+
+        //look for first occurrence of a valid char
+        while(1) {
+            c = timedPeek(tc);
+            if(c < 0) {
+                numberBuf[0] = '\0';
+                return 0;
+            }
+            if((c >= '0' && c <= '9') || c == '-' || (decimal && c == '.')) break;
+            _buf.consume(1);
+        }
+
+        //minus is only valid as first char, the dot only once
+        while(numberLen < len - 1) {
+            c = timedPeek(tc);
+            if(c < 0) break;
+            bool valid = (c >= '0' && c <= '9')
+                      || (c == '-' && numberLen == 0)
+                      || (decimal && c == '.' && !seenDot);
+            if(!valid) break;
+            if(c == '.') seenDot = true;
+            numberBuf[numberLen++] = c;
+            _buf.consume(1);
+        }
+        numberBuf[numberLen] = '\0';
+        return numberLen;
+    }
+
+  public:
+    /*
+        @brief Construct a ModemSerial object on an open file descriptor.
+
+        @details The descriptor, e.g. a serial port or a pseudo-terminal, is
+            configured by the caller and is not closed by the destructor. It is
+            switched to non-blocking mode, timeouts are handled with poll().
+
+        @param [IN] fd The file descriptor connected to the module.
+    */
+    ModemSerialPosix(int fd)
+        : _fd(fd), _owns_fd(false) {
+        int flags = fcntl(_fd, F_GETFL);
+        if(flags >= 0) fcntl(_fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    /*
+        @brief Construct a ModemSerial object on a serial device, e.g. /dev/ttyUSB2.
+
+        @details The device is opened and configured in raw mode, 8N1, with the
+            given baud rate and no flow control. Use ::isOpen to check whether
+            this succeeded.
+
+        @param [IN] device Path to the serial device.
+        @param [IN] baud The baud rate, e.g. 115200 or 921600.
+    */
+    ModemSerialPosix(const char* device, uint32_t baud = 115200)
+        : _fd(-1), _owns_fd(true) {
+        speed_t speed = baudToSpeed(baud);
+        if(speed == B0) return;
+
+        int fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if(fd < 0) return;
+
+        struct termios tty;
+        if(tcgetattr(fd, &tty) != 0) {
+            close(fd);
+            return;
+        }
+        cfmakeraw(&tty);
+        tty.c_cflag |= CLOCAL | CREAD;
+        tty.c_cflag &= ~(CSTOPB | CRTSCTS);
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 0;
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+        if(tcsetattr(fd, TCSANOW, &tty) != 0) {
+            close(fd);
+            return;
+        }
+        tcflush(fd, TCIOFLUSH);
+        _fd = fd;
+    }
+
+    ~ModemSerialPosix() {
+        if(_owns_fd && _fd >= 0) close(_fd);
+    }
+
+    /*
+        @brief Whether the underlying file descriptor is valid.
+    */
+    bool isOpen() {
+        return _fd >= 0;
+    }
+
+    // the overloads with fewer match strings, hidden by the override below
+    using ModemSerial::waitResponse;
+
+    Response_t waitResponse(const char* match_1,
+                            const char* match_2,
+                            const char* match_3,
+                            uint32_t timeout = 1000,
+                            bool match_OK = true,
+                            bool match_ERROR = true) override {
+
+        const char* cmp_str[5] = {
+                match_1,
+                match_2,
+                match_3,
+                match_OK ? RESPONSE_OK : NULL,
+                match_ERROR ? RESPONSE_ERROR : NULL
+        };
+        compileMatcher(cmp_str);
+        TimeoutCalc tc(waitTimeout(timeout, cmp_str));
+
+        Response_t rsp;
+        uint8_t val;
+
+        while(1) {
+            if(!_buf.pop(&val)) {
+                //stage whatever the device has, waiting for the remaining time
+                if(tc.expired() || !fill(tc.remaining())) {
+                    return timeoutResponse();
+                }
+                continue;
+            }
+
+            //final responses and URCs are all found by the same automaton
+            if(matchByte(val, cmp_str, rsp)) {
+                return rsp;
+            }
+        }
+        return A76XX_RESPONSE_TIMEOUT; //execution won't reach here
+    }
+
+    bool waitAvailable(uint32_t timeout) override {
+        return fill(timeout);
+    }
+
+    int readLine(char* buf, size_t size, uint32_t timeout = A76XX_SERIAL_TIMEOUT_DEFAULT) override {
+        return readLineFrom(*this, buf, size, timeout);
+    }
+
+    int available() override {
+        int availBytes = 0;
+        if(_fd < 0 || ioctl(_fd, FIONREAD, &availBytes) != 0) {
+            availBytes = 0;
+        }
+        return availBytes + _buf.getUsed();
+    }
+
+    /*
+        @brief Number of received bytes lost because the receive buffer was full.
+    */
+    size_t rxOverflows() override {
+        return _buf.overflows();
+    }
+
+    long parseInt() override {
+        //returns on timeout (and evaluates all valid chars up until then)
+        //or on first invalid char after valid ones, which is left unread.
+        char numberBuf[20];
+        if(readNumber(numberBuf, sizeof(numberBuf), false) == 0) return 0L;
+        return strtol(numberBuf, NULL, 10);
+    }
+
+    float parseFloat() override {
+        //returns on timeout (and evaluates all valid chars up until then)
+        //or on first invalid char after valid ones, which is left unread.
+        char numberBuf[20];
+        if(readNumber(numberBuf, sizeof(numberBuf), true) == 0) return 0.0f;
+        return strtof(numberBuf, NULL);
+    }
+
+    void flush() override {
+        if(_fd >= 0) tcdrain(_fd);
+    }
+
+    bool setBaudRate(uint32_t baud) override {
+        speed_t speed = baudToSpeed(baud);
+        struct termios tty;
+        if(_fd < 0 || speed == B0 || tcgetattr(_fd, &tty) != 0) return false;
+        tcdrain(_fd);
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+        if(tcsetattr(_fd, TCSANOW, &tty) != 0) return false;
+        // drop whatever was received around the change
+        tcflush(_fd, TCIFLUSH);
+        _buf.clear();
+        return true;
+    }
+
+    uint32_t getBaudRate() override {
+        static const uint32_t rates[] = {9600, 19200, 38400, 57600, 115200, 230400, 460800,
+                                         921600, 1000000, 1500000, 2000000, 3000000, 3686400, 4000000};
+        struct termios tty;
+        if(_fd < 0 || tcgetattr(_fd, &tty) != 0) return 0;
+        speed_t speed = cfgetospeed(&tty);
+        for(size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+            if(baudToSpeed(rates[i]) == speed) return rates[i];
+        }
+        return 0;
+    }
+
+    bool setHardwareFlowControl(bool enable) override {
+        struct termios tty;
+        if(_fd < 0 || tcgetattr(_fd, &tty) != 0) return false;
+        if(enable) {
+            tty.c_cflag |= CRTSCTS;
+        } else {
+            tty.c_cflag &= ~CRTSCTS;
+        }
+        return tcsetattr(_fd, TCSANOW, &tty) == 0;
+    }
+
+    int peek() override {
+        uint8_t val;
+        if(!fill(0) || !_buf.peek(&val)) return -1;
+        return val;
+    }
+
+    int read() override {
+        uint8_t val;
+        if(!fill(0) || !_buf.pop(&val)) return -1;
+        return val;
+    }
+
+    bool find(char terminator) override {
+        uint8_t val;
+        while(fill(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+            while(_buf.pop(&val)) {
+                if(val == (uint8_t) terminator) {
+                    return true;
+                }
+            }
+        }
+        //timeout
+        return false;
+    }
+
+    size_t write(const char* data) override {
+        return write(data, strlen(data));
+    }
+
+    size_t write(const char* data, size_t size) override {
+        //the descriptor is non-blocking: wait for room when the kernel buffer is full
+        size_t written = 0;
+        TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+        while(_fd >= 0 && written < size) {
+            ssize_t ret = ::write(_fd, data + written, size - written);
+            if(ret > 0) {
+                written += ret;
+                continue;
+            }
+            if(ret < 0 && errno == EINTR) continue;
+            if(ret < 0 && errno != EAGAIN) break;
+            struct pollfd pfd = {_fd, POLLOUT, 0};
+            if(tc.expired() || ::poll(&pfd, 1, (int) tc.remaining()) <= 0) break;
+        }
+        traceTx((const uint8_t*) data, written);
+        return written;
+    }
+
+    size_t readBytesUntil(char terminator, char* buf, int len) override {
+        uint8_t val;
+        size_t writeLen = 0;
+        while(fill(A76XX_SERIAL_TIMEOUT_DEFAULT)) {
+            while(_buf.pop(&val)) {
+                if(val == (uint8_t) terminator) {
+                    return writeLen;
+                }
+                //save value to buffer
+                buf[writeLen++] = val;
+                if(writeLen == (size_t) len) return len;
+            }
+        }
+        //timeout
+        return 0;
+    }
+
+    size_t readBytes(void* buf, int len) override {
+        //first, use data left in ringbuffer
+        size_t readLen = _buf.read((uint8_t*) buf, len);
+
+        //read remaining data directly from the descriptor, without staging it
+        TimeoutCalc tc(A76XX_SERIAL_TIMEOUT_DEFAULT);
+        struct pollfd pfd = {_fd, POLLIN, 0};
+        while(_fd >= 0 && readLen < (size_t) len) {
+            ssize_t ret = ::read(_fd, (uint8_t*) buf + readLen, len - readLen);
+            if(ret > 0) {
+                traceRx((const uint8_t*) buf + readLen, ret);
+                readLen += ret;
+                continue;
+            }
+            if(ret < 0 && errno != EAGAIN && errno != EINTR) break;
+            if(tc.expired() || ::poll(&pfd, 1, (int) tc.remaining()) <= 0) break;
+        }
+        return readLen;
+    }
+};
+
+#endif /* !defined(ARDUINO) && !defined(ESP_PLATFORM) */
+
+#endif /* A76XX_MODEMUART_POSIX_H_ */
@@ -0,0 +1,248 @@
+#include "A76XX.h"
+
+PPPSession::PPPSession(ModemSerial& serial)
+    : _serial(serial)
+    , _v25ter(serial)
+    , _online(false) {}
+
+int8_t PPPSession::dial(const char* number, uint32_t timeout) {
+    if (_online) {
+        return A76XX_OPERATION_SUCCEEDED;
+    }
+    int8_t retcode = _v25ter.dialData(number, timeout);
+    A76XX_RETCODE_ASSERT_RETURN(retcode)
+    _online = true;
+    return A76XX_OPERATION_SUCCEEDED;
+}
+
+int8_t PPPSession::suspend(uint32_t guard_ms) {
+    if (!_online) {
+        return A76XX_OPERATION_SUCCEEDED;
+    }
+    int8_t retcode = _v25ter.escapeDataMode(guard_ms);
+    A76XX_RETCODE_ASSERT_RETURN(retcode)
+    _online = false;
+    return A76XX_OPERATION_SUCCEEDED;
+}
+
+int8_t PPPSession::resume(uint32_t timeout) {
+    if (_online) {
+        return A76XX_OPERATION_SUCCEEDED;
+    }
+    int8_t retcode = _v25ter.resumeDataMode(timeout);
+    A76XX_RETCODE_ASSERT_RETURN(retcode)
+    _online = true;
+    return A76XX_OPERATION_SUCCEEDED;
+}
+
+int8_t PPPSession::hangUp(uint32_t guard_ms) {
+    int8_t retcode = suspend(guard_ms);
+    A76XX_RETCODE_ASSERT_RETURN(retcode)
+    return _v25ter.hangUp();
+}
+
+size_t PPPSession::read(uint8_t* buf, size_t len, uint32_t wait) {
+    if (!_online || len == 0 || !_serial.waitAvailable(wait)) {
+        return 0;
+    }
+    // only read what has arrived, so that the IP stack gets it straight away
+    int avail = _serial.available();
+    if (avail <= 0) {
+        return 0;
+    }
+    return _serial.readBytes(buf, (size_t) avail < len ? avail : len);
+}
+
+size_t PPPSession::write(const uint8_t* data, size_t len) {
+    if (!_online) {
+        return 0;
+    }
+    return _serial.write((const char*) data, len);
+}
+
+#if !defined(ARDUINO) && defined(ESP_PLATFORM) && defined(CONFIG_LWIP_PPP_SUPPORT)
+
+PPPLwIP::PPPLwIP(PPPSession& session)
+    : _session(session)
+    , _pcb(NULL)
+    , _rx_task(NULL)
+    , _running(false)
+    , _up(false)
+    , _dead(true)
+    , _last_error(0) {}
+
+bool PPPLwIP::begin(UBaseType_t priority, uint32_t stack_size) {
+    if (_pcb != NULL) {
+        return true;
+    }
+    if (!_session.isOnline()) {
+        return false;
+    }
+    _pcb = pppapi_pppos_create(&_netif, output, status, this);
+    if (_pcb == NULL) {
+        return false;
+    }
+    _running = true;
+    if (xTaskCreate(rxTask, "A76XX_PPP", stack_size, this, priority, &_rx_task) != pdPASS) {
+        _running = false;
+        pppapi_free(_pcb);
+        _pcb = NULL;
+        return false;
+    }
+    _dead = false;
+    pppapi_set_default(_pcb);
+    pppapi_connect(_pcb, 0);
+    return true;
+}
+
+void PPPLwIP::end(uint32_t timeout) {
+    if (_pcb == NULL) {
+        return;
+    }
+    // terminate PPP while the task still feeds lwIP the answers of the peer
+    pppapi_close(_pcb, 0);
+    TimeoutCalc tc(timeout);
+    while (!_dead && !tc.expired()) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    _running = false;
+    while (_rx_task != NULL) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    pppapi_free(_pcb);
+    _pcb = NULL;
+    _up = false;
+}
+
+u32_t PPPLwIP::output(ppp_pcb* pcb, const void* data, u32_t len, void* ctx) {
+    PPPLwIP* self = (PPPLwIP*) ctx;
+    return self->_session.write((const uint8_t*) data, len);
+}
+
+void PPPLwIP::status(ppp_pcb* pcb, int err_code, void* ctx) {
+    PPPLwIP* self = (PPPLwIP*) ctx;
+    self->_last_error = err_code;
+    self->_up = err_code == PPPERR_NONE;
+    // lwIP reports any error once PPP has terminated
+    self->_dead = err_code != PPPERR_NONE;
+}
+
+void PPPLwIP::rxTask(void* arg) {
+    PPPLwIP* self = (PPPLwIP*) arg;
+    uint8_t buf[A76XX_PPP_CHUNK];
+    while (self->_running) {
+        size_t len = self->_session.read(buf, sizeof(buf), 100);
+        if (len > 0) {
+            pppos_input_tcpip(self->_pcb, buf, len);
+        }
+    }
+    self->_rx_task = NULL;
+    vTaskDelete(NULL);
+}
+
+#endif /* !defined(ARDUINO) && defined(ESP_PLATFORM) && defined(CONFIG_LWIP_PPP_SUPPORT) */
+
+#if !defined(ARDUINO) && !defined(ESP_PLATFORM)
+
+PPPBridgePosix::PPPBridgePosix(PPPSession& session)
+    : _session(session)
+    , _master(-1)
+    , _slave(-1)
+    , _running(false) {
+    _device[0] = '\0';
+}
+
+bool PPPBridgePosix::begin() {
+    if (_master >= 0) {
+        return true;
+    }
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        return false;
+    }
+    const char* name = NULL;
+    if (grantpt(fd) != 0 || unlockpt(fd) != 0 || (name = ptsname(fd)) == NULL) {
+        close(fd);
+        return false;
+    }
+    strncpy(_device, name, sizeof(_device) - 1);
+    _device[sizeof(_device) - 1] = '\0';
+
+    // keep the terminal open between runs of pppd, otherwise reads return EIO
+    _slave = open(_device, O_RDWR | O_NOCTTY);
+    if (_slave < 0) {
+        close(fd);
+        return false;
+    }
+    // raw mode, so that frames go through unchanged until pppd sets up the terminal
+    struct termios tty;
+    if (tcgetattr(_slave, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(_slave, TCSANOW, &tty);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _master = fd;
+
+    _running = true;
+    if (pthread_create(&_thread, NULL, upstream, this) != 0) {
+        _running = false;
+        end();
+        return false;
+    }
+    return true;
+}
+
+void PPPBridgePosix::end() {
+    if (_running) {
+        _running = false;
+        pthread_join(_thread, NULL);
+    }
+    if (_slave >= 0) {
+        close(_slave);
+        _slave = -1;
+    }
+    if (_master >= 0) {
+        close(_master);
+        _master = -1;
+    }
+}
+
+bool PPPBridgePosix::transfer(uint32_t wait) {
+    if (!_running || !_session.isOnline()) {
+        return false;
+    }
+    uint8_t buf[A76XX_PPP_CHUNK];
+    size_t len = _session.read(buf, sizeof(buf), wait);
+    size_t written = 0;
+    while (written < len) {
+        ssize_t ret = ::write(_master, buf + written, len - written);
+        if (ret > 0) {
+            written += ret;
+            continue;
+        }
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret < 0 && errno != EAGAIN) return false;
+        // pppd is not keeping up
+        struct pollfd pfd = {_master, POLLOUT, 0};
+        if (::poll(&pfd, 1, A76XX_SERIAL_TIMEOUT_DEFAULT) <= 0) return false;
+    }
+    return true;
+}
+
+void* PPPBridgePosix::upstream(void* arg) {
+    PPPBridgePosix* self = (PPPBridgePosix*) arg;
+    uint8_t buf[A76XX_PPP_CHUNK];
+    struct pollfd pfd = {self->_master, POLLIN, 0};
+    while (self->_running) {
+        if (::poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        ssize_t len = ::read(self->_master, buf, sizeof(buf));
+        if (len > 0) {
+            self->_session.write(buf, len);
+        }
+    }
+    return NULL;
+}
+
+#endif /* !defined(ARDUINO) && !defined(ESP_PLATFORM) */
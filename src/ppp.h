@@ -0,0 +1,244 @@
+#ifndef A76XX_PPP_H_
+#define A76XX_PPP_H_
+
+#include "A76XX.h"
+
+/*
+    @brief A PPP data call, whose byte stream is handed to an IP stack.
+
+    @details The native clients of the module move every byte through AT commands.
+        In data mode instead, the serial link carries the PPP frames of an IP
+        connection, run by the IP stack of the host, lwIP on ESP-IDF, see PPPLwIP,
+        or pppd on Linux, see PPPBridgePosix.
+
+        While the call is online, the serial object only carries data: use a CMUX
+        channel for it, so that AT commands can still be sent on another channel,
+        or suspend the call to send commands and resume it afterwards. The RX task
+        of ModemSerialESP must not run on the serial object of a call.
+
+        Example, with the APN already set with AT+CGDCONT:
+
+            mux.openChannel(2);
+            PPPSession ppp(*mux.channel(2));
+            if (ppp.dial() == A76XX_OPERATION_SUCCEEDED) {
+                PPPLwIP lwip(ppp);
+                lwip.begin();
+            }
+*/
+class PPPSession {
+  public:
+    PPPSession(ModemSerial& serial);
+
+    /*
+        @brief Start the data call and switch to data mode.
+
+        @details Fails if the module answers OK rather than CONNECT, i.e. if it
+            took the number for a voice call.
+        @param [IN] number The number to dial, "*99#" for the first PDP context.
+        @param [IN] timeout Time to wait for the module to connect.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t dial(const char* number = "*99#", uint32_t timeout = 30000);
+
+    /*
+        @brief Switch to command mode with +++, keeping the call.
+
+        @param [IN] guard_ms The guard time of the escape sequence.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t suspend(uint32_t guard_ms = 1000);
+
+    /*
+        @brief Switch back to data mode with ATO.
+
+        @param [IN] timeout Time to wait for the module to connect.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t resume(uint32_t timeout = 9000);
+
+    /*
+        @brief End the call, escaping data mode first if needed.
+
+        @param [IN] guard_ms The guard time of the escape sequence.
+        @return A76XX_OPERATION_SUCCEEDED, A76XX_OPERATION_TIMEDOUT or A76XX_GENERIC_ERROR
+    */
+    int8_t hangUp(uint32_t guard_ms = 1000);
+
+    /*
+        @brief Whether the call is in data mode.
+    */
+    bool isOnline() {
+        return _online;
+    }
+
+    /*
+        @brief Read the data received in data mode.
+
+        @param [OUT] buf Buffer receiving the data.
+        @param [IN] len Size of the buffer.
+        @param [IN] wait Milliseconds to wait for data if none is available.
+        @return The number of bytes read, 0 if none or if the call is not online.
+    */
+    size_t read(uint8_t* buf, size_t len, uint32_t wait);
+
+    /*
+        @brief Send data in data mode.
+
+        @return The number of bytes written, 0 if the call is not online.
+    */
+    size_t write(const uint8_t* data, size_t len);
+
+    ModemSerial& serial() {
+        return _serial;
+    }
+
+  private:
+    ModemSerial&                   _serial;
+    V25TERCommands                   _v25ter;
+    volatile bool                    _online;
+};
+
+#if !defined(ARDUINO) && defined(ESP_PLATFORM)
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_LWIP_PPP_SUPPORT
+
+#include "lwip/netif.h"
+#include "netif/ppp/pppapi.h"
+#include "netif/ppp/pppos.h"
+
+/*
+    @brief The lwIP network interface of a PPP data call, on ESP-IDF.
+
+    @details ::begin creates a PPPoS interface, made the default one, and a task
+        passing the data received from the module to lwIP, while lwIP writes its
+        frames to the module directly. The interface is up once PPP has negotiated
+        an address, after which sockets can be used as usual. Needs
+        CONFIG_LWIP_PPP_SUPPORT.
+*/
+class PPPLwIP {
+  public:
+    PPPLwIP(PPPSession& session);
+
+    ~PPPLwIP() {
+        end();
+    }
+
+    /*
+        @brief Create the interface and start PPP negotiation.
+
+        @param [IN] priority Priority of the task reading the module.
+        @param [IN] stack_size Stack size of the task, in bytes.
+        @return False if the call is not online or if the interface or the task
+            could not be created.
+    */
+    bool begin(UBaseType_t priority = A76XX_RX_TASK_PRIORITY,
+               uint32_t stack_size = A76XX_PPP_TASK_STACK_SIZE);
+
+    /*
+        @brief Terminate PPP and delete the interface. The call is not ended,
+            see PPPSession::hangUp.
+
+        @param [IN] timeout Time to wait for PPP to terminate.
+    */
+    void end(uint32_t timeout = 5000);
+
+    /*
+        @brief Whether PPP has negotiated an address.
+    */
+    bool isUp() {
+        return _up;
+    }
+
+    /*
+        @brief The lwIP error code of the last change of the link status.
+    */
+    int lastError() {
+        return _last_error;
+    }
+
+    struct netif* netif() {
+        return &_netif;
+    }
+
+  private:
+    PPPSession&                     _session;
+    struct netif                      _netif;
+    ppp_pcb*                            _pcb;
+    TaskHandle_t                    _rx_task;
+    volatile bool                   _running;
+    volatile bool                        _up;
+    volatile bool                      _dead;
+    volatile int                 _last_error;
+
+    static u32_t output(ppp_pcb* pcb, const void* data, u32_t len, void* ctx);
+    static void status(ppp_pcb* pcb, int err_code, void* ctx);
+    static void rxTask(void* arg);
+};
+
+#endif /* CONFIG_LWIP_PPP_SUPPORT */
+
+#endif /* !defined(ARDUINO) && defined(ESP_PLATFORM) */
+
+#if !defined(ARDUINO) && !defined(ESP_PLATFORM)
+
+#include <pthread.h>
+
+/*
+    @brief Connect a PPP data call to pppd, through a pseudo-terminal.
+
+    @details ::begin creates the pseudo-terminal, whose device is then passed to
+        pppd, e.g. `pppd /dev/pts/3 115200 noauth defaultroute usepeerdns`. Data
+        from pppd is forwarded to the module by a thread, data from the module is
+        forwarded to pppd by ::transfer, called in a loop.
+*/
+class PPPBridgePosix {
+  public:
+    PPPBridgePosix(PPPSession& session);
+
+    ~PPPBridgePosix() {
+        end();
+    }
+
+    /*
+        @brief Create the pseudo-terminal and start forwarding data from pppd.
+
+        @return False if the pseudo-terminal or the thread could not be created.
+    */
+    bool begin();
+
+    /*
+        @brief Stop forwarding and close the pseudo-terminal.
+    */
+    void end();
+
+    /*
+        @brief The device of the pseudo-terminal, to be opened by pppd.
+    */
+    const char* device() {
+        return _device;
+    }
+
+    /*
+        @brief Forward the data received from the module to pppd.
+
+        @param [IN] wait Milliseconds to wait for data.
+        @return False once the call is not online or the bridge has been stopped.
+    */
+    bool transfer(uint32_t wait);
+
+  private:
+    PPPSession&                     _session;
+    int                              _master;
+    int                               _slave;
+    char                         _device[64];
+    pthread_t                        _thread;
+    volatile bool                   _running;
+
+    static void* upstream(void* arg);
+};
+
+#endif /* !defined(ARDUINO) && !defined(ESP_PLATFORM) */
+
+#endif /* A76XX_PPP_H_ */
@@ -0,0 +1,44 @@
+#ifndef A76XX_RESPONSE_LINE_H_
+#define A76XX_RESPONSE_LINE_H_
+
+#include "A76XX.h"
+
+/*
+    @brief The implementation of ModemSerial::readLine, for any serial type.
+
+    @detail Backends instantiate it on their own, final, type, so that the calls
+        made for each byte are resolved at compile time and can be inlined.
+*/
+template <typename SERIAL>
+inline int readLineFrom(SERIAL& serial, char* buf, size_t size, uint32_t timeout) {
+    TimeoutCalc tc(serial.boundTimeout(timeout));
+    size_t len = 0;
+    bool complete = false;
+    while (!complete) {
+        int c = serial.read();
+        if (c < 0) {
+            if (!serial.waitAvailable(tc.remaining())) {
+                break;
+            }
+        } else if (c == '\n') {
+            complete = true;
+            // drop the carriage return
+            if (len > 0 && buf[len - 1] == '\r') {
+                len--;
+            }
+        } else if (len + 1 < size) {
+            // the last byte is kept for the terminator
+            buf[len++] = c;
+        }
+    }
+    if (size > 0) {
+        buf[len] = '\0';
+    }
+    return complete ? (int) len : -1;
+}
+
+inline int ModemSerial::readLine(char* buf, size_t size, uint32_t timeout) {
+    return readLineFrom(*this, buf, size, timeout);
+}
+
+#endif /* A76XX_RESPONSE_LINE_H_ */
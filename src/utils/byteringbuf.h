@@ -16,27 +16,164 @@ typedef enum {
     CMP_ALL_MATCH //string is completely contained in ringbuffer
 } cmp_match_t;
 
+/*
+    @brief Byte ring buffer of SIZE bytes, a power of two, with static storage.
+
+    @details Head and tail are free running counters, masked on access, so that
+        the buffer can be filled completely and indexing costs the same whatever
+        the size. Writing more than the free space overwrites the oldest data;
+        the number of bytes lost this way is counted by ::overflows.
+
+        The data can wrap around the end of the storage. ::linearize rotates it in
+        place so that it can be seen as one contiguous span, e.g. by parsers or by
+        memcmp; this only moves data when it actually wraps.
+*/
+template <size_t SIZE>
 class ByteRingBuf {
+    static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "ByteRingBuf size must be a power of two");
+
 public:
-    ByteRingBuf(size_t sizeBytes);
-    size_t write(uint8_t* source, uint16_t len);
-    size_t read(uint8_t* dest, uint16_t maxLen);
-    void clear(void);
-    size_t getFree();
-    size_t getUsed();
-    cmp_match_t compare(const char* str);
-    size_t consume(size_t n);
-    bool endsWith(const char* str);
-    bool peek(uint8_t* val);
-    bool pop(uint8_t* val);
-    ~ByteRingBuf();
+    ByteRingBuf() : _head(0), _tail(0), _overflows(0) {}
+
+    static size_t capacity() {
+        return SIZE;
+    }
+
+    size_t getUsed() {
+        return _head - _tail;
+    }
+
+    size_t getFree() {
+        return SIZE - getUsed();
+    }
+
+    /*
+        @brief Number of bytes overwritten before being read, since construction.
+    */
+    size_t overflows() {
+        return _overflows;
+    }
+
+    void clear(void) {
+        _head = 0;
+        _tail = 0;
+    }
+
+    size_t write(const uint8_t* source, size_t len) {
+        //only the last SIZE bytes can be kept
+        if(len > SIZE) {
+            _overflows += len - SIZE;
+            write(source + len - SIZE, SIZE);
+            return len;
+        }
+        //make room by dropping the oldest data
+        size_t freeLen = getFree();
+        if(len > freeLen) {
+            _overflows += len - freeLen;
+            _tail += len - freeLen;
+        }
+        size_t pos = _head & MASK;
+        size_t copyLen = len < SIZE - pos ? len : SIZE - pos;
+        memcpy(_buf + pos, source, copyLen);
+        if(len > copyLen) memcpy(_buf, source + copyLen, len - copyLen);
+        _head += len;
+        return len;
+    }
+
+    size_t read(uint8_t* dest, size_t maxLen) {
+        size_t readLen = getUsed();
+        readLen = maxLen < readLen ? maxLen : readLen;
+        size_t pos = _tail & MASK;
+        size_t copyLen = readLen < SIZE - pos ? readLen : SIZE - pos;
+        memcpy(dest, _buf + pos, copyLen);
+        if(readLen > copyLen) memcpy(dest + copyLen, _buf, readLen - copyLen);
+        _tail += readLen;
+        return readLen;
+    }
+
+    size_t consume(size_t n) {
+        size_t availLen = getUsed();
+        size_t consumeLen = n < availLen ? n : availLen;
+        _tail += consumeLen;
+        return consumeLen;
+    }
+
+    bool peek(uint8_t* val) {
+        if(_head == _tail) return false;
+        *val = _buf[_tail & MASK];
+        return true;
+    }
+
+    bool pop(uint8_t* val) {
+        if(_head == _tail) return false;
+        *val = _buf[_tail++ & MASK];
+        return true;
+    }
+
+    cmp_match_t compare(const char* str) {
+        if(!str) return CMP_NO_MATCH;
+        size_t availLen = getUsed();
+        if(availLen == 0) return CMP_NO_MATCH;
+        size_t strLen = strlen(str);
+        if(!strLen) return CMP_NO_MATCH;
+        size_t cmpLen = strLen < availLen ? strLen : availLen;
+
+        if(!equals(_tail, str, cmpLen)) return CMP_NO_MATCH;
+        if(strLen != cmpLen) return CMP_MATCH_PART;
+        return CMP_ALL_MATCH;
+    }
+
+    bool endsWith(const char* str) {
+        if(!str) return false;
+        size_t strLen = strlen(str);
+        if(!strLen || getUsed() < strLen) return false;
+        return equals(_head - strLen, str, strLen);
+    }
+
+    /*
+        @brief Make the data contiguous and return a pointer to it.
+
+        @detail The pointer is valid for ::getUsed bytes, until the next write.
+    */
+    const uint8_t* linearize() {
+        size_t pos = _tail & MASK;
+        size_t used = getUsed();
+        if(pos + used > SIZE) {
+            //rotate the whole storage left by pos, with three reversals, so
+            //that the oldest byte moves to the start
+            reverse(0, pos);
+            reverse(pos, SIZE);
+            reverse(0, SIZE);
+            _tail -= pos;
+            _head -= pos;
+            pos = 0;
+        }
+        return _buf + pos;
+    }
+
 private:
-    unsigned char* _buf;
-    size_t _size;
+    static const size_t MASK = SIZE - 1;
+
+    uint8_t _buf[SIZE];
     size_t _head;
     size_t _tail;
-};
+    size_t _overflows;
 
+    //compare len bytes, starting at the given counter, in at most two pieces
+    bool equals(size_t from, const char* str, size_t len) {
+        size_t pos = from & MASK;
+        size_t cmpLen = len < SIZE - pos ? len : SIZE - pos;
+        return memcmp(_buf + pos, str, cmpLen) == 0
+            && memcmp(_buf, str + cmpLen, len - cmpLen) == 0;
+    }
 
+    void reverse(size_t from, size_t to) {
+        while(from + 1 < to) {
+            uint8_t tmp = _buf[from];
+            _buf[from++] = _buf[--to];
+            _buf[to] = tmp;
+        }
+    }
+};
 
 #endif /* COMPONENTS_A76XX_SRC_UTILS_CIRCBUF_H_ */
@@ -0,0 +1,253 @@
+#ifndef A76XX_UTILS_CHANNEL_LOCK_H_
+#define A76XX_UTILS_CHANNEL_LOCK_H_
+
+#if defined(ESP_PLATFORM)
+    extern "C" {
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/task.h"
+    #include "freertos/semphr.h"
+    }
+    #define A76XX_CHANNEL_LOCK_FREERTOS
+#elif !defined(ARDUINO)
+    #include <pthread.h>
+    #define A76XX_CHANNEL_LOCK_PTHREAD
+#endif
+
+/*
+    @brief Recursive lock that gives a task exclusive use of the serial channel
+        for the whole duration of a command.
+
+    @details Waiters are served in FIFO order, the lock being handed over directly
+        by the releasing task to the next waiter, so that no task can overtake the
+        others. Two queues are kept: waiters that asked for priority, i.e. short
+        commands, are served first, but at most A76XX_CHANNEL_PRIORITY_BURST in a
+        row while normal waiters are queued, so that these are never starved.
+
+        The lock is recursive: a task that owns it can acquire it again, e.g. a
+        client that holds the channel across several commands, each of which
+        acquires it too. Waiters do not allocate: their queue entry lives on
+        their own stack.
+
+        With FreeRTOS (ESP-IDF and the Arduino core for the ESP32) the lock is
+        built on semaphores, on other hosts on pthreads. On other Arduino boards,
+        which have a single thread of execution, it does nothing.
+*/
+class ChannelLock {
+  public:
+    ChannelLock()
+        : _depth(0)
+        , _burst(0)
+        , _head(NULL)
+        , _tail(NULL)
+        , _prio_head(NULL)
+        , _prio_tail(NULL) {
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+        _state = xSemaphoreCreateMutexStatic(&_state_buf);
+#elif defined(A76XX_CHANNEL_LOCK_PTHREAD)
+        pthread_mutex_init(&_state, NULL);
+        pthread_cond_init(&_cond, NULL);
+#endif
+    }
+
+    ~ChannelLock() {
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+        vSemaphoreDelete(_state);
+#elif defined(A76XX_CHANNEL_LOCK_PTHREAD)
+        pthread_cond_destroy(&_cond);
+        pthread_mutex_destroy(&_state);
+#endif
+    }
+
+    /*
+        @brief Block until the calling task owns the lock.
+
+        @param [IN] priority Whether to be served before normal waiters. Use for
+            commands that complete quickly.
+    */
+    void acquire(bool priority = false) {
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS) || defined(A76XX_CHANNEL_LOCK_PTHREAD)
+        lockState();
+        Thread_t self = currentThread();
+        if (isFree() || isOwner(self)) {
+            take(self);
+            unlockState();
+            return;
+        }
+
+        Waiter waiter;
+        waiter.thread = self;
+        waiter.granted = false;
+        waiter.next = NULL;
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+        waiter.signal = xSemaphoreCreateBinaryStatic(&waiter.signal_buf);
+#endif
+        if (priority) {
+            append(_prio_head, _prio_tail, &waiter);
+        } else {
+            append(_head, _tail, &waiter);
+        }
+
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+        unlockState();
+        // ownership is set by the releasing task before the semaphore is given
+        xSemaphoreTake(waiter.signal, portMAX_DELAY);
+        vSemaphoreDelete(waiter.signal);
+#else
+        while (!waiter.granted) {
+            pthread_cond_wait(&_cond, &_state);
+        }
+        unlockState();
+#endif
+#endif
+    }
+
+    /*
+        @brief Acquire the lock only if this can be done without waiting.
+
+        @return True if the calling task now owns the lock.
+    */
+    bool tryAcquire() {
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS) || defined(A76XX_CHANNEL_LOCK_PTHREAD)
+        lockState();
+        Thread_t self = currentThread();
+        bool ok = isFree() || isOwner(self);
+        if (ok) {
+            take(self);
+        }
+        unlockState();
+        return ok;
+#else
+        return true;
+#endif
+    }
+
+    /*
+        @brief Whether the calling task owns the lock. Always true without threads.
+    */
+    bool held() {
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS) || defined(A76XX_CHANNEL_LOCK_PTHREAD)
+        lockState();
+        bool ok = isOwner(currentThread());
+        unlockState();
+        return ok;
+#else
+        return true;
+#endif
+    }
+
+    /*
+        @brief Release the lock once for each time it has been acquired.
+
+        @detail When the lock becomes free, it is handed to the next waiter.
+    */
+    void release() {
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS) || defined(A76XX_CHANNEL_LOCK_PTHREAD)
+        lockState();
+        if (_depth > 0 && --_depth == 0) {
+            Waiter* next = popNext();
+            if (next != NULL) {
+                _owner = next->thread;
+                _depth = 1;
+                next->granted = true;
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+                xSemaphoreGive(next->signal);
+#else
+                pthread_cond_broadcast(&_cond);
+#endif
+            }
+        }
+        unlockState();
+#endif
+    }
+
+  private:
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+    typedef TaskHandle_t Thread_t;
+#elif defined(A76XX_CHANNEL_LOCK_PTHREAD)
+    typedef pthread_t Thread_t;
+#else
+    typedef uint8_t Thread_t;
+#endif
+
+    struct Waiter {
+        Thread_t              thread;
+        volatile bool        granted;
+        Waiter*                 next;
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+        SemaphoreHandle_t     signal;
+        StaticSemaphore_t signal_buf;
+#endif
+    };
+
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+    SemaphoreHandle_t          _state;
+    StaticSemaphore_t      _state_buf;
+#elif defined(A76XX_CHANNEL_LOCK_PTHREAD)
+    pthread_mutex_t            _state;
+    pthread_cond_t              _cond;
+#endif
+    Thread_t                   _owner;
+    uint16_t                   _depth;
+    uint8_t                    _burst;
+    Waiter*                     _head;
+    Waiter*                     _tail;
+    Waiter*                _prio_head;
+    Waiter*                _prio_tail;
+
+#if defined(A76XX_CHANNEL_LOCK_FREERTOS)
+    void lockState()   { xSemaphoreTake(_state, portMAX_DELAY); }
+    void unlockState() { xSemaphoreGive(_state); }
+    static Thread_t currentThread() { return xTaskGetCurrentTaskHandle(); }
+    bool isOwner(Thread_t self) { return _depth > 0 && _owner == self; }
+#elif defined(A76XX_CHANNEL_LOCK_PTHREAD)
+    void lockState()   { pthread_mutex_lock(&_state); }
+    void unlockState() { pthread_mutex_unlock(&_state); }
+    static Thread_t currentThread() { return pthread_self(); }
+    bool isOwner(Thread_t self) { return _depth > 0 && pthread_equal(_owner, self); }
+#endif
+
+    // free and nobody queued, otherwise it must be handed over in order
+    bool isFree() {
+        return _depth == 0 && _head == NULL && _prio_head == NULL;
+    }
+
+    void take(Thread_t self) {
+        _owner = self;
+        _depth++;
+    }
+
+    static void append(Waiter*& head, Waiter*& tail, Waiter* waiter) {
+        if (tail == NULL) {
+            head = waiter;
+        } else {
+            tail->next = waiter;
+        }
+        tail = waiter;
+    }
+
+    static Waiter* pop(Waiter*& head, Waiter*& tail) {
+        Waiter* waiter = head;
+        head = waiter->next;
+        if (head == NULL) {
+            tail = NULL;
+        }
+        return waiter;
+    }
+
+    Waiter* popNext() {
+        if (_prio_head != NULL && (_head == NULL || _burst < A76XX_CHANNEL_PRIORITY_BURST)) {
+            // only count the turns taken from normal waiters
+            if (_head != NULL) {
+                _burst++;
+            }
+            return pop(_prio_head, _prio_tail);
+        }
+        if (_head != NULL) {
+            _burst = 0;
+            return pop(_head, _tail);
+        }
+        return NULL;
+    }
+};
+
+#endif /* A76XX_UTILS_CHANNEL_LOCK_H_ */
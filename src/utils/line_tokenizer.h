@@ -0,0 +1,288 @@
+#ifndef A76XX_UTILS_LINE_TOKENIZER_H_
+#define A76XX_UTILS_LINE_TOKENIZER_H_
+
+/*
+    @brief A field of a response line, as a view on the characters of the line.
+
+    @details Leading spaces and the double quotes around quoted strings are not
+        part of the field. Decoders stop at the first character that does not
+        belong to the number and return a default value if there is no number at
+        all, e.g. for an empty field: they never read past the field, which is not
+        null terminated.
+*/
+class LineField {
+  public:
+    const char* data;
+    size_t       len;
+
+    LineField()
+        : data("")
+        , len(0) {}
+
+    LineField(const char* _data, size_t _len)
+        : data(_data)
+        , len(_len) {}
+
+    bool empty() const {
+        return len == 0;
+    }
+
+    /*
+        @brief Whether the field is equal to the given string.
+    */
+    bool equals(const char* str) const {
+        return strncmp(data, str, len) == 0 && str[len] == '\0';
+    }
+
+    /*
+        @brief The first character of the field, or `dflt` if the field is empty.
+    */
+    char toChar(char dflt = '\0') const {
+        return len > 0 ? data[0] : dflt;
+    }
+
+    /*
+        @brief Decode a decimal integer, with an optional sign.
+
+        @param [IN] dflt The value returned if the field does not start with a number.
+    */
+    long toInt(long dflt = 0) const {
+        size_t pos = 0;
+        bool negative = sign(pos);
+        if (pos == len || !isDigit(data[pos])) {
+            return dflt;
+        }
+        unsigned long val = 0;
+        while (pos < len && isDigit(data[pos])) {
+            val = val * 10 + (data[pos++] - '0');
+        }
+        return negative ? -(long) val : (long) val;
+    }
+
+    /*
+        @brief Decode a decimal number with a fractional part, e.g. "-12.345".
+
+        @detail The integer and fractional parts are decoded as integers and only
+            combined at the end, so the result is as accurate as a float allows.
+            Digits after the 9th decimal are ignored; exponents are not supported.
+        @param [IN] dflt The value returned if the field does not start with a number.
+    */
+    float toFloat(float dflt = 0.0f) const {
+        static const float scale[10] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f,
+                                        1e5f, 1e6f, 1e7f, 1e8f, 1e9f};
+        size_t pos = 0;
+        bool negative = sign(pos);
+        uint32_t int_part, frac_part;
+        uint8_t decimals;
+        if (!decimal(pos, int_part, frac_part, decimals, 9)) {
+            return dflt;
+        }
+        float val = (float) int_part + (float) frac_part / scale[decimals];
+        return negative ? -val : val;
+    }
+
+    /*
+        @brief Decode a decimal number as a fixed point integer, e.g. "-12.3" with
+            3 decimals gives -12300.
+
+        @detail Decimals beyond the requested ones are truncated. The result must
+            fit in 32 bits.
+        @param [IN] decimals Number of decimal digits kept, up to 9.
+        @param [IN] dflt The value returned if the field does not start with a number.
+    */
+    int32_t toFixed(uint8_t decimals, int32_t dflt = 0) const {
+        size_t pos = 0;
+        bool negative = sign(pos);
+        uint32_t int_part, frac_part;
+        uint8_t found;
+        if (!decimal(pos, int_part, frac_part, found, decimals)) {
+            return dflt;
+        }
+        uint32_t val = int_part;
+        for (uint8_t i = 0; i < decimals; i++) {
+            val *= 10;
+        }
+        for (; found < decimals; found++) {
+            frac_part *= 10;
+        }
+        val += frac_part;
+        return negative ? -(int32_t) val : (int32_t) val;
+    }
+
+    /*
+        @brief Copy the field into a null terminated string.
+
+        @param [OUT] buf The destination buffer.
+        @param [IN] size The size of the buffer. The field is truncated to fit.
+        @return The number of characters copied, without the terminator.
+    */
+    size_t copy(char* buf, size_t size) const {
+        if (size == 0) {
+            return 0;
+        }
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(buf, data, n);
+        buf[n] = '\0';
+        return n;
+    }
+
+  private:
+    static bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // consume an optional sign, return whether it is negative
+    bool sign(size_t& pos) const {
+        if (pos < len && (data[pos] == '-' || data[pos] == '+')) {
+            return data[pos++] == '-';
+        }
+        return false;
+    }
+
+    // decode the digits before and after the decimal point, keeping at most
+    // max_decimals of the latter, return false if there are no digits at all
+    bool decimal(size_t& pos, uint32_t& int_part, uint32_t& frac_part,
+                 uint8_t& decimals, uint8_t max_decimals) const {
+        size_t start = pos;
+        int_part = 0;
+        frac_part = 0;
+        decimals = 0;
+        while (pos < len && isDigit(data[pos])) {
+            int_part = int_part * 10 + (data[pos++] - '0');
+        }
+        bool digits = pos > start;
+        if (pos < len && data[pos] == '.') {
+            pos++;
+            while (pos < len && isDigit(data[pos])) {
+                if (decimals < max_decimals) {
+                    frac_part = frac_part * 10 + (data[pos] - '0');
+                    decimals++;
+                }
+                pos++;
+                digits = true;
+            }
+        }
+        return digits;
+    }
+};
+
+/*
+    @brief Split a response line into fields, without copying it.
+
+    @details A line with N separators has N+1 fields, any of which can be empty,
+        e.g. ",,,," when GNSS has no fix. Separators within double quotes do not
+        split, so that quoted strings such as dates can contain commas. The line
+        must stay alive while its fields are used.
+
+        Example, after matching "+HTTPACTION: ":
+
+            char line[48];
+            if (serial.readLine(line, sizeof(line), 9000) >= 0) {
+                LineTokenizer fields(line);
+                fields.skip();
+                uint16_t status_code = fields.next().toInt();
+                uint32_t length = fields.next().toInt();
+            }
+*/
+class LineTokenizer {
+  public:
+    LineTokenizer(const char* line, size_t len, char separator = ',')
+        : _line(line)
+        , _len(len)
+        , _pos(0)
+        , _separator(separator)
+        , _done(false) {}
+
+    /*
+        @brief Split a null terminated line on commas.
+    */
+    explicit LineTokenizer(const char* line)
+        : LineTokenizer(line, strlen(line)) {}
+
+    /*
+        @brief Whether all fields have been returned.
+    */
+    bool done() const {
+        return _done;
+    }
+
+    /*
+        @brief Get the next field.
+
+        @return False if all fields have already been returned.
+    */
+    bool next(LineField& field) {
+        if (_done) {
+            return false;
+        }
+        size_t start = _pos;
+        bool quoted = false;
+        while (_pos < _len && (quoted || _line[_pos] != _separator)) {
+            if (_line[_pos] == '"') {
+                quoted = !quoted;
+            }
+            _pos++;
+        }
+        size_t end = _pos;
+        if (_pos < _len) {
+            _pos++;
+        } else {
+            _done = true;
+        }
+
+        while (start < end && _line[start] == ' ') {
+            start++;
+        }
+        if (end - start >= 2 && _line[start] == '"' && _line[end - 1] == '"') {
+            start++;
+            end--;
+        }
+        field = LineField(_line + start, end - start);
+        return true;
+    }
+
+    /*
+        @brief Get the next field, or an empty one if all fields have already
+            been returned.
+    */
+    LineField next() {
+        LineField field;
+        next(field);
+        return field;
+    }
+
+    /*
+        @brief Skip fields.
+    */
+    void skip(uint8_t n = 1) {
+        LineField field;
+        while (n-- > 0 && next(field)) {}
+    }
+
+    /*
+        @brief Get all the remaining fields at once.
+
+        @param [OUT] fields Array receiving the fields.
+        @param [IN] max Size of the array. Fields that do not fit are skipped.
+        @return The number of fields stored.
+    */
+    uint8_t split(LineField* fields, uint8_t max) {
+        uint8_t n = 0;
+        LineField field;
+        while (next(field)) {
+            if (n < max) {
+                fields[n++] = field;
+            }
+        }
+        return n;
+    }
+
+  private:
+    const char*      _line;
+    size_t            _len;
+    size_t            _pos;
+    char        _separator;
+    bool             _done;
+};
+
+#endif /* A76XX_UTILS_LINE_TOKENIZER_H_ */
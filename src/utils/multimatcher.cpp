@@ -0,0 +1,146 @@
+#include "A76XX.h"
+
+MultiMatcher::MultiMatcher() {
+    clear();
+}
+
+void MultiMatcher::clear() {
+    _nodes[0].chr     = 0;
+    _nodes[0].out     = A76XX_MATCHER_NO_MATCH;
+    _nodes[0].child   = 0;
+    _nodes[0].sibling = 0;
+    _nodes[0].fail    = 0;
+    memset(_root, 0, sizeof(_root));
+    _num_nodes = 1;
+    _num_fallback = 0;
+    _state = 0;
+}
+
+bool MultiMatcher::add(const char* pattern, uint8_t id) {
+    if (pattern == NULL || *pattern == '\0') {
+        return false;
+    }
+
+    // check first that the whole pattern fits, so we never leave half a pattern behind
+    uint16_t node = 0;
+    const char* p = pattern;
+    while (*p != '\0') {
+        uint16_t next = child(node, static_cast<uint8_t>(*p));
+        if (next == 0) {
+            break;
+        }
+        node = next;
+        p++;
+    }
+    if (strlen(p) > static_cast<size_t>(A76XX_MATCHER_MAX_NODES - _num_nodes)) {
+        return false;
+    }
+
+    // append the remaining characters as a chain of new nodes
+    for (; *p != '\0'; p++) {
+        uint16_t next = _num_nodes++;
+        _nodes[next].chr     = *p;
+        _nodes[next].out     = A76XX_MATCHER_NO_MATCH;
+        _nodes[next].child   = 0;
+        _nodes[next].fail    = 0;
+        if (node == 0 && static_cast<uint8_t>(*p) < 128) {
+            _root[static_cast<uint8_t>(*p)] = next;
+            _nodes[next].sibling = 0;
+        } else {
+            _nodes[next].sibling = _nodes[node].child;
+            _nodes[node].child   = next;
+        }
+        node = next;
+    }
+
+    if (id < _nodes[node].out) {
+        _nodes[node].out = id;
+    }
+    return true;
+}
+
+bool MultiMatcher::addFallback(const char* pattern, uint8_t id) {
+    if (pattern == NULL || *pattern == '\0' || _num_fallback == A76XX_MATCHER_MAX_FALLBACK) {
+        return false;
+    }
+    Fallback& f = _fallback[_num_fallback++];
+    f.pattern = pattern;
+    f.len     = strlen(pattern);
+    f.pos     = 0;
+    f.id      = id;
+    return true;
+}
+
+// length of the longest proper prefix of the pattern that is also a suffix of its first len bytes
+static uint16_t border(const char* pattern, uint16_t len) {
+    uint16_t k = len - 1;
+    while (k > 0 && memcmp(pattern, pattern + len - k, k) != 0) {
+        k--;
+    }
+    return k;
+}
+
+uint8_t MultiMatcher::feedFallback(uint8_t c, uint8_t out) {
+    for (uint8_t i = 0; i < _num_fallback; i++) {
+        Fallback& f = _fallback[i];
+        uint16_t pos = f.pos;
+        while (true) {
+            if (static_cast<uint8_t>(f.pattern[pos]) == c) {
+                pos++;
+                break;
+            }
+            if (pos == 0) {
+                break;
+            }
+            pos = border(f.pattern, pos);
+        }
+        if (pos == f.len) {
+            if (f.id < out) {
+                out = f.id;
+            }
+            pos = border(f.pattern, pos);
+        }
+        f.pos = pos;
+    }
+    return out;
+}
+
+void MultiMatcher::compile() {
+    // breadth first visit, so the failure link of a node is always
+    // computed after the links of all the nodes closer to the root
+    uint16_t queue[A76XX_MATCHER_MAX_NODES];
+    uint16_t head = 0, tail = 0;
+
+    for (uint16_t c = 0; c < 128; c++) {
+        if (_root[c] != 0) {
+            _nodes[_root[c]].fail = 0;
+            queue[tail++] = _root[c];
+        }
+    }
+    for (uint16_t i = _nodes[0].child; i != 0; i = _nodes[i].sibling) {
+        _nodes[i].fail = 0;
+        queue[tail++] = i;
+    }
+
+    while (head < tail) {
+        uint16_t node = queue[head++];
+        for (uint16_t v = _nodes[node].child; v != 0; v = _nodes[v].sibling) {
+            uint8_t c = static_cast<uint8_t>(_nodes[v].chr);
+            uint16_t f = _nodes[node].fail;
+            uint16_t next = child(f, c);
+            while (next == 0 && f != 0) {
+                f = _nodes[f].fail;
+                next = child(f, c);
+            }
+            _nodes[v].fail = next;
+
+            // inherit the patterns ending at the failure node, which are suffixes of this one
+            if (_nodes[next].out < _nodes[v].out) {
+                _nodes[v].out = _nodes[next].out;
+            }
+            queue[tail++] = v;
+        }
+    }
+
+    _state = 0;
+}
@@ -0,0 +1,135 @@
+#ifndef A76XX_UTILS_MULTIMATCHER_H_
+#define A76XX_UTILS_MULTIMATCHER_H_
+
+/*
+    Value returned by MultiMatcher::feed when no pattern ends at the current byte.
+*/
+#define A76XX_MATCHER_NO_MATCH 0xFF
+
+/*
+    @brief Incremental multi-pattern string matcher (Aho-Corasick automaton).
+
+    @details All the strings we want to detect in the stream of characters
+        coming from the module (the strings and final result codes passed to
+        waitResponse) are compiled into a single automaton. Each received byte then advances the automaton
+        by one step, so the cost per byte does not grow with the number of
+        patterns, unlike testing every pattern with `endsWith` on every byte.
+
+        Each pattern is added with a numeric id. When several patterns end at the
+        same byte, the one with the lowest id is reported. Nodes are stored in a
+        fixed array of A76XX_MATCHER_MAX_NODES elements, so no heap is used.
+*/
+class MultiMatcher {
+  public:
+    MultiMatcher();
+
+    /*
+        @brief Remove all patterns and reset the automaton.
+    */
+    void clear();
+
+    /*
+        @brief Add a pattern to the automaton.
+
+        @details Call ::compile once all patterns have been added.
+        @param [IN] pattern The string to match. NULL or empty strings are ignored.
+        @param [IN] id The id reported by ::feed when the pattern is found. Must be
+            smaller than A76XX_MATCHER_NO_MATCH.
+        @return False if there is not enough space left to store the pattern. The
+            pattern is then not matched, unless given to ::addFallback.
+    */
+    bool add(const char* pattern, uint8_t id);
+
+    /*
+        @brief Match a pattern that does not fit the automaton on its own.
+
+        @details The pattern is compared on its own, on each byte, so matching
+            gets slower with each one: increase A76XX_MATCHER_MAX_NODES instead
+            if this happens often. The pattern is not copied, it must live until
+            ::clear. Up to A76XX_MATCHER_MAX_FALLBACK patterns are kept.
+        @return False if NULL, empty or there is no space left.
+    */
+    bool addFallback(const char* pattern, uint8_t id);
+
+    /*
+        @brief Build the failure links of the automaton and reset its state.
+    */
+    void compile();
+
+    /*
+        @brief Go back to the initial state, forgetting the bytes seen so far.
+    */
+    void reset() {
+        _state = 0;
+        for (uint8_t i = 0; i < _num_fallback; i++) {
+            _fallback[i].pos = 0;
+        }
+    }
+
+    /*
+        @brief Advance the automaton by one byte.
+
+        @param [IN] c The new byte from the stream.
+        @return The id of the pattern that ends at this byte, or A76XX_MATCHER_NO_MATCH.
+    */
+    uint8_t feed(uint8_t c) {
+        uint16_t state = _state;
+        while (true) {
+            uint16_t next = child(state, c);
+            if (next != 0) {
+                state = next;
+                break;
+            }
+            if (state == 0) {
+                break;
+            }
+            state = _nodes[state].fail;
+        }
+        _state = state;
+        if (_num_fallback != 0) {
+            return feedFallback(c, _nodes[state].out);
+        }
+        return _nodes[state].out;
+    }
+
+  private:
+    struct Node {
+        char     chr;     // the byte leading to this node from its parent
+        uint8_t  out;     // lowest id of the patterns ending here, including via failure links
+        uint16_t child;   // first child, 0 if none
+        uint16_t sibling; // next child of the same parent, 0 if none
+        uint16_t fail;    // longest proper suffix that is also a node
+    };
+
+    // a pattern matched on its own: pos is the length of its longest prefix
+    // ending at the last byte, so no history of the bytes is needed
+    struct Fallback {
+        const char* pattern;
+        uint16_t    len;
+        uint16_t    pos;
+        uint8_t     id;
+    };
+
+    Node     _nodes[A76XX_MATCHER_MAX_NODES];
+    Fallback _fallback[A76XX_MATCHER_MAX_FALLBACK];
+    uint8_t  _num_fallback;
+    uint16_t _root[128]; // direct lookup of the children of the root for ASCII bytes
+    uint16_t _num_nodes;
+    uint16_t _state;
+
+    uint16_t child(uint16_t node, uint8_t c) {
+        if (node == 0 && c < 128) {
+            return _root[c];
+        }
+        for (uint16_t i = _nodes[node].child; i != 0; i = _nodes[i].sibling) {
+            if (static_cast<uint8_t>(_nodes[i].chr) == c) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    uint8_t feedFallback(uint8_t c, uint8_t out);
+};
+
+#endif /* A76XX_UTILS_MULTIMATCHER_H_ */